@@ -30,6 +30,62 @@
       }, {
         'cflags': ['-O2', '-fstack-protector-strong'],
       }],
+      # Applies to both pty and spawn-helper so they link against the sysroot.
+      ['OS=="linux"', {
+        'variables': {
+          'sysroot%': '<!(node -p "process.env.SYSROOT_PATH || \'\'")',
+          'target_arch%': '<!(node -p "process.env.npm_config_arch || process.arch")',
+        },
+        'conditions': [
+          ['sysroot!=""', {
+            'variables': {
+              'gcc_include%': '<!(${CXX:-g++} -print-file-name=include)',
+            },
+            'conditions': [
+              ['target_arch=="x64"', {
+                'cflags': [
+                  '--sysroot=<(sysroot)',
+                  '-nostdinc',
+                  '-isystem<(gcc_include)',
+                  '-isystem<(sysroot)/usr/include',
+                  '-isystem<(sysroot)/usr/include/x86_64-linux-gnu'
+                ],
+                'cflags_cc': [
+                  '-nostdinc++',
+                  '-isystem<(sysroot)/../include/c++/10.5.0',
+                  '-isystem<(sysroot)/../include/c++/10.5.0/x86_64-linux-gnu',
+                  '-isystem<(sysroot)/../include/c++/10.5.0/backward'
+                ],
+                'ldflags': [
+                  '--sysroot=<(sysroot)',
+                  '-L<(sysroot)/lib',
+                  '-L<(sysroot)/usr/lib'
+                ],
+              }],
+              ['target_arch=="arm64"', {
+                'cflags': [
+                  '--sysroot=<(sysroot)',
+                  '-nostdinc',
+                  '-isystem<(gcc_include)',
+                  '-isystem<(sysroot)/usr/include',
+                  '-isystem<(sysroot)/usr/include/aarch64-linux-gnu'
+                ],
+                'cflags_cc': [
+                  '-nostdinc++',
+                  '-isystem<(sysroot)/../include/c++/10.5.0',
+                  '-isystem<(sysroot)/../include/c++/10.5.0/aarch64-linux-gnu',
+                  '-isystem<(sysroot)/../include/c++/10.5.0/backward'
+                ],
+                'ldflags': [
+                  '--sysroot=<(sysroot)',
+                  '-L<(sysroot)/lib',
+                  '-L<(sysroot)/usr/lib'
+                ],
+              }]
+            ]
+          }]
+        ]
+      }]
     ],
   },
   'conditions': [
@@ -57,7 +113,19 @@
         {
           'target_name': 'pty',
           'sources': [
+            'src/unix/boundary.cc',
+            'src/unix/matcher.cc',
+            'src/unix/pool.cc',
+            'src/unix/procinfo.cc',
             'src/unix/pty.cc',
+            'src/unix/reaper.cc',
+            'src/unix/reader.cc',
+            'src/unix/recorder.cc',
+            'src/unix/scan.cc',
+            'src/unix/scrollback.cc',
+            'src/unix/stripper.cc',
+            'src/unix/tracker.cc',
+            'src/unix/writer.cc',
           ],
           'libraries': [
             '-lutil'
@@ -72,67 +140,12 @@
               'libraries!': [
                 '-lutil'
               ]
-            }],
-            ['OS=="linux"', {
-              'variables': {
-                'sysroot%': '<!(node -p "process.env.SYSROOT_PATH || \'\'")',
-                'target_arch%': '<!(node -p "process.env.npm_config_arch || process.arch")',
-              },
-              'conditions': [
-                ['sysroot!=""', {
-                  'variables': {
-                    'gcc_include%': '<!(${CXX:-g++} -print-file-name=include)',
-                  },
-                  'conditions': [
-                    ['target_arch=="x64"', {
-                      'cflags': [
-                        '--sysroot=<(sysroot)',
-                        '-nostdinc',
-                        '-isystem<(gcc_include)',
-                        '-isystem<(sysroot)/usr/include',
-                        '-isystem<(sysroot)/usr/include/x86_64-linux-gnu'
-                      ],
-                      'cflags_cc': [
-                        '-nostdinc++',
-                        '-isystem<(sysroot)/../include/c++/10.5.0',
-                        '-isystem<(sysroot)/../include/c++/10.5.0/x86_64-linux-gnu',
-                        '-isystem<(sysroot)/../include/c++/10.5.0/backward'
-                      ],
-                      'ldflags': [
-                        '--sysroot=<(sysroot)',
-                        '-L<(sysroot)/lib',
-                        '-L<(sysroot)/usr/lib'
-                      ],
-                    }],
-                    ['target_arch=="arm64"', {
-                      'cflags': [
-                        '--sysroot=<(sysroot)',
-                        '-nostdinc',
-                        '-isystem<(gcc_include)',
-                        '-isystem<(sysroot)/usr/include',
-                        '-isystem<(sysroot)/usr/include/aarch64-linux-gnu'
-                      ],
-                      'cflags_cc': [
-                        '-nostdinc++',
-                        '-isystem<(sysroot)/../include/c++/10.5.0',
-                        '-isystem<(sysroot)/../include/c++/10.5.0/aarch64-linux-gnu',
-                        '-isystem<(sysroot)/../include/c++/10.5.0/backward'
-                      ],
-                      'ldflags': [
-                        '--sysroot=<(sysroot)',
-                        '-L<(sysroot)/lib',
-                        '-L<(sysroot)/usr/lib'
-                      ],
-                    }]
-                  ]
-                }]
-              ]
             }]
           ]
         }
       ]
     }],
-    ['OS=="mac"', {
+    ['OS=="mac" or OS=="linux"', {
       'targets': [
         {
           'target_name': 'spawn-helper',
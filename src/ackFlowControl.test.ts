@@ -0,0 +1,35 @@
+/**
+ * Copyright (c) 2026, Microsoft Corporation (MIT License).
+ */
+
+import * as assert from 'assert';
+import { AckFlowControl } from './ackFlowControl';
+
+describe('AckFlowControl', () => {
+  it('should pause above the high watermark and resume at the low watermark', () => {
+    const calls: string[] = [];
+    const flow = new AckFlowControl({ highWatermark: 100, lowWatermark: 20 }, () => calls.push('pause'), () => calls.push('resume'));
+    flow.sent(60);
+    flow.sent(40);
+    assert.deepStrictEqual(calls, []);
+    flow.sent(1);
+    assert.deepStrictEqual(calls, ['pause']);
+    assert.strictEqual(flow.paused, true);
+    flow.sent(50);
+    flow.ack(100);
+    assert.deepStrictEqual(calls, ['pause']);
+    flow.ack(31);
+    assert.deepStrictEqual(calls, ['pause', 'resume']);
+    assert.strictEqual(flow.unacked, 20);
+    assert.strictEqual(flow.paused, false);
+  });
+  it('should not count acks beyond what was sent', () => {
+    const flow = new AckFlowControl({ highWatermark: 100, lowWatermark: 20 }, () => {}, () => {});
+    flow.sent(10);
+    flow.ack(50);
+    assert.strictEqual(flow.unacked, 0);
+  });
+  it('should reject a low watermark that is not below the high watermark', () => {
+    assert.throws(() => new AckFlowControl({ highWatermark: 100, lowWatermark: 100 }, () => {}, () => {}));
+  });
+});
@@ -0,0 +1,61 @@
+/**
+ * Copyright (c) 2026, Microsoft Corporation (MIT License).
+ */
+
+import { IAckFlowControlOptions } from './interfaces';
+
+const DEFAULT_HIGH_WATERMARK = 1024 * 1024;
+const DEFAULT_LOW_WATERMARK = 256 * 1024;
+
+/**
+ * Counts the output handed to the consumer that it did not acknowledge yet.
+ *
+ * Reading the pty is paused once more than `highWatermark` is unacknowledged
+ * and resumed once acks bring it down to `lowWatermark`. While paused the
+ * output stays in the kernel, which blocks the process once that buffer is
+ * full.
+ */
+export class AckFlowControl {
+  private readonly _highWatermark: number;
+  private readonly _lowWatermark: number;
+
+  private _unacked: number = 0;
+  private _paused: boolean = false;
+
+  constructor(
+    options: IAckFlowControlOptions,
+    private readonly _pause: () => void,
+    private readonly _resume: () => void
+  ) {
+    this._highWatermark = options.highWatermark ?? DEFAULT_HIGH_WATERMARK;
+    this._lowWatermark = options.lowWatermark ?? Math.min(DEFAULT_LOW_WATERMARK, this._highWatermark / 2);
+    if (!(this._lowWatermark >= 0 && this._lowWatermark < this._highWatermark)) {
+      throw new Error('ackFlowControl.lowWatermark must be at least 0 and below highWatermark.');
+    }
+  }
+
+  public get unacked(): number { return this._unacked; }
+  public get paused(): boolean { return this._paused; }
+
+  /**
+   * Records output handed to the consumer.
+   */
+  public sent(length: number): void {
+    this._unacked += length;
+    if (!this._paused && this._unacked > this._highWatermark) {
+      this._paused = true;
+      this._pause();
+    }
+  }
+
+  /**
+   * Records output the consumer is done with.
+   */
+  public ack(length: number): void {
+    this._unacked = Math.max(0, this._unacked - length);
+    if (this._paused && this._unacked <= this._lowWatermark) {
+      this._paused = false;
+      this._resume();
+    }
+  }
+}
@@ -0,0 +1,65 @@
+/**
+ * Copyright (c) 2026, Microsoft Corporation (MIT License).
+ */
+
+import * as assert from 'assert';
+import { DataCoalescer } from './dataCoalescer';
+
+const wait = (ms: number): Promise<void> => new Promise<void>(resolve => setTimeout(resolve, ms));
+
+describe('DataCoalescer', () => {
+  it('should merge chunks that arrive within maxDelay', async () => {
+    const events: Array<string | Buffer> = [];
+    const coalescer = new DataCoalescer({ maxDelay: 20 }, data => events.push(data));
+    coalescer.push('a');
+    coalescer.push('b');
+    coalescer.push('c');
+    assert.deepStrictEqual(events, []);
+    await wait(40);
+    assert.deepStrictEqual(events, ['abc']);
+    assert.deepStrictEqual(coalescer.stats, { chunks: 3, events: 1, saved: 2 });
+  });
+  it('should flush once maxBatchSize is reached', () => {
+    const events: Array<string | Buffer> = [];
+    const coalescer = new DataCoalescer({ maxDelay: 1000, maxBatchSize: 4 }, data => events.push(data));
+    coalescer.push('ab');
+    coalescer.push('cd');
+    coalescer.push('e');
+    assert.deepStrictEqual(events, ['abcd']);
+    coalescer.dispose();
+    assert.deepStrictEqual(events, ['abcd', 'e']);
+  });
+  it('should concatenate buffers', () => {
+    const events: Array<string | Buffer> = [];
+    const coalescer = new DataCoalescer({ maxDelay: 1000 }, data => events.push(data));
+    coalescer.push(Buffer.from('ab'));
+    coalescer.push(Buffer.from('cd'));
+    coalescer.flush();
+    assert.deepStrictEqual(events, [Buffer.from('abcd')]);
+  });
+  describe('adaptive', () => {
+    it('should pass output through after input', () => {
+      const events: Array<string | Buffer> = [];
+      const coalescer = new DataCoalescer({ maxDelay: 1000, adaptive: true }, data => events.push(data));
+      coalescer.push('a');
+      coalescer.noteInput();
+      coalescer.push('b');
+      assert.deepStrictEqual(events, ['a', 'b']);
+      assert.strictEqual(coalescer.stats.saved, 0);
+      coalescer.dispose();
+    });
+    it('should pass the first chunk after idle time through and batch the rest', async () => {
+      const events: Array<string | Buffer> = [];
+      const coalescer = new DataCoalescer({ maxDelay: 20, adaptive: true }, data => events.push(data));
+      coalescer.push('a');
+      coalescer.push('b');
+      coalescer.push('c');
+      assert.deepStrictEqual(events, ['a']);
+      await wait(40);
+      assert.deepStrictEqual(events, ['a', 'bc']);
+      await wait(40);
+      coalescer.push('d');
+      assert.deepStrictEqual(events, ['a', 'bc', 'd']);
+    });
+  });
+});
@@ -0,0 +1,115 @@
+/**
+ * Copyright (c) 2026, Microsoft Corporation (MIT License).
+ */
+
+import { IDataCoalescingOptions, IDataCoalescingStats } from './interfaces';
+import { IDisposable } from './types';
+
+const DEFAULT_MAX_DELAY = 5;
+const DEFAULT_MAX_BATCH_SIZE = 64 * 1024;
+const DEFAULT_INPUT_WINDOW = 100;
+
+/**
+ * Merges the chunks read from a pty into fewer, larger data events.
+ *
+ * A batch is flushed once `maxDelay` has passed since its first chunk or it
+ * has reached `maxBatchSize`. In adaptive mode chunks are passed through right
+ * away while the user has typed within `inputWindow`, so echo is never
+ * delayed, and so is the first chunk after the output was idle for
+ * `maxDelay`. Only output that keeps coming is batched.
+ */
+export class DataCoalescer implements IDisposable {
+  private readonly _maxDelay: number;
+  private readonly _maxBatchSize: number;
+  private readonly _adaptive: boolean;
+  private readonly _inputWindow: number;
+
+  private _pending: Array<string | Buffer> = [];
+  private _pendingSize: number = 0;
+  private _pendingSequence: number | undefined;
+  private _timeout: NodeJS.Timeout | undefined;
+  private _lastInput: number = 0;
+  private _lastOutput: number = 0;
+
+  private _chunks: number = 0;
+  private _events: number = 0;
+
+  constructor(
+    options: IDataCoalescingOptions,
+    private readonly _fire: (data: string | Buffer, sequence?: number) => void
+  ) {
+    this._maxDelay = options.maxDelay ?? DEFAULT_MAX_DELAY;
+    this._maxBatchSize = options.maxBatchSize ?? DEFAULT_MAX_BATCH_SIZE;
+    this._adaptive = !!options.adaptive;
+    this._inputWindow = options.inputWindow ?? DEFAULT_INPUT_WINDOW;
+  }
+
+  public get stats(): IDataCoalescingStats {
+    return { chunks: this._chunks, events: this._events, saved: this._chunks - this._events - this._pending.length };
+  }
+
+  /**
+   * Records that the user wrote to the pty, see `adaptive`.
+   */
+  public noteInput(): void {
+    this._lastInput = Date.now();
+  }
+
+  /**
+   * Queues a chunk, given the sequence number just past it which is passed
+   * on with the event that fires it.
+   */
+  public push(data: string | Buffer, sequence?: number): void {
+    this._chunks++;
+    const now = Date.now();
+    const idle = now - this._lastOutput >= this._maxDelay;
+    this._lastOutput = now;
+    if (this._adaptive && this._pending.length === 0 && (idle || now - this._lastInput < this._inputWindow)) {
+      this._emit(data, sequence);
+      return;
+    }
+
+    this._pending.push(data);
+    this._pendingSequence = sequence;
+    this._pendingSize += typeof data === 'string' ? data.length : data.byteLength;
+    if (this._pendingSize >= this._maxBatchSize) {
+      this.flush();
+    } else if (!this._timeout) {
+      this._timeout = setTimeout(() => this.flush(), this._maxDelay);
+    }
+  }
+
+  /**
+   * Fires whatever is pending right away.
+   */
+  public flush(): void {
+    if (this._timeout) {
+      clearTimeout(this._timeout);
+      this._timeout = undefined;
+    }
+    if (this._pending.length === 0) {
+      return;
+    }
+    const pending = this._pending;
+    const sequence = this._pendingSequence;
+    this._pending = [];
+    this._pendingSize = 0;
+    this._pendingSequence = undefined;
+    if (pending.length === 1) {
+      this._emit(pending[0], sequence);
+    } else if (pending.every(chunk => typeof chunk === 'string')) {
+      this._emit(pending.join(''), sequence);
+    } else {
+      this._emit(Buffer.concat(pending.map(chunk => typeof chunk === 'string' ? Buffer.from(chunk) : chunk)), sequence);
+    }
+  }
+
+  public dispose(): void {
+    this.flush();
+  }
+
+  private _emit(data: string | Buffer, sequence: number | undefined): void {
+    this._events++;
+    this._fire(data, sequence);
+  }
+}
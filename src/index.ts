@@ -4,9 +4,11 @@
  * Copyright (c) 2018, Microsoft Corporation (MIT License).
  */
 
-import { ITerminal, IPtyOpenOptions, IPtyForkOptions, IWindowsPtyForkOptions } from './interfaces';
+import { ITerminal, IPtyOpenOptions, IPtyForkOptions, IWindowsPtyForkOptions, IPtyIoStatsSummary, IProcessInfo, IPtyPoolOptions, IPtyPoolStats, ISpawnLatencyHistogram, ISpawnManySpec, ISpawnTemplate, ISpawnTemplateOptions } from './interfaces';
 import { ArgvOrCommandLine } from './types';
-import { loadNativeModule } from './utils';
+import { assign, loadNativeModule } from './utils';
+import { spawnLatencyHistogram } from './spawnTimings';
+import { ioStatsRegistry } from './ioStats';
 
 let terminalCtor: any;
 if (process.platform === 'win32') {
@@ -31,6 +33,76 @@ export function spawn(file?: string, args?: ArgvOrCommandLine, opt?: IPtyForkOpt
   return new terminalCtor(file, args, opt);
 }
 
+/**
+ * Forks a process as a pseudoterminal without blocking the event loop. On Unix
+ * the pty is opened and the process started on the libuv threadpool, so many
+ * spawns can be in flight at once.
+ * @param file The file to launch.
+ * @param args The file's arguments as argv (string[]) or in a pre-escaped
+ * CommandLine format (string).
+ * @param options The options of the terminal.
+ * @returns A promise that rejects when the process could not be started.
+ */
+export function spawnAsync(file?: string, args?: ArgvOrCommandLine, opt?: IPtyForkOptions | IWindowsPtyForkOptions): Promise<ITerminal> {
+  if (process.platform === 'win32') {
+    return new Promise<ITerminal>(resolve => resolve(new terminalCtor(file, args, opt)));
+  }
+  return terminalCtor.spawnAsync(file, args, opt);
+}
+
+/**
+ * Forks a batch of processes as pseudoterminals. On Unix all of them are
+ * started by a single native call, which is considerably cheaper than calling
+ * `spawn` in a loop when restoring many sessions at once.
+ * @param specs The file, arguments and options of each process.
+ * @returns The terminal of each spec, or the error that prevented it from
+ * starting.
+ */
+export function spawnMany(specs: ISpawnManySpec[]): Array<ITerminal | Error> {
+  if (process.platform !== 'win32') {
+    return terminalCtor.spawnMany(specs);
+  }
+  return specs.map(s => {
+    try {
+      return new terminalCtor(s.file, s.args, s.options);
+    } catch (e) {
+      return e as Error;
+    }
+  });
+}
+
+/**
+ * Creates a template for spawning many similar sessions. On Unix the
+ * environment, executable path and terminal settings are resolved once, each
+ * spawn from the template then only applies its own overrides.
+ * @param file The file to launch.
+ * @param args The arguments shared by all sessions.
+ * @param options The options shared by all sessions.
+ */
+export function createSpawnTemplate(file?: string, args?: ArgvOrCommandLine, opt?: IPtyForkOptions | IWindowsPtyForkOptions): ISpawnTemplate {
+  if (process.platform !== 'win32') {
+    return terminalCtor.createSpawnTemplate(file, args, opt);
+  }
+  const sessionArgs = (extra?: string[]): ArgvOrCommandLine | undefined => {
+    if (!extra || extra.length === 0) {
+      return args;
+    }
+    if (typeof args === 'string') {
+      throw new Error('args as a string cannot be extended by a spawn template.');
+    }
+    return (args || []).concat(extra);
+  };
+  const sessionOpt = (overrides: ISpawnTemplateOptions = {}): IPtyForkOptions | IWindowsPtyForkOptions => {
+    const result = assign({}, opt || {}, overrides);
+    result.env = assign({}, (opt && opt.env) || process.env, overrides.env || {});
+    return result;
+  };
+  return {
+    spawn: (extra, overrides) => new terminalCtor(file, sessionArgs(extra), sessionOpt(overrides)),
+    spawnAsync: (extra, overrides) => spawnAsync(file, sessionArgs(extra), sessionOpt(overrides))
+  };
+}
+
 /** @deprecated */
 export function fork(file?: string, args?: ArgvOrCommandLine, opt?: IPtyForkOptions | IWindowsPtyForkOptions): ITerminal {
   return new terminalCtor(file, args, opt);
@@ -45,6 +117,55 @@ export function open(options: IPtyOpenOptions): ITerminal {
   return terminalCtor.open(options);
 }
 
+/**
+ * Keeps pty pairs opened ahead of time so spawns skip allocating the device on
+ * the critical path. A background thread refills the pool once fewer than
+ * `lowWatermark` pairs are left, by default half of `size`. The pool is shared
+ * by the whole process and disabled by default. This is a no-op on Windows.
+ */
+export function configurePool(options: IPtyPoolOptions): void {
+  if (native) {
+    native.configurePool(options.size, options.lowWatermark ?? Math.ceil(options.size / 2));
+  }
+}
+
+export function getPoolStats(): IPtyPoolStats {
+  if (native) {
+    return native.getPoolStats();
+  }
+  return { size: 0, lowWatermark: 0, available: 0, hits: 0, misses: 0 };
+}
+
+/**
+ * Gets the distribution of `spawnTimings` over every terminal spawned by this
+ * process so far, per phase. Always empty on Windows.
+ */
+export function getSpawnLatencyHistogram(): ISpawnLatencyHistogram {
+  return spawnLatencyHistogram.snapshot();
+}
+
+/**
+ * Gets the I/O of every pty spawned by this process, the open ones
+ * individually and the closed ones only as part of the total, to find the
+ * noisy terminals. Always empty on Windows.
+ */
+export function getIoStats(): IPtyIoStatsSummary {
+  return ioStatsRegistry.snapshot();
+}
+
+/**
+ * Describes the foreground process of many terminals at once, like polling
+ * `process` on each of them but without blocking the event loop. Resolves with
+ * undefined for terminals that have none or closed. Always undefined on
+ * Windows.
+ */
+export function getProcessInfo(terminals: ITerminal[]): Promise<Array<IProcessInfo | undefined>> {
+  if (process.platform === 'win32') {
+    return Promise.resolve(terminals.map(() => undefined));
+  }
+  return terminalCtor.getProcessInfo(terminals);
+}
+
 /**
  * Expose the native API when not Windows, note that this is not public API and
  * could be removed at any time.
@@ -3,6 +3,8 @@
  * Copyright (c) 2018, Microsoft Corporation (MIT License).
  */
 
+import { IEvent } from './eventEmitter2';
+
 export interface IProcessEnv {
   [key: string]: string | undefined;
 }
@@ -21,8 +23,9 @@ export interface ITerminal {
   /**
    * Writes data to the socket.
    * @param data The data to write.
+   * @returns false once `writeHighWaterMark` bytes are queued.
    */
-  write(data: string | Buffer): void;
+  write(data: string | Buffer): boolean;
 
   /**
    * Resize the pty.
@@ -52,6 +55,74 @@ export interface ITerminal {
    */
   kill(signal?: string): void;
 
+  /**
+   * How long each phase of starting the process took, once the process has
+   * produced its first output or exited. Always undefined on Windows.
+   */
+  spawnTimings: ISpawnTimings | undefined;
+
+  /**
+   * How much `dataCoalescing` merged, undefined when it is not enabled.
+   */
+  dataCoalescingStats: IDataCoalescingStats | undefined;
+
+  /**
+   * The ring the output is written into when `outputRing` is set.
+   */
+  outputRing: IOutputRing | undefined;
+
+  /**
+   * The sequence number just past the output fired by onData so far, 0
+   * without `scrollback`.
+   */
+  outputSequence: number;
+
+  /**
+   * Returns the output kept by `scrollback` from seq on, up to end.
+   */
+  replayFrom(seq: number, end?: number): IScrollbackReplay;
+
+  /**
+   * Records the output, input and resizes to an asciicast v2 file at path.
+   */
+  startRecording(path: string, options?: IRecordingOptions): void;
+
+  /**
+   * Stops the recording, the file is complete shortly after.
+   */
+  stopRecording(): void;
+
+  /**
+   * Fires as `shellIntegration` sees prompts, commands and directory changes.
+   */
+  onShellIntegration: IEvent<IShellIntegrationEvent>;
+
+  /**
+   * Fires with the output as plain text when `plainText` is set.
+   */
+  onPlainText: IEvent<string>;
+
+  /**
+   * Fires once input that had to wait for room in the kernel buffer was all
+   * written.
+   */
+  onDrain: IEvent<void>;
+
+  /**
+   * The state kept by `shellIntegration`, undefined without it.
+   */
+  getShellIntegration(): IShellIntegrationState | undefined;
+
+  /**
+   * The I/O of the pty so far, undefined where it is not tracked.
+   */
+  getStats(): IPtyIoStats | undefined;
+
+  /**
+   * Resolves once the output contains one of patterns.
+   */
+  waitFor(patterns: string | Buffer | (string | Buffer)[], timeout?: number): Promise<IWaitForMatch>;
+
   /**
    * Set the pty socket encoding.
    */
@@ -67,6 +138,11 @@ export interface ITerminal {
    */
   pause(): void;
 
+  /**
+   * Acknowledge output fired by onData, see `ackFlowControl`.
+   */
+  ack(length: number): void;
+
   /**
    * Alias for ITerminal.on(eventName, listener).
    */
@@ -113,11 +189,161 @@ interface IBasePtyForkOptions {
   handleFlowControl?: boolean;
   flowControlPause?: string;
   flowControlResume?: string;
+  dataCoalescing?: IDataCoalescingOptions;
+  ackFlowControl?: IAckFlowControlOptions;
+}
+
+export interface IAckFlowControlOptions {
+  /**
+   * Pause reading once more than this is unacknowledged.
+   */
+  highWatermark?: number;
+  /**
+   * Resume reading once no more than this is unacknowledged.
+   */
+  lowWatermark?: number;
+}
+
+export interface IDataCoalescingOptions {
+  /**
+   * How long a chunk may wait for more output in milliseconds.
+   */
+  maxDelay?: number;
+  /**
+   * Flush once this many characters (or bytes without an encoding) are pending.
+   */
+  maxBatchSize?: number;
+  /**
+   * Pass output through unbatched after recent input or idle time.
+   */
+  adaptive?: boolean;
+  /**
+   * How long input counts as recent in milliseconds.
+   */
+  inputWindow?: number;
+}
+
+export interface IDataCoalescingStats {
+  /**
+   * Chunks read from the pty.
+   */
+  chunks: number;
+  /**
+   * onData events fired.
+   */
+  events: number;
+  /**
+   * Events saved by merging chunks.
+   */
+  saved: number;
+}
+
+export interface IOutputRing {
+  buffer: SharedArrayBuffer;
+  size: number;
+  head: number;
+  tail: number;
+  available: number;
+  onWrite: IEvent<number>;
+  peek(): Buffer[];
+  consume(bytes?: number): void;
 }
 
 export interface IPtyForkOptions extends IBasePtyForkOptions {
   uid?: number;
   gid?: number;
+  useNativeReader?: boolean;
+  outputRing?: number;
+  scrollback?: IScrollbackOptions;
+  shellIntegration?: IShellIntegrationOptions;
+  boundarySafeChunks?: boolean;
+  plainText?: boolean;
+  discardInputOnInterrupt?: boolean;
+  writeHighWaterMark?: number;
+  pacedInput?: boolean;
+}
+
+export interface IShellIntegrationOptions {
+  /**
+   * The number of finished commands to keep.
+   */
+  history?: number;
+}
+
+/**
+ * Offsets are of the OSC 133 markers in the output, left out if the shell
+ * did not send them.
+ */
+export interface IShellCommand {
+  promptOffset?: number;
+  inputOffset?: number;
+  outputOffset?: number;
+  endOffset?: number;
+  /**
+   * From C to D in milliseconds.
+   */
+  duration?: number;
+  exitCode?: number;
+  cwd: string;
+}
+
+export interface IShellIntegrationEvent {
+  type: 'prompt' | 'commandStart' | 'commandFinish' | 'cwd';
+  offset: number;
+  command?: IShellCommand;
+  cwd?: string;
+}
+
+export interface IShellIntegrationState {
+  cwd: string;
+  commands: IShellCommand[];
+  current?: IShellCommand;
+}
+
+export interface IScrollbackOptions {
+  /**
+   * The number of bytes of output to keep.
+   */
+  limit: number;
+  spill?: IScrollbackSpillOptions;
+}
+
+export interface IScrollbackSpillOptions {
+  /**
+   * Where the segment files are created.
+   */
+  directory: string;
+  segmentSize?: number;
+}
+
+export interface IScrollbackReplay {
+  seq: number;
+  truncated: boolean;
+  data: string;
+  /**
+   * Why the log stopped keeping output, set once a segment file could not be
+   * created.
+   */
+  error?: string;
+}
+
+export interface IWaitForMatch {
+  /**
+   * The index of the pattern that matched.
+   */
+  index: number;
+  /**
+   * The offset of the first byte of the match in the output.
+   */
+  offset: number;
+}
+
+export interface IRecordingOptions {
+  /**
+   * Whether to record what is written to the pty, defaults to true.
+   */
+  input?: boolean;
+  title?: string;
 }
 
 export interface IWindowsPtyForkOptions extends IBasePtyForkOptions {
@@ -134,8 +360,170 @@ export interface IWindowsPtyForkOptions extends IBasePtyForkOptions {
   conptyInheritCursor?: boolean;
 }
 
+export interface ISpawnManySpec {
+  file?: string;
+  args?: string[] | string;
+  options?: IPtyForkOptions | IWindowsPtyForkOptions;
+}
+
+/**
+ * The per-session overrides of a spawn template.
+ */
+export interface ISpawnTemplateOptions {
+  cols?: number;
+  rows?: number;
+  cwd?: string;
+  /**
+   * Variables added to or replacing those of the template's environment.
+   */
+  env?: IProcessEnv;
+}
+
+export interface ISpawnTemplate<T extends ITerminal = ITerminal> {
+  /**
+   * Spawns a session, `args` are appended to the template's arguments.
+   */
+  spawn(args?: string[], options?: ISpawnTemplateOptions): T;
+  spawnAsync(args?: string[], options?: ISpawnTemplateOptions): Promise<T>;
+}
+
+export interface IPtyPoolOptions {
+  /**
+   * The number of pty pairs to keep opened, 0 disables the pool.
+   */
+  size: number;
+  /**
+   * Refill the pool once fewer pairs than this are left.
+   */
+  lowWatermark?: number;
+}
+
+export interface IPtyPoolStats {
+  size: number;
+  lowWatermark: number;
+  available: number;
+  /**
+   * Spawns that took a pair from the pool.
+   */
+  hits: number;
+  /**
+   * Spawns that found the pool empty and opened their own pair.
+   */
+  misses: number;
+}
+
 export interface IPtyOpenOptions {
   cols?: number;
   rows?: number;
   encoding?: string | null;
 }
+
+/**
+ * How long each phase of a spawn took in milliseconds. Phases the platform
+ * does not go through, or that have not happened, are undefined.
+ */
+export interface ISpawnTimings {
+  /**
+   * Copying the arguments out of JS.
+   */
+  marshal: number;
+  /**
+   * Opening the pty, or taking it from the pool.
+   */
+  openpty: number;
+  /**
+   * The posix_spawn or fork call itself.
+   */
+  spawn: number;
+  /**
+   * From starting the spawn until spawn-helper ran.
+   */
+  helper?: number;
+  ctty?: number;
+  chdir?: number;
+  setuid?: number;
+  closeFds?: number;
+  /**
+   * From exec until the first output of the process.
+   */
+  exec?: number;
+  /**
+   * From starting the spawn until the first output of the process.
+   */
+  firstOutput?: number;
+}
+
+export interface ISpawnPhaseHistogram {
+  count: number;
+  sum: number;
+  max: number;
+  /**
+   * The number of samples in each bucket of `ISpawnLatencyHistogram.bounds`.
+   */
+  counts: number[];
+}
+
+export interface ISpawnLatencyHistogram {
+  /**
+   * Inclusive upper bounds of the buckets in milliseconds.
+   */
+  bounds: number[];
+  phases: { [phase in keyof ISpawnTimings]?: ISpawnPhaseHistogram };
+}
+
+/**
+ * The I/O a pty did so far, see `ITerminal.getStats`. Times are in
+ * milliseconds, queues are what is waiting right now.
+ */
+export interface IPtyIoStats {
+  bytesRead: number;
+  bytesWritten: number;
+  /**
+   * Reads that returned output, writes including those that hit EAGAIN.
+   */
+  reads: number;
+  writes: number;
+  /**
+   * The number of reads in each bucket of `readSizeBounds`.
+   */
+  readSizes: number[];
+  readSizeBounds: number[];
+  /**
+   * Writes that found the kernel buffer full, so the rest waited for it.
+   */
+  writeRetries: number;
+  /**
+   * How long reading stopped because of `pause` or a consumer that fell
+   * behind, and how long writes waited for room in the kernel buffer.
+   */
+  pausedTime: number;
+  backpressuredTime: number;
+  /**
+   * Bytes read but not yet delivered, and writes and their bytes not yet
+   * written.
+   */
+  readQueue: number;
+  writeQueue: number;
+  writeQueueBytes: number;
+}
+
+export interface IPtyIoStatsSummary {
+  /**
+   * Summed over every pty this process spawned, including those that closed.
+   */
+  total: IPtyIoStats;
+  /**
+   * The ptys that are still open.
+   */
+  terminals: Array<{ pid: number, stats: IPtyIoStats }>;
+}
+
+/**
+ * The foreground process of a pty, see `getProcessInfo`.
+ */
+export interface IProcessInfo {
+  pid: number;
+  name: string;
+  argv: string[];
+  cwd: string | undefined;
+}
@@ -0,0 +1,54 @@
+/**
+ * Copyright (c) 2026, Microsoft Corporation (MIT License).
+ */
+
+import * as assert from 'assert';
+import { IPtyIoStats } from './interfaces';
+import { IoStatsRegistry, READ_SIZE_BOUNDS, createIoStats, emptyIoStats, readSizeBucket } from './ioStats';
+
+function stats(bytesRead: number, writeQueue: number): IPtyIoStats {
+  const sizes = READ_SIZE_BOUNDS.map(() => 0);
+  sizes[readSizeBucket(bytesRead)] = 1;
+  return createIoStats(
+    { reads: 1, bytes: bytesRead, sizes, pending: 0, pausedTime: 2 },
+    { writes: 3, bytes: 10, retries: 1, backpressuredTime: 0.5, queue: writeQueue, queueBytes: writeQueue * 100 }
+  );
+}
+
+describe('readSizeBucket', () => {
+  it('should bucket sizes by their inclusive upper bound', () => {
+    assert.strictEqual(readSizeBucket(1), 0);
+    assert.strictEqual(readSizeBucket(16), 0);
+    assert.strictEqual(readSizeBucket(17), 1);
+    assert.strictEqual(readSizeBucket(4096), READ_SIZE_BOUNDS.indexOf(4096));
+    assert.strictEqual(readSizeBucket(65537), READ_SIZE_BOUNDS.length - 1);
+  });
+});
+
+describe('IoStatsRegistry', () => {
+  it('should sum the open and closed sources', () => {
+    const registry = new IoStatsRegistry();
+    const a = { pid: 1, getStats: () => stats(10, 1) };
+    const b = { pid: 2, getStats: () => stats(5000, 2) };
+    registry.add(a);
+    registry.add(b);
+    registry.retire(a);
+    registry.retire(a);
+    const snapshot = registry.snapshot();
+    assert.deepStrictEqual(snapshot.terminals.map(t => t.pid), [2]);
+    const total = snapshot.total;
+    assert.strictEqual(total.bytesRead, 5010);
+    assert.strictEqual(total.reads, 2);
+    assert.strictEqual(total.writes, 6);
+    assert.strictEqual(total.writeRetries, 2);
+    assert.strictEqual(total.pausedTime, 4);
+    assert.strictEqual(total.readSizes[0], 1);
+    assert.strictEqual(total.readSizes[readSizeBucket(5000)], 1);
+    // Only the queues of open sources count.
+    assert.strictEqual(total.writeQueue, 2);
+    assert.strictEqual(total.writeQueueBytes, 200);
+  });
+  it('should be empty without sources', () => {
+    assert.deepStrictEqual(new IoStatsRegistry().snapshot(), { total: emptyIoStats(), terminals: [] });
+  });
+});
@@ -0,0 +1,185 @@
+/**
+ * Copyright (c) 2026, Microsoft Corporation (MIT License).
+ */
+
+import { Socket } from 'net';
+import { IPtyIoStats, IPtyIoStatsSummary } from './interfaces';
+import { hrtimeNs } from './spawnTimings';
+
+/**
+ * Upper bounds in bytes of the read size buckets, the last one catches
+ * everything larger. Must match kSizeBuckets in reader.h.
+ */
+export const READ_SIZE_BOUNDS: number[] = [16, 64, 256, 1024, 4096, 16384, 65536, Infinity];
+
+/**
+ * The read side of `IPtyIoStats`, from the native reader or `SocketReadStats`.
+ */
+export interface IReadStats {
+  reads: number;
+  bytes: number;
+  sizes: number[];
+  pending: number;
+  pausedTime: number;
+}
+
+/**
+ * The write side of `IPtyIoStats`, from the write stream of the terminal.
+ */
+export interface IWriteStats {
+  writes: number;
+  bytes: number;
+  retries: number;
+  backpressuredTime: number;
+  queue: number;
+  queueBytes: number;
+}
+
+export function readSizeBucket(size: number): number {
+  let i = 0;
+  while (size > READ_SIZE_BOUNDS[i]) {
+    i++;
+  }
+  return i;
+}
+
+export function createIoStats(read: IReadStats, write: IWriteStats): IPtyIoStats {
+  return {
+    bytesRead: read.bytes,
+    bytesWritten: write.bytes,
+    reads: read.reads,
+    writes: write.writes,
+    readSizes: read.sizes.slice(),
+    readSizeBounds: READ_SIZE_BOUNDS.slice(),
+    writeRetries: write.retries,
+    pausedTime: read.pausedTime,
+    backpressuredTime: write.backpressuredTime,
+    readQueue: read.pending,
+    writeQueue: write.queue,
+    writeQueueBytes: write.queueBytes
+  };
+}
+
+/**
+ * Counts the reads of a `tty.ReadStream`. Each 'data' event is one read(2) by
+ * libuv, whose size is taken from `bytesRead` so decoded strings are never
+ * measured.
+ */
+export class SocketReadStats {
+  private _reads: number = 0;
+  private _bytes: number = 0;
+  private _sizes: number[] = READ_SIZE_BOUNDS.map(() => 0);
+  private _pausedTime: number = 0;
+  private _pausedSince: number | undefined;
+
+  constructor(private readonly _socket: Socket) {
+    _socket.on('data', () => {
+      const size = _socket.bytesRead - this._bytes;
+      // Chunks buffered while paused were all counted by the first of them.
+      if (size > 0) {
+        this._reads++;
+        this._bytes += size;
+        this._sizes[readSizeBucket(size)]++;
+      }
+    });
+    _socket.on('pause', () => {
+      if (this._pausedSince === undefined) {
+        this._pausedSince = hrtimeNs();
+      }
+    });
+    _socket.on('resume', () => {
+      if (this._pausedSince !== undefined) {
+        this._pausedTime += (hrtimeNs() - this._pausedSince) / 1e6;
+        this._pausedSince = undefined;
+      }
+    });
+  }
+
+  public snapshot(): IReadStats {
+    const paused = this._pausedSince !== undefined ? (hrtimeNs() - this._pausedSince) / 1e6 : 0;
+    return {
+      reads: this._reads,
+      bytes: this._bytes,
+      sizes: this._sizes.slice(),
+      pending: this._socket.readableLength,
+      pausedTime: this._pausedTime + paused
+    };
+  }
+}
+
+/**
+ * Anything whose I/O is summed by `IoStatsRegistry`.
+ */
+export interface IIoStatsSource {
+  readonly pid: number;
+  getStats(): IPtyIoStats | undefined;
+}
+
+/**
+ * Keeps the ptys of the process that are open, and the sum of the I/O of
+ * those that closed. Nothing is counted here, it only asks each pty for its
+ * counters when a snapshot is taken.
+ */
+export class IoStatsRegistry {
+  private _open = new Set<IIoStatsSource>();
+  private _closed: IPtyIoStats = emptyIoStats();
+
+  public add(source: IIoStatsSource): void {
+    this._open.add(source);
+  }
+
+  /**
+   * Folds the final counters of source into the total, its queues are
+   * dropped.
+   */
+  public retire(source: IIoStatsSource): void {
+    if (!this._open.delete(source)) {
+      return;
+    }
+    const stats = source.getStats();
+    if (stats) {
+      addIoStats(this._closed, stats, false);
+    }
+  }
+
+  public snapshot(): IPtyIoStatsSummary {
+    const total = emptyIoStats();
+    addIoStats(total, this._closed, false);
+    const terminals: Array<{ pid: number, stats: IPtyIoStats }> = [];
+    this._open.forEach(source => {
+      const stats = source.getStats();
+      if (stats) {
+        addIoStats(total, stats, true);
+        terminals.push({ pid: source.pid, stats });
+      }
+    });
+    return { total, terminals };
+  }
+}
+
+export function emptyIoStats(): IPtyIoStats {
+  return createIoStats(
+    { reads: 0, bytes: 0, sizes: READ_SIZE_BOUNDS.map(() => 0), pending: 0, pausedTime: 0 },
+    { writes: 0, bytes: 0, retries: 0, backpressuredTime: 0, queue: 0, queueBytes: 0 }
+  );
+}
+
+function addIoStats(to: IPtyIoStats, from: IPtyIoStats, queues: boolean): void {
+  to.bytesRead += from.bytesRead;
+  to.bytesWritten += from.bytesWritten;
+  to.reads += from.reads;
+  to.writes += from.writes;
+  for (let i = 0; i < to.readSizes.length; i++) {
+    to.readSizes[i] += from.readSizes[i];
+  }
+  to.writeRetries += from.writeRetries;
+  to.pausedTime += from.pausedTime;
+  to.backpressuredTime += from.backpressuredTime;
+  if (queues) {
+    to.readQueue += from.readQueue;
+    to.writeQueue += from.writeQueue;
+    to.writeQueueBytes += from.writeQueueBytes;
+  }
+}
+
+export const ioStatsRegistry = new IoStatsRegistry();
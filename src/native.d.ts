@@ -11,12 +11,101 @@ interface IConptyNative {
 }
 
 interface IUnixNative {
-  fork(file: string, args: string[], parsedEnv: string[], cwd: string, cols: number, rows: number, uid: number, gid: number, useUtf8: boolean, helperPath: string, onExitCallback: (code: number, signal: number) => void): IUnixProcess;
+  fork(file: string, args: string[], parsedEnv: string[], cwd: string, cols: number, rows: number, uid: number, gid: number, useUtf8: boolean, helperPath: string, onExitCallback: (code: number, signal: number, usage: IUnixResourceUsage | undefined) => void): IUnixProcess;
+  forkAsync(file: string, args: string[], parsedEnv: string[], cwd: string, cols: number, rows: number, uid: number, gid: number, useUtf8: boolean, helperPath: string, onExitCallback: (code: number, signal: number, usage: IUnixResourceUsage | undefined) => void): Promise<IUnixProcess>;
+  forkMany(specs: UnixForkManySpec[], onExitCallback: (pid: number, code: number, signal: number, usage: IUnixResourceUsage | undefined) => void): Array<IUnixProcess | { error: string }>;
   open(cols: number, rows: number): IUnixOpenProcess;
+  Recording: new(path: string, cols: number, rows: number, title: string, term: string) => IUnixRecording;
+  Scrollback: new(limit: number, directory?: string, segmentSize?: number) => IUnixScrollback;
+  ShellTracker: new(history: number) => IUnixShellTracker;
+  Writer: new(fd: number, slave: string, discardOnInterrupt: boolean, paced: boolean, callback: (errno: number) => void) => IUnixWriter;
+  SpawnTemplate: new(file: string, args: string[], parsedEnv: string[], cwd: string, cols: number, rows: number, uid: number, gid: number, useUtf8: boolean, helperPath: string) => IUnixSpawnTemplate;
   process(fd: number, pty?: string): string;
+  getProcessInfo(fds: number[]): Promise<Array<IUnixProcessInfo | undefined>>;
+  configurePool(size: number, lowWatermark: number): void;
+  getPoolStats(): { size: number, lowWatermark: number, available: number, hits: number, misses: number };
+  readSpawnTimings(timingFd: number): number[];
+  startReading(fd: number, onData: (data: Buffer | number | IUnixShellEvent[] | null, errno?: number) => void, options?: IUnixReadOptions): number;
+  pauseReading(id: number): void;
+  resumeReading(id: number): void;
+  ringConsumed(id: number): void;
+  recordOutput(id: number, recording: IUnixRecording | null): void;
+  waitFor(id: number, patterns: Buffer[], callback: (index: number, offset: number) => void): number;
+  cancelWait(id: number, wait: number): void;
+  readStats(id: number): IUnixReadStats | null;
+  stopReading(id: number): void;
   resize(fd: number, cols: number, rows: number, pixelWidth: number, pixelHeight: number): void;
 }
 
+type UnixForkManySpec = [file: string, args: string[], parsedEnv: string[], cwd: string, cols: number, rows: number, uid: number, gid: number, useUtf8: boolean, helperPath: string];
+
+interface IUnixScrollback {
+  read(seq: number, end: number): { seq: number, data: Buffer, error?: string };
+  range(): [start: number, end: number];
+}
+
+interface IUnixReadOptions {
+  ring?: Uint8Array | null;
+  scrollback?: IUnixScrollback | null;
+  tracker?: IUnixShellTracker | null;
+  holdPartial?: boolean;
+  plain?: ((data: Buffer) => void) | null;
+}
+
+interface IUnixReadStats {
+  reads: number;
+  wouldBlock: number;
+  bytes: number;
+  sizes: number[];
+  pending: number;
+  stalledTime: number;
+}
+
+interface IUnixShellTracker {
+  snapshot(): { cwd: string, commands: IUnixShellCommand[], current?: IUnixShellCommand };
+}
+
+interface IUnixShellCommand {
+  promptOffset?: number;
+  inputOffset?: number;
+  outputOffset?: number;
+  endOffset?: number;
+  duration?: number;
+  exitCode?: number;
+  cwd: string;
+}
+
+interface IUnixShellEvent {
+  type: 'prompt' | 'commandStart' | 'commandFinish' | 'cwd';
+  offset: number;
+  command?: IUnixShellCommand;
+  cwd?: string;
+}
+
+interface IUnixRecording {
+  resize(cols: number, rows: number): void;
+  close(): void;
+}
+
+interface IUnixProcessInfo {
+  pid: number;
+  name: string;
+  argv: string[];
+  cwd: string | undefined;
+}
+
+interface IUnixWriter {
+  write(data: string | Buffer): number;
+  record(recording: IUnixRecording | null): void;
+  stats(): { writes: number, bytes: number, retries: number, backpressuredTime: number, queue: number, queueBytes: number };
+  close(): void;
+}
+
+interface IUnixSpawnTemplate {
+  fork(args: string[], parsedEnv: string[], cwd: string, cols: number, rows: number, onExitCallback: (code: number, signal: number, usage: IUnixResourceUsage | undefined) => void): IUnixProcess;
+  forkAsync(args: string[], parsedEnv: string[], cwd: string, cols: number, rows: number, onExitCallback: (code: number, signal: number, usage: IUnixResourceUsage | undefined) => void): Promise<IUnixProcess>;
+}
+
 interface IConptyProcess {
   pty: number;
   fd: number;
@@ -28,6 +117,21 @@ interface IUnixProcess {
   fd: number;
   pid: number;
   pty: string;
+  /**
+   * uv_hrtime() when the fork started, had marshalled its arguments, had
+   * opened the pty and had started the process.
+   */
+  timestamps: [number, number, number, number];
+  timingFd: number;
+}
+
+interface IUnixResourceUsage {
+  userTime: number;
+  systemTime: number;
+  maxRss: number;
+  voluntaryContextSwitches: number;
+  involuntaryContextSwitches: number;
+  lifetime: number;
 }
 
 interface IUnixOpenProcess {
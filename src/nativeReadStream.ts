@@ -0,0 +1,249 @@
+/**
+ * Copyright (c) 2026, Microsoft Corporation (MIT License).
+ */
+
+import { constants } from 'os';
+import { Readable } from 'stream';
+import { StringDecoder } from 'string_decoder';
+import { getSystemErrorName } from 'util';
+import { IReadStats } from './ioStats';
+import { OutputRing } from './outputRing';
+
+/**
+ * The native functions backing `NativeReadStream`, see reader.h.
+ */
+export interface INativeReader {
+  startReading(fd: number, onData: (data: Buffer | number | IUnixShellEvent[] | null, errno?: number) => void, options?: IUnixReadOptions): number;
+  pauseReading(id: number): void;
+  resumeReading(id: number): void;
+  ringConsumed(id: number): void;
+  recordOutput(id: number, recording: IUnixRecording | null): void;
+  waitFor(id: number, patterns: Buffer[], callback: (index: number, offset: number) => void): number;
+  cancelWait(id: number, wait: number): void;
+  readStats(id: number): IUnixReadStats | null;
+  stopReading(id: number): void;
+}
+
+/**
+ * Where the output goes besides the stream.
+ */
+export interface INativeReadStreamOptions {
+  ring?: OutputRing;
+  scrollback?: IUnixScrollback;
+  tracker?: IUnixShellTracker;
+  /**
+   * Never split a UTF-8 sequence or escape sequence across chunks, see
+   * reader.h. Not supported with a ring.
+   */
+  holdPartial?: boolean;
+  /**
+   * Called with the output as plain text, see stripper.h.
+   */
+  plain?: (data: Buffer) => void;
+}
+
+// A decoder holds at most the first 3 bytes of a 4 byte UTF-8 sequence.
+const MAX_UTF8_HELD_BYTES = 3;
+
+/**
+ * The number of bytes at the end of tail that start a UTF-8 sequence it cuts
+ * short, looking back like boundary.cc does.
+ */
+function utf8HeldBytes(tail: Buffer): number {
+  for (let i = 1; i <= tail.length; i++) {
+    const byte = tail[tail.length - i];
+    if ((byte & 0xC0) === 0x80) {
+      continue;
+    }
+    const length = byte >= 0xF8 ? 1 : byte >= 0xF0 ? 4 : byte >= 0xE0 ? 3 : byte >= 0xC0 ? 2 : 1;
+    return length > i ? i : 0;
+  }
+  return 0;
+}
+
+/**
+ * Reads a pty master on the shared native reader thread rather than through a
+ * `tty.ReadStream`. Ends on EOF or EIO, which is how the master reports that
+ * the process went away, and takes ownership of the fd, which is closed once
+ * the stream is destroyed.
+ *
+ * Given a ring the output is written into it instead and the stream never
+ * emits data, it only ends. Given a scrollback log the output is appended to
+ * it as well. Given a tracker its events are emitted as 'shellEvent'.
+ */
+export class NativeReadStream extends Readable {
+  private _id: number;
+  private _reading: boolean = true;
+  private _bytesRead: number = 0;
+  private _bytesEmitted: number = 0;
+  private _head: number = 0;
+  // The bytes of each chunk queued in the stream, in the order they are
+  // emitted as data, and those passed to the decoder since the last chunk,
+  // the last few of which are kept in _decodedTail for UTF-8.
+  private _chunkBytes: number[] = [];
+  private _decodedBytes: number = 0;
+  private _decodedTail: Buffer = Buffer.alloc(0);
+  // Mirrors the decoder of the stream to tell which pushes queue a chunk.
+  private _decoder: StringDecoder | undefined;
+  private _finalStats: IUnixReadStats | undefined;
+
+  private readonly _ring: OutputRing | undefined;
+
+  constructor(
+    private readonly _reader: INativeReader,
+    fd: number,
+    options: INativeReadStreamOptions = {}
+  ) {
+    super({ autoDestroy: true });
+    const onData = (data: Buffer | number | IUnixShellEvent[] | null, errno?: number): void => this._onData(data, errno);
+    const ring = this._ring = options.ring;
+    const id = this._id = _reader.startReading(fd, onData, {
+      ring: ring ? new Uint8Array(ring.buffer) : null,
+      scrollback: options.scrollback,
+      tracker: options.tracker,
+      holdPartial: options.holdPartial,
+      plain: options.plain
+    });
+    if (ring) {
+      ring._attach(() => _reader.ringConsumed(id));
+    }
+  }
+
+  /**
+   * Starts or, given null, stops queueing the output to a recording as it is
+   * read.
+   */
+  public record(recording: IUnixRecording | null): void {
+    this._reader.recordOutput(this._id, recording);
+  }
+
+  /**
+   * Calls callback once the output pushed from now on contains one of
+   * patterns, see reader.h. Returns an id for `cancelWait`.
+   */
+  public waitFor(patterns: Buffer[], callback: (index: number, offset: number) => void): number {
+    return this._reader.waitFor(this._id, patterns, callback);
+  }
+
+  public cancelWait(wait: number): void {
+    this._reader.cancelWait(this._id, wait);
+  }
+
+  /**
+   * The counters the native reader keeps, see reader.h. The last ones are
+   * kept once the stream is destroyed.
+   */
+  public stats(): IReadStats {
+    const stats = this._finalStats || this._reader.readStats(this._id)!;
+    return {
+      reads: stats.reads,
+      bytes: stats.bytes,
+      sizes: stats.sizes,
+      pending: this._ring ? this._ring.available : stats.pending,
+      pausedTime: stats.stalledTime
+    };
+  }
+
+  /**
+   * The number of bytes read and handed to the stream or ring so far.
+   */
+  public get bytesRead(): number { return this._bytesRead; }
+
+  /**
+   * The number of bytes emitted as data so far, including the chunk whose
+   * listeners are running. Output buffered while the stream is paused is not
+   * counted until it is emitted.
+   */
+  public get bytesEmitted(): number { return this._bytesEmitted; }
+
+  public setEncoding(encoding: BufferEncoding): this {
+    this._decoder = new StringDecoder(encoding);
+    return super.setEncoding(encoding);
+  }
+
+  public emit(event: string | symbol, ...args: any[]): boolean {
+    if (event === 'data') {
+      this._bytesEmitted += this._chunkBytes.shift() || 0;
+    }
+    return super.emit(event, ...args);
+  }
+
+  private _onData(data: Buffer | number | IUnixShellEvent[] | null, errno?: number): void {
+    if (Array.isArray(data)) {
+      for (const event of data) {
+        this.emit('shellEvent', event);
+      }
+      return;
+    }
+    if (typeof data === 'number') {
+      this._bytesRead += (data - this._head) >>> 0;
+      this._head = data;
+      this._ring!._notify(data);
+      return;
+    }
+    if (data) {
+      this._bytesRead += data.length;
+      this._queueChunk(data);
+      if (!this.push(data) && this._reading) {
+        this._reading = false;
+        this._reader.pauseReading(this._id);
+      }
+      return;
+    }
+    if (errno && errno !== constants.errno.EIO) {
+      // Shaped like the errors of tty.ReadStream.
+      const code = getSystemErrorName(-errno);
+      const err: NodeJS.ErrnoException = new Error(`read ${code}`);
+      err.code = code;
+      err.errno = -errno;
+      err.syscall = 'read';
+      this.destroy(err);
+      return;
+    }
+    if (this._decoder?.end()) {
+      // The stream emits what its decoder still holds as a last chunk.
+      this._chunkBytes.push(this._decodedBytes);
+    }
+    this.push(null);
+  }
+
+  private _queueChunk(data: Buffer): void {
+    if (!this._decoder) {
+      if (data.length > 0) {
+        this._chunkBytes.push(data.length);
+      }
+      return;
+    }
+    this._decodedBytes += data.length;
+    const encoding = this.readableEncoding!;
+    if (encoding === 'utf8') {
+      const tail = data.length >= MAX_UTF8_HELD_BYTES ? data : Buffer.concat([this._decodedTail, data]);
+      this._decodedTail = tail.subarray(Math.max(0, tail.length - MAX_UTF8_HELD_BYTES));
+    }
+    const decoded = this._decoder.write(data);
+    if (!decoded) {
+      return;
+    }
+    // The bytes of a partial character are emitted with the next chunk.
+    // Invalid UTF-8 decodes to U+FFFD, which has its own length, so the
+    // held bytes are found in the input there.
+    const held = encoding === 'utf8'
+      ? Math.min(utf8HeldBytes(this._decodedTail), this._decodedBytes)
+      : this._decodedBytes - Buffer.byteLength(decoded, encoding);
+    this._chunkBytes.push(this._decodedBytes - held);
+    this._decodedBytes = held;
+  }
+
+  public _read(): void {
+    if (!this._reading) {
+      this._reading = true;
+      this._reader.resumeReading(this._id);
+    }
+  }
+
+  public _destroy(err: Error | null, callback: (err: Error | null) => void): void {
+    this._finalStats = this._reader.readStats(this._id) || undefined;
+    this._reader.stopReading(this._id);
+    callback(err);
+  }
+}
@@ -0,0 +1,96 @@
+/**
+ * Copyright (c) 2026, Microsoft Corporation (MIT License).
+ */
+
+import { EventEmitter2, IEvent } from './eventEmitter2';
+import { IOutputRing } from './interfaces';
+
+/**
+ * The size of the header holding the counters, see reader::kRingHeaderSize.
+ */
+export const RING_HEADER_SIZE = 64;
+
+const HEAD = 0;
+const TAIL = 1;
+
+/**
+ * Throws unless `size` is a valid data size for a ring.
+ */
+export function checkRingSize(size: number): void {
+  if (!Number.isInteger(size) || size <= 0 || size > 0x80000000 || (size & (size - 1)) !== 0) {
+    throw new Error('outputRing must be a power of two no larger than 2^31.');
+  }
+}
+
+/**
+ * A ring in shared memory the native reader writes the output of a pty into.
+ *
+ * The header holds two uint32 byte counters that only ever grow, wrapping at
+ * 2^32: head, advanced by the reader thread, and tail, advanced by
+ * `consume`. The bytes between them are unread. While the ring is full the
+ * output is left in the kernel, which blocks the process once its buffer is
+ * full too.
+ */
+export class OutputRing implements IOutputRing {
+  public readonly buffer: SharedArrayBuffer;
+  public readonly size: number;
+
+  private readonly _counters: Uint32Array;
+  private _consumed: (() => void) | undefined;
+
+  private _onWrite = new EventEmitter2<number>();
+  public get onWrite(): IEvent<number> { return this._onWrite.event; }
+
+  constructor(size: number) {
+    checkRingSize(size);
+    this.size = size;
+    this.buffer = new SharedArrayBuffer(RING_HEADER_SIZE + size);
+    this._counters = new Uint32Array(this.buffer, 0, 2);
+  }
+
+  public get head(): number { return Atomics.load(this._counters, HEAD); }
+  public get tail(): number { return Atomics.load(this._counters, TAIL); }
+  public get available(): number { return (this.head - this.tail) >>> 0; }
+
+  /**
+   * Returns views of the unread output without copying it, two when it wraps
+   * around the end of the ring. They are only valid until `consume`.
+   */
+  public peek(): Buffer[] {
+    const available = this.available;
+    if (available === 0) {
+      return [];
+    }
+    const offset = this.tail & (this.size - 1);
+    const first = Math.min(available, this.size - offset);
+    const views = [Buffer.from(this.buffer, RING_HEADER_SIZE + offset, first)];
+    if (first < available) {
+      views.push(Buffer.from(this.buffer, RING_HEADER_SIZE, available - first));
+    }
+    return views;
+  }
+
+  /**
+   * Marks `bytes` of the output, by default all of it, as read, which lets
+   * the reader use that space again.
+   */
+  public consume(bytes: number = this.available): void {
+    const tail = this.tail;
+    Atomics.store(this._counters, TAIL, (tail + Math.min(bytes, this.available)) >>> 0);
+    this._consumed?.();
+  }
+
+  /**
+   * Internal, connects the ring to the reader that fills it.
+   */
+  public _attach(consumed: () => void): void {
+    this._consumed = consumed;
+  }
+
+  /**
+   * Internal, called by the reader with the new head after writing.
+   */
+  public _notify(head: number): void {
+    this._onWrite.fire(head);
+  }
+}
@@ -0,0 +1,41 @@
+/**
+ * Copyright (c) 2026, Microsoft Corporation (MIT License).
+ */
+
+import { IScrollbackReplay } from './interfaces';
+
+/**
+ * Replays the output of a terminal from a native scrollback log, see
+ * scrollback.h. Output is addressed by the sequence number of each byte, the
+ * number of bytes read from the pty before it.
+ */
+export class Scrollback {
+  constructor(
+    private readonly _log: IUnixScrollback,
+    private readonly _sequence: () => number,
+    private readonly _encoding: BufferEncoding | null
+  ) {
+  }
+
+  /**
+   * The sequence number just past the output handed to the consumer so far,
+   * by onData or the output ring.
+   */
+  public get sequence(): number { return this._sequence(); }
+
+  public replayFrom(seq: number, end?: number): IScrollbackReplay {
+    // Output that was read but is still buffered by a paused stream or the
+    // coalescer arrives through onData later, don't replay it twice.
+    const sequence = this.sequence;
+    const result = this._log.read(seq, end === undefined ? sequence : Math.min(end, sequence));
+    const replay: IScrollbackReplay = {
+      seq: result.seq,
+      truncated: result.seq > seq,
+      data: this._encoding ? result.data.toString(this._encoding) : result.data as any
+    };
+    if (result.error !== undefined) {
+      replay.error = result.error;
+    }
+    return replay;
+  }
+}
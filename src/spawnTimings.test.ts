@@ -0,0 +1,51 @@
+/**
+ * Copyright (c) 2026, Microsoft Corporation (MIT License).
+ */
+
+import * as assert from 'assert';
+import { computeSpawnTimings, SpawnLatencyHistogram, SPAWN_LATENCY_BOUNDS } from './spawnTimings';
+
+describe('computeSpawnTimings', () => {
+  it('should compute the duration of each phase in milliseconds', () => {
+    const timings = computeSpawnTimings([0, 1e5, 3e5, 7e5], [6e5, 8e5, 9e5, 1e6, 2e6, 2.5e6], 5e6);
+    assert.deepStrictEqual(timings, {
+      marshal: 0.1,
+      openpty: 0.2,
+      spawn: 0.4,
+      helper: 0.3,
+      ctty: 0.2,
+      chdir: 0.1,
+      setuid: 0.1,
+      closeFds: 1,
+      exec: 2.5,
+      firstOutput: 5
+    });
+  });
+  it('should leave phases that were not reported undefined', () => {
+    const timings = computeSpawnTimings([0, 1e6, 2e6, 3e6], [], undefined);
+    assert.strictEqual(timings.spawn, 1);
+    assert.strictEqual(timings.helper, undefined);
+    assert.strictEqual(timings.exec, undefined);
+    assert.strictEqual(timings.firstOutput, undefined);
+  });
+});
+
+describe('SpawnLatencyHistogram', () => {
+  it('should bucket each phase by its upper bound', () => {
+    const histogram = new SpawnLatencyHistogram();
+    histogram.record({ marshal: 0.05, openpty: 3, spawn: 5000 });
+    histogram.record({ marshal: 0.06, openpty: 3, spawn: 1 });
+    const snapshot = histogram.snapshot();
+    assert.deepStrictEqual(snapshot.bounds, SPAWN_LATENCY_BOUNDS);
+    assert.deepStrictEqual(Object.keys(snapshot.phases), ['marshal', 'openpty', 'spawn']);
+    const marshal = snapshot.phases.marshal!;
+    assert.strictEqual(marshal.count, 2);
+    assert.strictEqual(marshal.max, 0.06);
+    assert.strictEqual(marshal.counts[0], 1);
+    assert.strictEqual(marshal.counts[1], 1);
+    const spawn = snapshot.phases.spawn!;
+    assert.strictEqual(spawn.counts[SPAWN_LATENCY_BOUNDS.indexOf(1)], 1);
+    assert.strictEqual(spawn.counts[SPAWN_LATENCY_BOUNDS.length - 1], 1);
+    assert.strictEqual(spawn.sum, 5001);
+  });
+});
@@ -0,0 +1,98 @@
+/**
+ * Copyright (c) 2026, Microsoft Corporation (MIT License).
+ */
+
+import { ISpawnLatencyHistogram, ISpawnPhaseHistogram, ISpawnTimings } from './interfaces';
+
+/**
+ * The phases of a spawn in the order they happen.
+ */
+export const SPAWN_PHASES: Array<keyof ISpawnTimings> = [
+  'marshal', 'openpty', 'spawn', 'helper', 'ctty', 'chdir', 'setuid', 'closeFds', 'exec', 'firstOutput'
+];
+
+/**
+ * Upper bounds in milliseconds of the histogram buckets, the last one catches
+ * everything slower.
+ */
+export const SPAWN_LATENCY_BOUNDS: number[] = [
+  0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 25, 50, 100, 250, 500, 1000, Infinity
+];
+
+/**
+ * The current time in nanoseconds on the clock of `uv_hrtime`, which is what
+ * the native side timestamps spawns with.
+ */
+export function hrtimeNs(): number {
+  const time = process.hrtime();
+  return time[0] * 1e9 + time[1];
+}
+
+/**
+ * Turns the timestamps of a spawn into the duration of each phase.
+ * @param timestamps When the native fork call started, had marshalled its
+ * arguments, had opened the pty and had started the process.
+ * @param helper When spawn-helper started, had acquired the controlling
+ * terminal, changed directory, changed user, closed inherited fds and was
+ * about to exec. Empty when the platform does not spawn through the helper.
+ * @param firstOutput When the first output of the process was read, if it
+ * produced any.
+ */
+export function computeSpawnTimings(timestamps: number[], helper: number[], firstOutput: number | undefined): ISpawnTimings {
+  const ms = (from: number | undefined, to: number | undefined): number | undefined => {
+    return from === undefined || to === undefined ? undefined : Math.max(0, to - from) / 1e6;
+  };
+  const [started, marshalled, opened, spawned] = timestamps;
+  return {
+    marshal: ms(started, marshalled)!,
+    openpty: ms(marshalled, opened)!,
+    spawn: ms(opened, spawned)!,
+    helper: ms(opened, helper[0]),
+    ctty: ms(helper[0], helper[1]),
+    chdir: ms(helper[1], helper[2]),
+    setuid: ms(helper[2], helper[3]),
+    closeFds: ms(helper[3], helper[4]),
+    exec: ms(helper[5], firstOutput),
+    firstOutput: ms(started, firstOutput)
+  };
+}
+
+/**
+ * Aggregates the spawn timings of every terminal in the process.
+ */
+export class SpawnLatencyHistogram {
+  private _phases: { [phase: string]: ISpawnPhaseHistogram } = {};
+
+  public record(timings: ISpawnTimings): void {
+    for (const phase of SPAWN_PHASES) {
+      const value = timings[phase];
+      if (value === undefined) {
+        continue;
+      }
+      let histogram = this._phases[phase];
+      if (!histogram) {
+        histogram = { count: 0, sum: 0, max: 0, counts: SPAWN_LATENCY_BOUNDS.map(() => 0) };
+        this._phases[phase] = histogram;
+      }
+      histogram.count++;
+      histogram.sum += value;
+      histogram.max = Math.max(histogram.max, value);
+      let i = 0;
+      while (value > SPAWN_LATENCY_BOUNDS[i]) {
+        i++;
+      }
+      histogram.counts[i]++;
+    }
+  }
+
+  public snapshot(): ISpawnLatencyHistogram {
+    const phases: { [phase: string]: ISpawnPhaseHistogram } = {};
+    for (const phase of Object.keys(this._phases)) {
+      const histogram = this._phases[phase];
+      phases[phase] = { count: histogram.count, sum: histogram.sum, max: histogram.max, counts: histogram.counts.slice() };
+    }
+    return { bounds: SPAWN_LATENCY_BOUNDS.slice(), phases };
+  }
+}
+
+export const spawnLatencyHistogram = new SpawnLatencyHistogram();
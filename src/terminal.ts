@@ -6,9 +6,12 @@
 
 import { Socket } from 'net';
 import { EventEmitter } from 'events';
-import { ITerminal, IPtyForkOptions, IProcessEnv } from './interfaces';
+import { ITerminal, IPtyForkOptions, IProcessEnv, IDataCoalescingStats, IOutputRing, IPtyIoStats, IRecordingOptions, IScrollbackReplay, IShellIntegrationEvent, IShellIntegrationState, ISpawnTimings, IWaitForMatch } from './interfaces';
 import { EventEmitter2, IEvent } from './eventEmitter2';
 import { IExitEvent } from './types';
+import { DataCoalescer } from './dataCoalescer';
+import { AckFlowControl } from './ackFlowControl';
+import { Scrollback } from './scrollback';
 
 export const DEFAULT_COLS: number = 80;
 export const DEFAULT_ROWS: number = 24;
@@ -35,19 +38,39 @@ export abstract class Terminal implements ITerminal {
   protected _readable: boolean = false;
   protected _writable: boolean = false;
 
+  protected _spawnTimings: ISpawnTimings | undefined;
+  protected _outputRing: IOutputRing | undefined;
+  protected _scrollback: Scrollback | undefined;
+
   protected _internalee: EventEmitter;
   private _flowControlPause: string;
   private _flowControlResume: string;
   public handleFlowControl: boolean;
 
+  private _coalescer: DataCoalescer | undefined;
+  private _ackFlowControl: AckFlowControl | undefined;
+  private _userPaused: boolean = false;
+  // The sequence number just past the output fired by onData, see Scrollback.
+  protected _firedSequence: number = 0;
+
   private _onData = new EventEmitter2<string>();
   public get onData(): IEvent<string> { return this._onData.event; }
   private _onExit = new EventEmitter2<IExitEvent>();
   public get onExit(): IEvent<IExitEvent> { return this._onExit.event; }
+  protected _onShellIntegration = new EventEmitter2<IShellIntegrationEvent>();
+  public get onShellIntegration(): IEvent<IShellIntegrationEvent> { return this._onShellIntegration.event; }
+  protected _onPlainText = new EventEmitter2<string>();
+  public get onPlainText(): IEvent<string> { return this._onPlainText.event; }
+  protected _onDrain = new EventEmitter2<void>();
+  public get onDrain(): IEvent<void> { return this._onDrain.event; }
 
   public get pid(): number { return this._pid; }
   public get cols(): number { return this._cols; }
   public get rows(): number { return this._rows; }
+  public get spawnTimings(): ISpawnTimings | undefined { return this._spawnTimings; }
+  public get dataCoalescingStats(): IDataCoalescingStats | undefined { return this._coalescer?.stats; }
+  public get outputRing(): IOutputRing | undefined { return this._outputRing; }
+  public get outputSequence(): number { return this._scrollback ? this._scrollback.sequence : 0; }
 
   constructor(opt?: IPtyForkOptions) {
     // for 'close'
@@ -62,6 +85,21 @@ export abstract class Terminal implements ITerminal {
       return;
     }
 
+    if (opt.dataCoalescing) {
+      this._coalescer = new DataCoalescer(opt.dataCoalescing, (data, sequence) => this._fireData(data as string, sequence));
+    }
+    if (opt.ackFlowControl) {
+      this._ackFlowControl = new AckFlowControl(
+        opt.ackFlowControl,
+        () => this._socket.pause(),
+        () => {
+          if (!this._userPaused) {
+            this._socket.resume();
+          }
+        }
+      );
+    }
+
     // Do basic type checks here in case node-pty is being used within JavaScript. If the wrong
     // types go through to the C++ side it can lead to hard to diagnose exceptions.
     this._checkType('name', opt.name ? opt.name : undefined, 'string');
@@ -74,27 +112,58 @@ export abstract class Terminal implements ITerminal {
     this._checkType('encoding', opt.encoding ? opt.encoding : undefined, 'string');
   }
 
-  protected abstract _write(data: string | Buffer): void;
+  protected abstract _write(data: string | Buffer): boolean;
 
-  public write(data: string | Buffer): void {
+  public write(data: string | Buffer): boolean {
+    this._coalescer?.noteInput();
     if (this.handleFlowControl) {
       // PAUSE/RESUME messages are not forwarded to the pty
       if (data === this._flowControlPause) {
         this.pause();
-        return;
+        return true;
       }
       if (data === this._flowControlResume) {
         this.resume();
-        return;
+        return true;
       }
     }
     // everything else goes to the real pty
-    this._write(data);
+    return this._write(data);
   }
 
   protected _forwardEvents(): void {
-    this.on('data', e => this._onData.fire(e));
-    this.on('exit', (exitCode, signal) => this._onExit.fire({ exitCode, signal }));
+    this.on('data', e => {
+      const sequence = this._emittedSequence();
+      if (this._coalescer) {
+        this._coalescer.push(e, sequence);
+      } else {
+        this._fireData(e, sequence);
+      }
+    });
+    this.on('exit', (exitCode, signal, resourceUsage) => {
+      // Output that is still being batched happened before the exit.
+      this._coalescer?.flush();
+      this._onExit.fire({ exitCode, signal, resourceUsage });
+    });
+  }
+
+  /**
+   * The sequence number just past the chunk being emitted as data, undefined
+   * when the output is not numbered.
+   */
+  protected _emittedSequence(): number | undefined {
+    return undefined;
+  }
+
+  private _fireData(data: string, sequence?: number): void {
+    if (sequence !== undefined) {
+      this._firedSequence = sequence;
+    }
+    if (this._ackFlowControl) {
+      // Counted in bytes like the consumer's transport, whatever the encoding.
+      this._ackFlowControl.sent(Buffer.byteLength(data, this._socket.readableEncoding || undefined));
+    }
+    this._onData.fire(data);
   }
 
   protected _checkType<T>(name: string, value: T | undefined, type: string, allowArray: boolean = false): void {
@@ -128,14 +197,51 @@ export abstract class Terminal implements ITerminal {
 
   /** See net.Socket.pause */
   public pause(): Socket {
+    this._userPaused = true;
     return this._socket.pause();
   }
 
   /** See net.Socket.resume */
   public resume(): Socket {
+    this._userPaused = false;
+    if (this._ackFlowControl?.paused) {
+      // Resumed once enough output was acknowledged.
+      return this._socket;
+    }
     return this._socket.resume();
   }
 
+  /** Replays the output kept by the scrollback log, see IScrollbackOptions */
+  public replayFrom(seq: number, end?: number): IScrollbackReplay {
+    if (!this._scrollback) {
+      throw new Error('replayFrom requires the scrollback option.');
+    }
+    return this._scrollback.replayFrom(seq, end);
+  }
+
+  public startRecording(path: string, options?: IRecordingOptions): void {
+    throw new Error('startRecording requires the useNativeReader option.');
+  }
+
+  public stopRecording(): void {}
+
+  public getShellIntegration(): IShellIntegrationState | undefined {
+    return undefined;
+  }
+
+  public getStats(): IPtyIoStats | undefined {
+    return undefined;
+  }
+
+  public waitFor(patterns: string | Buffer | (string | Buffer)[], timeout?: number): Promise<IWaitForMatch> {
+    return Promise.reject(new Error('waitFor requires the useNativeReader option.'));
+  }
+
+  /** Acknowledges output fired by onData, see IAckFlowControlOptions */
+  public ack(length: number): void {
+    this._ackFlowControl?.ack(length);
+  }
+
   /** See net.Socket.setEncoding */
   public setEncoding(encoding: string | null): void {
     if ((this._socket as any)._decoder) {
@@ -195,7 +301,7 @@ export abstract class Terminal implements ITerminal {
     this._readable = false;
   }
 
-  protected _parseEnv(env: IProcessEnv): string[] {
+  protected static _parseEnv(env: IProcessEnv): string[] {
     const keys = Object.keys(env || {});
     const pairs = [];
 
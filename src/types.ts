@@ -8,6 +8,20 @@ export type ArgvOrCommandLine = string[] | string;
 export interface IExitEvent {
   exitCode: number;
   signal: number | undefined;
+  resourceUsage?: IResourceUsage;
+}
+
+export interface IResourceUsage {
+  /** CPU time spent in user mode in milliseconds. */
+  userTime: number;
+  /** CPU time spent in the kernel in milliseconds. */
+  systemTime: number;
+  /** The peak resident set size in bytes. */
+  maxRss: number;
+  voluntaryContextSwitches: number;
+  involuntaryContextSwitches: number;
+  /** Wall-clock time from the spawn until the process was reaped in milliseconds. */
+  lifetime: number;
 }
 
 export interface IDisposable {
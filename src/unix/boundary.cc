@@ -0,0 +1,131 @@
+/**
+ * Copyright (c) 2026, Microsoft Corporation (MIT License).
+ *
+ * boundary.cc:
+ *   An escape sequence can't contain ESC other than the one starting the ST
+ *   of a string, so only the last ESC, or the one before it when the last is
+ *   the start of an ST, can start an incomplete sequence, so the chunk is
+ *   searched backwards for at most two of them.
+ */
+
+#include "boundary.h"
+
+#include <string.h>
+
+namespace boundary {
+
+namespace {
+
+const unsigned char kEsc = 0x1b;
+const unsigned char kBel = 0x07;
+const unsigned char kCan = 0x18;
+const unsigned char kSub = 0x1a;
+
+const unsigned char* FindLast(const unsigned char* data, size_t length,
+                              unsigned char c) {
+#if defined(__GLIBC__)
+  return static_cast<const unsigned char*>(memrchr(data, c, length));
+#else
+  for (size_t i = length; i > 0; i--) {
+    if (data[i - 1] == c) {
+      return data + i - 1;
+    }
+  }
+  return nullptr;
+#endif
+}
+
+// Whether the escape sequence at p, which runs to end, is complete.
+bool EscapeComplete(const unsigned char* p, const unsigned char* end) {
+  if (p + 1 == end) {
+    return false;
+  }
+  unsigned char kind = p[1];
+  const unsigned char* q = p + 2;
+  switch (kind) {
+    case '[':
+      // Parameters and intermediates up to a final byte. C0 controls are
+      // executed in the middle of a CSI, CAN and SUB abort it.
+      for (; q < end; q++) {
+        if (*q >= 0x40 || *q == kCan || *q == kSub) {
+          return true;
+        }
+      }
+      return false;
+    case ']':
+      // Terminated by BEL, or by an ST whose ESC would be the last one.
+      return memchr(q, kBel, end - q) != nullptr;
+    case 'P':
+    case 'X':
+    case '^':
+    case '_':
+      // Only ST terminates these.
+      return false;
+    default:
+      // Intermediates up to a final byte, like ESC ( B.
+      for (q = p + 1; q < end; q++) {
+        if (*q < 0x20 || *q > 0x2f) {
+          return true;
+        }
+      }
+      return false;
+  }
+}
+
+// Whether the escape sequence at p starts a string that only ends with BEL
+// or ST, and has not seen a BEL before end.
+bool OpenString(const unsigned char* p, const unsigned char* end) {
+  switch (p[1]) {
+    case ']':
+      return memchr(p + 2, kBel, end - p - 2) == nullptr;
+    case 'P':
+    case 'X':
+    case '^':
+    case '_':
+      return true;
+    default:
+      return false;
+  }
+}
+
+// The length of the UTF-8 sequence starting with lead, 1 for anything that
+// can't start one.
+size_t SequenceLength(unsigned char lead) {
+  if (lead >= 0xc2 && lead <= 0xdf) return 2;
+  if (lead >= 0xe0 && lead <= 0xef) return 3;
+  if (lead >= 0xf0 && lead <= 0xf4) return 4;
+  return 1;
+}
+
+}  // namespace
+
+size_t CompleteLength(const char* data, size_t length) {
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+  const unsigned char* end = p + length;
+  const unsigned char* esc = FindLast(p, length, kEsc);
+  if (esc != nullptr && !EscapeComplete(esc, end)) {
+    // A lone ESC at the end may be the first half of the ST of a string that
+    // began at the ESC before it; hold that string back as well.
+    if (esc + 1 == end && esc > p) {
+      const unsigned char* start = FindLast(p, esc - p, kEsc);
+      if (start != nullptr && OpenString(start, esc)) {
+        return start - p;
+      }
+    }
+    return esc - p;
+  }
+  // Look for the lead byte of a sequence that runs past the end among the
+  // last three bytes.
+  for (size_t back = 1; back <= 3 && back <= length; back++) {
+    unsigned char c = end[-back];
+    if (c < 0x80) {
+      break;
+    }
+    if (c >= 0xc0) {
+      return SequenceLength(c) > back ? length - back : length;
+    }
+  }
+  return length;
+}
+
+}  // namespace boundary
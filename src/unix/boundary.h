@@ -0,0 +1,26 @@
+/**
+ * Copyright (c) 2026, Microsoft Corporation (MIT License).
+ *
+ * boundary.h:
+ *   Finds where output can be split without cutting a UTF-8 code point or
+ *   an escape sequence in two.
+ */
+
+#ifndef NODE_PTY_BOUNDARY_H_
+#define NODE_PTY_BOUNDARY_H_
+
+#include <stddef.h>
+
+namespace boundary {
+
+// The length of the longest prefix of data that does not end in an
+// incomplete UTF-8 sequence, or an incomplete escape sequence: a lone ESC,
+// an unterminated CSI, or an OSC, DCS, SOS, PM or APC string that is not
+// terminated yet, including one cut between the ESC and the backslash of
+// its ST. Only the bytes from the last ESC or two on are parsed, so it is as
+// fast as memrchr(3) over output without escape sequences.
+size_t CompleteLength(const char* data, size_t length);
+
+}  // namespace boundary
+
+#endif  // NODE_PTY_BOUNDARY_H_
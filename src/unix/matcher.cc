@@ -0,0 +1,102 @@
+/**
+ * Copyright (c) 2026, Microsoft Corporation (MIT License).
+ *
+ * matcher.cc:
+ *   The patterns are built into a trie, whose missing transitions are then
+ *   filled in breadth first from the failure links, leaving a DFA that takes
+ *   a single table lookup per byte.
+ */
+
+#include "matcher.h"
+
+#include <deque>
+
+namespace matcher {
+
+namespace {
+
+// No transition yet while building, no match in match_.
+const int32_t kNone = -1;
+
+}  // namespace
+
+Matcher::Matcher(const std::vector<std::string>& patterns) {
+  next_.assign(256, kNone);
+  match_.push_back(kNone);
+  for (size_t i = 0; i < patterns.size(); i++) {
+    const std::string& pattern = patterns[i];
+    int32_t state = 0;
+    for (unsigned char c : pattern) {
+      int32_t& next = next_[state * 256 + c];
+      if (next == kNone) {
+        next = static_cast<int32_t>(match_.size());
+        next_.resize(next_.size() + 256, kNone);
+        match_.push_back(kNone);
+      }
+      state = next_[state * 256 + c];
+    }
+    // The first of duplicate patterns wins.
+    if (match_[state] == kNone) {
+      match_[state] = static_cast<int32_t>(i);
+    }
+    lengths_.push_back(pattern.size());
+    starts_.Add(static_cast<unsigned char>(pattern[0]));
+  }
+
+  std::vector<int32_t> fail(match_.size(), 0);
+  std::deque<int32_t> queue;
+  for (int c = 0; c < 256; c++) {
+    int32_t& next = next_[c];
+    if (next == kNone) {
+      next = 0;
+    } else {
+      queue.push_back(next);
+    }
+  }
+  while (!queue.empty()) {
+    int32_t state = queue.front();
+    queue.pop_front();
+    // A pattern ending here is the longest, otherwise inherit the longest
+    // suffix's, which was finished earlier as it is shallower.
+    if (match_[state] == kNone) {
+      match_[state] = match_[fail[state]];
+    }
+    for (int c = 0; c < 256; c++) {
+      int32_t& next = next_[state * 256 + c];
+      int32_t fallback = next_[fail[state] * 256 + c];
+      if (next == kNone) {
+        next = fallback;
+      } else {
+        fail[next] = fallback;
+        queue.push_back(next);
+      }
+    }
+  }
+}
+
+bool Matcher::Feed(const char* data, size_t length, size_t* index,
+                   size_t* end) {
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+  size_t i = 0;
+  int32_t state = state_;
+  while (i < length) {
+    if (state == 0) {
+      // Nothing in progress, skip to the next byte a pattern starts with.
+      i = starts_.Find(p + i, p + length) - p;
+      if (i == length) {
+        break;
+      }
+    }
+    state = next_[state * 256 + p[i++]];
+    if (match_[state] != kNone) {
+      *index = static_cast<size_t>(match_[state]);
+      *end = i;
+      state_ = state;
+      return true;
+    }
+  }
+  state_ = state;
+  return false;
+}
+
+}  // namespace matcher
@@ -0,0 +1,51 @@
+/**
+ * Copyright (c) 2026, Microsoft Corporation (MIT License).
+ *
+ * matcher.h:
+ *   Finds the first occurrence of any of a set of byte patterns in a stream
+ *   of output, which may be split anywhere across chunks.
+ */
+
+#ifndef NODE_PTY_MATCHER_H_
+#define NODE_PTY_MATCHER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "scan.h"
+
+namespace matcher {
+
+// An Aho-Corasick automaton over bytes, with every transition precomputed.
+// While no partial match is in progress, bytes that cannot start a pattern
+// are skipped with a scan::ByteSet.
+class Matcher {
+ public:
+  // patterns must not be empty, nor contain an empty pattern.
+  explicit Matcher(const std::vector<std::string>& patterns);
+
+  // Feeds the next length bytes of the stream. Returns true once a pattern
+  // ends in them, setting *index to the pattern and *end to how many bytes of
+  // data come before the end of the match. The earliest ending match wins,
+  // the longest of those if several end at the same byte. The state carries
+  // over to the next call, so a match may start in an earlier chunk.
+  bool Feed(const char* data, size_t length, size_t* index, size_t* end);
+
+  size_t PatternLength(size_t index) const { return lengths_[index]; }
+
+ private:
+  // state * 256 + byte -> the next state.
+  std::vector<int32_t> next_;
+  // state -> the longest pattern ending there, -1 if none does.
+  std::vector<int32_t> match_;
+  std::vector<size_t> lengths_;
+  scan::ByteSet starts_;
+  int32_t state_ = 0;
+};
+
+}  // namespace matcher
+
+#endif  // NODE_PTY_MATCHER_H_
@@ -0,0 +1,154 @@
+/**
+ * Copyright (c) 2026, Microsoft Corporation (MIT License).
+ *
+ * pool.cc:
+ *   Pooled pty pairs are handed out from the front of a deque under a mutex,
+ *   a single thread opens new pairs outside of the lock whenever the pool
+ *   drops below its low watermark.
+ */
+
+#include "pool.h"
+
+#include <unistd.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace pty_pool {
+
+namespace {
+
+struct State {
+  // Serializes Configure() so the refill thread is started and stopped once.
+  std::mutex configure_mutex;
+
+  // Guards everything below.
+  std::mutex mutex;
+  std::condition_variable refill;
+  std::deque<Pair> pairs;
+  std::thread* thread = nullptr;
+  Opener opener = nullptr;
+  size_t size = 0;
+  size_t low_watermark = 0;
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  bool refilling = false;
+  bool stopping = false;
+};
+
+// Never destroyed, the refill thread may still be waiting on it when the
+// process exits.
+State& GetState() {
+  static State* state = new State();
+  return *state;
+}
+
+void Close(const Pair& pair) {
+  close(pair.master);
+  close(pair.slave);
+}
+
+void Refill(State* s) {
+  std::unique_lock<std::mutex> lock(s->mutex);
+  while (true) {
+    s->refill.wait(lock, [s] { return s->stopping || s->refilling; });
+    if (s->stopping) {
+      return;
+    }
+    while (!s->stopping && s->pairs.size() < s->size) {
+      Opener opener = s->opener;
+      lock.unlock();
+      Pair pair;
+      bool opened = opener(&pair);
+      lock.lock();
+      if (!opened) {
+        // Most likely out of ptys, try again on the next miss.
+        break;
+      }
+      if (s->stopping || s->pairs.size() >= s->size) {
+        Close(pair);
+        break;
+      }
+      s->pairs.push_back(pair);
+    }
+    s->refilling = false;
+  }
+}
+
+// s->mutex must be held.
+void StartRefill(State* s) {
+  if (!s->refilling && s->size > 0) {
+    s->refilling = true;
+    s->refill.notify_one();
+  }
+}
+
+}  // namespace
+
+void Configure(size_t size, size_t low_watermark, Opener opener) {
+  State* s = &GetState();
+  std::lock_guard<std::mutex> configure_lock(s->configure_mutex);
+  std::thread* stopped = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(s->mutex);
+    s->size = size;
+    s->low_watermark = low_watermark < size ? low_watermark : size;
+    s->opener = opener;
+    while (s->pairs.size() > size) {
+      Close(s->pairs.back());
+      s->pairs.pop_back();
+    }
+    if (size == 0) {
+      s->stopping = true;
+      stopped = s->thread;
+      s->thread = nullptr;
+    } else {
+      if (s->thread == nullptr) {
+        s->stopping = false;
+        s->refilling = false;
+        s->thread = new std::thread(Refill, s);
+      }
+      StartRefill(s);
+    }
+  }
+  if (stopped != nullptr) {
+    s->refill.notify_one();
+    stopped->join();
+    delete stopped;
+  }
+}
+
+bool Take(Pair* pair) {
+  State* s = &GetState();
+  std::lock_guard<std::mutex> lock(s->mutex);
+  if (s->pairs.empty()) {
+    if (s->size > 0) {
+      s->misses++;
+      StartRefill(s);
+    }
+    return false;
+  }
+  *pair = s->pairs.front();
+  s->pairs.pop_front();
+  s->hits++;
+  if (s->pairs.size() < s->low_watermark) {
+    StartRefill(s);
+  }
+  return true;
+}
+
+Stats GetStats() {
+  State* s = &GetState();
+  std::lock_guard<std::mutex> lock(s->mutex);
+  Stats stats;
+  stats.size = s->size;
+  stats.low_watermark = s->low_watermark;
+  stats.available = s->pairs.size();
+  stats.hits = s->hits;
+  stats.misses = s->misses;
+  return stats;
+}
+
+}  // namespace pty_pool
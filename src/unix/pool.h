@@ -0,0 +1,49 @@
+/**
+ * Copyright (c) 2026, Microsoft Corporation (MIT License).
+ *
+ * pool.h:
+ *   A process wide pool of pty pairs that are opened ahead of time, so a spawn
+ *   does not pay for allocating the device.
+ */
+
+#ifndef NODE_PTY_POOL_H_
+#define NODE_PTY_POOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+namespace pty_pool {
+
+struct Pair {
+  int master = -1;
+  int slave = -1;
+  std::string name;
+};
+
+// Opens a configured pair, returns false on failure. Called on the refill
+// thread.
+using Opener = bool (*)(Pair* pair);
+
+struct Stats {
+  size_t size;
+  size_t low_watermark;
+  size_t available;
+  uint64_t hits;
+  uint64_t misses;
+};
+
+// Keeps up to size pairs opened by opener. Once fewer than low_watermark are
+// left a background thread tops the pool up again. A size of 0 closes every
+// pooled pair and stops the thread.
+void Configure(size_t size, size_t low_watermark, Opener opener);
+
+// Takes a pair out of the pool, returns false when it is empty.
+bool Take(Pair* pair);
+
+Stats GetStats();
+
+}  // namespace pty_pool
+
+#endif  // NODE_PTY_POOL_H_
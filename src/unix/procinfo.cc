@@ -0,0 +1,180 @@
+/**
+ * Copyright (c) 2026, Microsoft Corporation (MIT License).
+ *
+ * procinfo.cc:
+ *   On Linux each file of /proc is read with a single read(2) into a buffer
+ *   on the stack, macOS has sysctl(3) and libproc instead.
+ */
+
+#include "procinfo.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(__APPLE__)
+#include <libproc.h>
+#include <sys/sysctl.h>
+#endif
+
+namespace procinfo {
+
+#if defined(__linux__) || defined(__APPLE__)
+
+namespace {
+
+// Splits the NUL separated strings of data, the last one may be unterminated.
+void SplitArgs(const char* data, size_t length, std::vector<std::string>* out) {
+  size_t start = 0;
+  while (start < length) {
+    const char* end = static_cast<const char*>(
+        memchr(data + start, '\0', length - start));
+    size_t size = end ? end - (data + start) : length - start;
+    out->emplace_back(data + start, size);
+    start += size + 1;
+  }
+}
+
+}  // namespace
+
+#endif
+
+#if defined(__linux__)
+
+namespace {
+
+// Enough for the command lines of interactive programs, the rest is cut.
+const size_t kMaxCmdline = 4096;
+
+// Reads up to size bytes of /proc/<pid>/<name> into buf. Returns the number
+// of bytes read, or -1.
+ssize_t ReadProc(pid_t pid, const char* name, char* buf, size_t size) {
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/%lld/%s", (long long)pid, name);
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    return -1;
+  }
+  ssize_t n;
+  do {
+    n = read(fd, buf, size);
+  } while (n == -1 && errno == EINTR);
+  close(fd);
+  return n;
+}
+
+}  // namespace
+
+bool Get(int fd, int fields, Info* info) {
+  pid_t pgrp = tcgetpgrp(fd);
+  if (pgrp == -1) {
+    return false;
+  }
+  info->pid = pgrp;
+
+  if (fields & kArgv) {
+    char cmdline[kMaxCmdline];
+    ssize_t n = ReadProc(pgrp, "cmdline", cmdline, sizeof(cmdline));
+    if (n == -1) {
+      return false;
+    }
+    SplitArgs(cmdline, n, &info->argv);
+  }
+
+  if (fields & kName) {
+    // At most TASK_COMM_LEN, 16 bytes, and a newline.
+    char comm[64];
+    ssize_t n = ReadProc(pgrp, "comm", comm, sizeof(comm));
+    if (n == -1) {
+      return false;
+    }
+    while (n > 0 && comm[n - 1] == '\n') {
+      n--;
+    }
+    info->name.assign(comm, n);
+  }
+
+  if (fields & kCwd) {
+    char path[64];
+    char cwd[PATH_MAX];
+    snprintf(path, sizeof(path), "/proc/%lld/cwd", (long long)pgrp);
+    ssize_t n = readlink(path, cwd, sizeof(cwd));
+    if (n > 0) {
+      info->cwd.assign(cwd, n);
+    }
+  }
+  return true;
+}
+
+#elif defined(__APPLE__)
+
+bool Get(int fd, int fields, Info* info) {
+  pid_t pgrp = tcgetpgrp(fd);
+  if (pgrp == -1) {
+    return false;
+  }
+  info->pid = pgrp;
+
+  if (fields & kName) {
+    int mib[4] = { CTL_KERN, KERN_PROC, KERN_PROC_PID, pgrp };
+    struct kinfo_proc kp;
+    size_t size = sizeof(kp);
+    if (sysctl(mib, 4, &kp, &size, NULL, 0) == -1 || size != sizeof(kp)) {
+      return false;
+    }
+    info->name = kp.kp_proc.p_comm;
+  }
+
+  if (fields & kArgv) {
+    // argc, the path of the executable and its padding, then the arguments.
+    static const int arg_max = [] {
+      int mib[2] = { CTL_KERN, KERN_ARGMAX };
+      int value = 0;
+      size_t size = sizeof(value);
+      return sysctl(mib, 2, &value, &size, NULL, 0) == 0 ? value : 0;
+    }();
+    std::vector<char> args(arg_max);
+    int mib[3] = { CTL_KERN, KERN_PROCARGS2, pgrp };
+    size_t size = args.size();
+    int argc;
+    // Fails for processes of other users.
+    if (size > sizeof(argc) && sysctl(mib, 3, args.data(), &size, NULL, 0) == 0) {
+      memcpy(&argc, args.data(), sizeof(argc));
+      const char* p = args.data() + sizeof(argc);
+      const char* end = args.data() + size;
+      p = static_cast<const char*>(memchr(p, '\0', end - p));
+      while (p && p < end && *p == '\0') {
+        p++;
+      }
+      if (p) {
+        SplitArgs(p, end - p, &info->argv);
+        if (info->argv.size() > static_cast<size_t>(argc)) {
+          // The environment follows.
+          info->argv.resize(argc);
+        }
+      }
+    }
+  }
+
+  if (fields & kCwd) {
+    struct proc_vnodepathinfo vpi;
+    if (proc_pidinfo(pgrp, PROC_PIDVNODEPATHINFO, 0, &vpi, sizeof(vpi)) ==
+        sizeof(vpi)) {
+      info->cwd = vpi.pvi_cdir.vip_path;
+    }
+  }
+  return true;
+}
+
+#else
+
+bool Get(int fd, int fields, Info* info) {
+  return false;
+}
+
+#endif
+
+}  // namespace procinfo
@@ -0,0 +1,45 @@
+/**
+ * Copyright (c) 2026, Microsoft Corporation (MIT License).
+ *
+ * procinfo.h:
+ *   Describes the foreground process of a pty, its name, arguments and
+ *   working directory.
+ */
+
+#ifndef NODE_PTY_PROCINFO_H_
+#define NODE_PTY_PROCINFO_H_
+
+#include <sys/types.h>
+
+#include <string>
+#include <vector>
+
+namespace procinfo {
+
+// What Get() reads, anything else is left empty.
+enum Field {
+  kArgv = 1 << 0,
+  kName = 1 << 1,
+  kCwd = 1 << 2,
+  kAll = kArgv | kName | kCwd,
+};
+
+struct Info {
+  // The foreground process group, whose leader is described.
+  pid_t pid = -1;
+  // The short name the kernel keeps for the process.
+  std::string name;
+  // Cut short when longer than the kernel or the buffers here allow.
+  std::vector<std::string> argv;
+  // Empty when it may not be read.
+  std::string cwd;
+};
+
+// Reads fields of the foreground process of the pty fd into *info. Returns
+// false when there is none, it went away, or this platform is not supported.
+// Never touches JS, so it may run on any thread.
+bool Get(int fd, int fields, Info* info);
+
+}  // namespace procinfo
+
+#endif  // NODE_PTY_PROCINFO_H_
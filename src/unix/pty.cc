@@ -24,7 +24,6 @@
 #include <string.h>
 #include <stdlib.h>
 #include <unistd.h>
-#include <thread>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -32,13 +31,27 @@
 #include <sys/wait.h>
 #include <fcntl.h>
 #include <signal.h>
+#include <uv.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "pool.h"
+#include "procinfo.h"
+#include "reader.h"
+#include "reaper.h"
+#include "recorder.h"
+#include "scrollback.h"
+#include "tracker.h"
+#include "writer.h"
 
 /* forkpty */
 /* http://www.gnu.org/software/gnulib/manual/html_node/forkpty.html */
 #if defined(__linux__)
 #include <pty.h>
-#include <dirent.h>
-#include <sys/syscall.h>
+#include <spawn.h>
 #elif defined(__APPLE__)
 #include <util.h>
 #elif defined(__FreeBSD__)
@@ -66,7 +79,6 @@
 #include <os/availability.h>
 #include <paths.h>
 #include <spawn.h>
-#include <sys/event.h>
 #include <sys/sysctl.h>
 #include <termios.h>
 #endif
@@ -77,7 +89,7 @@
 #endif
 
 /* macOS 10.14 back does not define this constant */
-#ifndef POSIX_SPAWN_SETSID
+#if defined(__APPLE__) && !defined(POSIX_SPAWN_SETSID)
   #define POSIX_SPAWN_SETSID 1024
 #endif
 
@@ -96,24 +108,9 @@ extern "C" {
 int pthread_chdir_np(const char* dir) API_AVAILABLE(macosx(10.12));
 int pthread_fchdir_np(int fd) API_AVAILABLE(macosx(10.12));
 }
-
-#define HANDLE_EINTR(x) ({ \
-  int eintr_wrapper_counter = 0; \
-  decltype(x) eintr_wrapper_result; \
-  do { \
-    eintr_wrapper_result = (x); \
-  } while (eintr_wrapper_result == -1 && errno == EINTR && \
-           eintr_wrapper_counter++ < 100); \
-  eintr_wrapper_result; \
-})
 #endif
 
-struct ExitEvent {
-  int exit_code = 0, signal_code = 0;
-};
-
-#if defined(__linux__)
-
+#if defined(__APPLE__) || defined(__linux__)
 static int
 SetCloseOnExec(int fd) {
   int flags = fcntl(fd, F_GETFD, 0);
@@ -123,140 +120,31 @@ SetCloseOnExec(int fd) {
     return 0;
   return fcntl(fd, F_SETFD, flags | FD_CLOEXEC);
 }
-
-/**
- * Close all file descriptors >= 3 to prevent FD leakage to child processes.
- * Uses close_range() syscall on Linux 5.9+, falls back to /proc/self/fd iteration.
- */
-static void
-pty_close_inherited_fds() {
-  // Try close_range() first (Linux 5.9+, glibc 2.34+)
-  #if defined(SYS_close_range) && defined(CLOSE_RANGE_CLOEXEC)
-  if (syscall(SYS_close_range, 3, ~0U, CLOSE_RANGE_CLOEXEC) == 0) {
-    return;
-  }
-  #endif
-
-  int fd;
-  // Set the CLOEXEC flag on all open descriptors. Unconditionally try the first
-  // 16 file descriptors. After that, bail out after the first error.
-  for (fd = 3; ; fd++)
-    if (SetCloseOnExec(fd) && fd > 15)
-      break;
-}
-#endif
-
-void SetupExitCallback(Napi::Env env, Napi::Function cb, pid_t pid) {
-  std::thread *th = new std::thread;
-  // Don't use Napi::AsyncWorker which is limited by UV_THREADPOOL_SIZE.
-  auto tsfn = Napi::ThreadSafeFunction::New(
-      env,
-      cb,                           // JavaScript function called asynchronously
-      "SetupExitCallback_resource", // Name
-      0,                            // Unlimited queue
-      1,                            // Only one thread will use this initially
-      [th](Napi::Env) {   // Finalizer used to clean threads up
-        th->join();
-        delete th;
-      });
-  *th = std::thread([tsfn = std::move(tsfn), pid] {
-    auto callback = [](Napi::Env env, Napi::Function cb, ExitEvent *exit_event) {
-      cb.Call({Napi::Number::New(env, exit_event->exit_code),
-               Napi::Number::New(env, exit_event->signal_code)});
-      delete exit_event;
-    };
-
-    int ret;
-    int stat_loc;
-#if defined(__APPLE__)
-    // Based on
-    // https://source.chromium.org/chromium/chromium/src/+/main:base/process/kill_mac.cc;l=35-69?
-    int kq = HANDLE_EINTR(kqueue());
-    struct kevent change = {0};
-    EV_SET(&change, pid, EVFILT_PROC, EV_ADD, NOTE_EXIT, 0, NULL);
-    ret = HANDLE_EINTR(kevent(kq, &change, 1, NULL, 0, NULL));
-    if (ret == -1) {
-      if (errno == ESRCH) {
-        // At this point, one of the following has occurred:
-        // 1. The process has died but has not yet been reaped.
-        // 2. The process has died and has already been reaped.
-        // 3. The process is in the process of dying. It's no longer
-        //    kqueueable, but it may not be waitable yet either. Mark calls
-        //    this case the "zombie death race".
-        ret = HANDLE_EINTR(waitpid(pid, &stat_loc, WNOHANG));
-        if (ret == 0) {
-          ret = kill(pid, SIGKILL);
-          if (ret != -1) {
-            HANDLE_EINTR(waitpid(pid, &stat_loc, 0));
-          }
-        }
-      }
-    } else {
-      struct kevent event = {0};
-      ret = HANDLE_EINTR(kevent(kq, NULL, 0, &event, 1, NULL));
-      if (ret == 1) {
-        if ((event.fflags & NOTE_EXIT) &&
-            (event.ident == static_cast<uintptr_t>(pid))) {
-          // The process is dead or dying. This won't block for long, if at
-          // all.
-          HANDLE_EINTR(waitpid(pid, &stat_loc, 0));
-        }
-      }
-    }
-    close(kq);
-#else
-    while (true) {
-      errno = 0;
-      if ((ret = waitpid(pid, &stat_loc, 0)) != pid) {
-        if (ret == -1 && errno == EINTR) {
-          continue;
-        }
-        if (ret == -1 && errno == ECHILD) {
-          // XXX node v0.8.x seems to have this problem.
-          // waitpid is already handled elsewhere.
-          ;
-        } else {
-          assert(false);
-        }
-      }
-      break;
-    }
 #endif
-    ExitEvent *exit_event = new ExitEvent;
-    if (WIFEXITED(stat_loc)) {
-      exit_event->exit_code = WEXITSTATUS(stat_loc); // errno?
-    }
-    if (WIFSIGNALED(stat_loc)) {
-      exit_event->signal_code = WTERMSIG(stat_loc);
-    }
-    auto status = tsfn.BlockingCall(exit_event, callback); // In main thread
-    switch (status) {
-      case napi_closing:
-        break;
-
-      case napi_queue_full:
-        Napi::Error::Fatal("SetupExitCallback", "Queue was full");
-
-      case napi_ok:
-        if (tsfn.Release() != napi_ok) {
-          Napi::Error::Fatal("SetupExitCallback", "ThreadSafeFunction.Release() failed");
-        }
-        break;
-
-      default:
-        Napi::Error::Fatal("SetupExitCallback", "ThreadSafeFunction.BlockingCall() failed");
-    }
-  });
-}
 
 /**
  * Methods
  */
 
 Napi::Value PtyFork(const Napi::CallbackInfo& info);
+Napi::Value PtyForkAsync(const Napi::CallbackInfo& info);
+Napi::Value PtyForkMany(const Napi::CallbackInfo& info);
 Napi::Value PtyOpen(const Napi::CallbackInfo& info);
 Napi::Value PtyResize(const Napi::CallbackInfo& info);
 Napi::Value PtyGetProc(const Napi::CallbackInfo& info);
+Napi::Value PtyGetProcessInfo(const Napi::CallbackInfo& info);
+Napi::Value PtyConfigurePool(const Napi::CallbackInfo& info);
+Napi::Value PtyGetPoolStats(const Napi::CallbackInfo& info);
+Napi::Value PtyReadSpawnTimings(const Napi::CallbackInfo& info);
+Napi::Value PtyStartReading(const Napi::CallbackInfo& info);
+Napi::Value PtyPauseReading(const Napi::CallbackInfo& info);
+Napi::Value PtyResumeReading(const Napi::CallbackInfo& info);
+Napi::Value PtyRingConsumed(const Napi::CallbackInfo& info);
+Napi::Value PtyRecordOutput(const Napi::CallbackInfo& info);
+Napi::Value PtyWaitFor(const Napi::CallbackInfo& info);
+Napi::Value PtyCancelWait(const Napi::CallbackInfo& info);
+Napi::Value PtyReadStats(const Napi::CallbackInfo& info);
+Napi::Value PtyStopReading(const Napi::CallbackInfo& info);
 
 /**
  * Functions
@@ -273,16 +161,6 @@ static char *
 pty_getproc(int, char *);
 #endif
 
-#if defined(__APPLE__) || defined(__OpenBSD__)
-static void
-pty_posix_spawn(char** argv, char** env,
-                const struct termios *termp,
-                const struct winsize *winp,
-                int* master,
-                pid_t* pid,
-                std::string* err);
-#endif
-
 struct DelBuf {
   int len;
   DelBuf(int len) : len(len) {}
@@ -295,63 +173,54 @@ struct DelBuf {
   }
 };
 
-Napi::Value PtyFork(const Napi::CallbackInfo& info) {
-  Napi::Env napiEnv(info.Env());
-  Napi::HandleScope scope(napiEnv);
-
-  if (info.Length() != 11 ||
-      !info[0].IsString() ||
-      !info[1].IsArray() ||
-      !info[2].IsArray() ||
-      !info[3].IsString() ||
-      !info[4].IsNumber() ||
-      !info[5].IsNumber() ||
-      !info[6].IsNumber() ||
-      !info[7].IsNumber() ||
-      !info[8].IsBoolean() ||
-      !info[9].IsString() ||
-      !info[10].IsFunction()) {
-    throw Napi::Error::New(napiEnv, "Usage: pty.fork(file, args, env, cwd, cols, rows, uid, gid, utf8, helperPath, onexit)");
-  }
-
-  // file
-  std::string file = info[0].As<Napi::String>();
-
-  // args
-  Napi::Array argv_ = info[1].As<Napi::Array>();
-
-  // env
-  Napi::Array env_ = info[2].As<Napi::Array>();
-  int envc = env_.Length();
-  std::unique_ptr<char *, DelBuf> env_unique_ptr(new char *[envc + 1], DelBuf(envc + 1));
-  char **env = env_unique_ptr.get();
-  env[envc] = NULL;
-  for (int i = 0; i < envc; i++) {
-    std::string pair = env_.Get(i).As<Napi::String>();
-    env[i] = strdup(pair.c_str());
-  }
-
-  // cwd
-  std::string cwd_ = info[3].As<Napi::String>();
+/**
+ * Fork Request
+ * Everything needed to start a process, copied out of the JS arguments so the
+ * spawn itself can run on any thread.
+ */
 
-  // size
+struct PtyForkRequest {
+  std::unique_ptr<char *, DelBuf> argv{nullptr, DelBuf(0)};
+  std::unique_ptr<char *, DelBuf> env{nullptr, DelBuf(0)};
+  std::string cwd;
+  int uid;
+  int gid;
+  struct termios term;
   struct winsize winp;
-  winp.ws_col = info[4].As<Napi::Number>().Int32Value();
-  winp.ws_row = info[5].As<Napi::Number>().Int32Value();
-  winp.ws_xpixel = 0;
-  winp.ws_ypixel = 0;
+};
 
-#if !defined(__APPLE__)
-  // uid / gid
-  int uid = info[6].As<Napi::Number>().Int32Value();
-  int gid = info[7].As<Napi::Number>().Int32Value();
+struct PtyForkResult {
+  int master = -1;
+  pid_t pid = -1;
+  std::string pty;
+  // uv_hrtime() when the fork call started, once its arguments were
+  // marshalled, once the pty was open and once the process was started.
+  uint64_t started = 0;
+  uint64_t marshalled = 0;
+  uint64_t opened = 0;
+  uint64_t spawned = 0;
+  // Read end of the pipe spawn-helper reports its own phases on, or -1.
+  int timing_fd = -1;
+};
+
+#if defined(__APPLE__) || defined(__linux__)
+static void
+pty_posix_spawn(char** argv, char** env,
+                const struct termios *termp,
+                const struct winsize *winp,
+                PtyForkResult* res,
+                std::string* err);
 #endif
 
-  // termios
-  struct termios t = termios();
-  struct termios *term = &t;
+/**
+ * The termios every pty is opened with.
+ */
+
+static void
+pty_default_termios(struct termios *term, bool utf8) {
+  *term = termios();
   term->c_iflag = ICRNL | IXON | IXANY | IMAXBEL | BRKINT;
-  if (info[8].As<Napi::Boolean>().Value()) {
+  if (utf8) {
 #if defined(IUTF8)
     term->c_iflag |= IUTF8;
 #endif
@@ -384,48 +253,175 @@ Napi::Value PtyFork(const Napi::CallbackInfo& info) {
 
   cfsetispeed(term, B38400);
   cfsetospeed(term, B38400);
+}
+
+#if defined(__APPLE__) || defined(__linux__)
+/**
+ * The termios and size pooled pairs are opened with, those of a UTF-8
+ * terminal at the default size of the JS side.
+ */
+
+static void
+pty_pool_defaults(struct termios *term, struct winsize *winp) {
+  pty_default_termios(term, true);
+  *winp = winsize();
+  winp->ws_col = 80;
+  winp->ws_row = 24;
+}
+
+static bool
+pty_pool_open(pty_pool::Pair* pair);
+#endif
+
+/**
+ * Fork Arguments
+ * fork, forkAsync and SpawnTemplate take (file, args, env, cwd, cols, rows,
+ * uid, gid, utf8, helperPath) as their arguments, forkMany takes an array of
+ * them. PtyForkArgs lets both be read the same way.
+ */
+
+class PtyForkArgs {
+ public:
+  explicit PtyForkArgs(const Napi::CallbackInfo& info) {
+    for (size_t i = 0; i < info.Length(); i++) {
+      values_.push_back(info[i]);
+    }
+  }
+  explicit PtyForkArgs(Napi::Array spec) {
+    for (uint32_t i = 0; i < spec.Length(); i++) {
+      values_.push_back(spec.Get(i));
+    }
+  }
+
+  size_t Length() const { return values_.size(); }
+  Napi::Value operator[](size_t i) const { return values_[i]; }
+
+ private:
+  std::vector<Napi::Value> values_;
+};
+
+static bool
+pty_fork_args_valid(const PtyForkArgs& info) {
+  return info.Length() >= 10 &&
+         info[0].IsString() &&
+         info[1].IsArray() &&
+         info[2].IsArray() &&
+         info[3].IsString() &&
+         info[4].IsNumber() &&
+         info[5].IsNumber() &&
+         info[6].IsNumber() &&
+         info[7].IsNumber() &&
+         info[8].IsBoolean() &&
+         info[9].IsString();
+}
+
+static void
+pty_fork_marshal(const PtyForkArgs& info, PtyForkRequest* req) {
+  // file
+  std::string file = info[0].As<Napi::String>();
+
+  // args
+  Napi::Array argv_ = info[1].As<Napi::Array>();
+
+  // env
+  Napi::Array env_ = info[2].As<Napi::Array>();
+  int envc = env_.Length();
+  req->env = std::unique_ptr<char *, DelBuf>(new char *[envc + 1], DelBuf(envc + 1));
+  char **env = req->env.get();
+  env[envc] = NULL;
+  for (int i = 0; i < envc; i++) {
+    std::string pair = env_.Get(i).As<Napi::String>();
+    env[i] = strdup(pair.c_str());
+  }
+
+  // cwd
+  req->cwd = info[3].As<Napi::String>();
+
+  // size
+  struct winsize *winp = &req->winp;
+  winp->ws_col = info[4].As<Napi::Number>().Int32Value();
+  winp->ws_row = info[5].As<Napi::Number>().Int32Value();
+  winp->ws_xpixel = 0;
+  winp->ws_ypixel = 0;
+
+#if defined(__APPLE__)
+  // uid / gid are not supported on macOS
+  req->uid = -1;
+  req->gid = -1;
+#else
+  // uid / gid
+  req->uid = info[6].As<Napi::Number>().Int32Value();
+  req->gid = info[7].As<Napi::Number>().Int32Value();
+#endif
+
+  // termios
+  pty_default_termios(&req->term, info[8].As<Napi::Boolean>().Value());
 
   // helperPath
   std::string helper_path = info[9].As<Napi::String>();
 
-  pid_t pid;
-  int master = -1;
-#if defined(__APPLE__)
+#if defined(__APPLE__) || defined(__linux__)
+  // The target is exec'd by spawn-helper once it has taken the slave as its
+  // controlling terminal, see spawn-helper.cc for the argument layout.
   int argc = argv_.Length();
-  int argl = argc + 4;
-  std::unique_ptr<char *, DelBuf> argv_unique_ptr(new char *[argl], DelBuf(argl));
-  char **argv = argv_unique_ptr.get();
+  int argl = argc + 6;
+  req->argv = std::unique_ptr<char *, DelBuf>(new char *[argl], DelBuf(argl));
+  char **argv = req->argv.get();
   argv[0] = strdup(helper_path.c_str());
-  argv[1] = strdup(cwd_.c_str());
-  argv[2] = strdup(file.c_str());
+  argv[1] = strdup(req->cwd.c_str());
+  argv[2] = strdup(std::to_string(req->uid).c_str());
+  argv[3] = strdup(std::to_string(req->gid).c_str());
+  argv[4] = strdup(file.c_str());
   argv[argl - 1] = NULL;
   for (int i = 0; i < argc; i++) {
     std::string arg = argv_.Get(i).As<Napi::String>();
-    argv[i + 3] = strdup(arg.c_str());
-  }
-
-  std::string err;
-  pty_posix_spawn(argv, env, term, &winp, &master, &pid, &err);
-  if (!err.empty()) {
-    if (master != -1) {
-      close(master);
-    }
-    throw Napi::Error::New(napiEnv, err);
-  }
-  if (pty_nonblock(master) == -1) {
-    throw Napi::Error::New(napiEnv, "Could not set master fd to nonblocking.");
+    argv[i + 5] = strdup(arg.c_str());
   }
 #else
   int argc = argv_.Length();
   int argl = argc + 2;
-  std::unique_ptr<char *, DelBuf> argv_unique_ptr(new char *[argl], DelBuf(argl));
-  char** argv = argv_unique_ptr.get();
+  req->argv = std::unique_ptr<char *, DelBuf>(new char *[argl], DelBuf(argl));
+  char** argv = req->argv.get();
   argv[0] = strdup(file.c_str());
   argv[argl - 1] = NULL;
   for (int i = 0; i < argc; i++) {
     std::string arg = argv_.Get(i).As<Napi::String>();
     argv[i + 1] = strdup(arg.c_str());
   }
+#endif
+}
+
+/**
+ * pty_fork_spawn
+ * Opens the pty and starts the process described by req. Does not touch the
+ * JS heap, so it is safe to call off the main thread. Returns an error
+ * message, or an empty string on success.
+ */
+
+static std::string
+pty_fork_spawn(PtyForkRequest* req, PtyForkResult* res) {
+  char **argv = req->argv.get();
+  char **env = req->env.get();
+
+#if defined(__APPLE__) || defined(__linux__)
+  std::string err;
+  pty_posix_spawn(argv, env, &req->term, &req->winp, res, &err);
+  if (!err.empty()) {
+    if (res->master != -1) {
+      close(res->master);
+      res->master = -1;
+    }
+    if (res->timing_fd != -1) {
+      close(res->timing_fd);
+      res->timing_fd = -1;
+    }
+    return err;
+  }
+#else
+  int master = -1;
+  pid_t pid;
+  int uid = req->uid;
+  int gid = req->gid;
 
   sigset_t newmask, oldmask;
   struct sigaction sig_action;
@@ -436,7 +432,7 @@ Napi::Value PtyFork(const Napi::CallbackInfo& info) {
   sigfillset(&newmask);
   pthread_sigmask(SIG_SETMASK, &newmask, &oldmask);
 
-  pid = forkpty(&master, nullptr, static_cast<termios*>(term), static_cast<winsize*>(&winp));
+  pid = forkpty(&master, nullptr, &req->term, &req->winp);
 
   if (!pid) {
     // remove all signal handler from child
@@ -453,10 +449,10 @@ Napi::Value PtyFork(const Napi::CallbackInfo& info) {
 
   switch (pid) {
     case -1:
-      throw Napi::Error::New(napiEnv, "forkpty(3) failed.");
+      return "forkpty(3) failed.";
     case 0:
-      if (strlen(cwd_.c_str())) {
-        if (chdir(cwd_.c_str()) == -1) {
+      if (strlen(req->cwd.c_str())) {
+        if (chdir(req->cwd.c_str()) == -1) {
           perror("chdir(2) failed.");
           _exit(1);
         }
@@ -473,9 +469,6 @@ Napi::Value PtyFork(const Napi::CallbackInfo& info) {
         }
       }
 
-      // Close inherited FDs to prevent leaking pty master FDs to child
-      pty_close_inherited_fds();
-
       {
         char **old = environ;
         environ = env;
@@ -485,84 +478,508 @@ Napi::Value PtyFork(const Napi::CallbackInfo& info) {
         _exit(1);
       }
     default:
+      // forkpty(3) opens the pty and forks in one go.
+      res->opened = res->spawned = uv_hrtime();
       if (pty_nonblock(master) == -1) {
-        throw Napi::Error::New(napiEnv, "Could not set master fd to nonblocking.");
+        close(master);
+        return "Could not set master fd to nonblocking.";
       }
+      res->pty = ptsname(master);
   }
+
+  res->master = master;
+  res->pid = pid;
 #endif
 
-  Napi::Object obj = Napi::Object::New(napiEnv);
-  obj.Set("fd", Napi::Number::New(napiEnv, master));
-  obj.Set("pid", Napi::Number::New(napiEnv, pid));
-  obj.Set("pty", Napi::String::New(napiEnv, ptsname(master)));
+  return std::string();
+}
 
-  // Set up process exit callback.
-  Napi::Function cb = info[10].As<Napi::Function>();
-  SetupExitCallback(napiEnv, cb, pid);
+static Napi::Object
+pty_fork_result(Napi::Env env, const PtyForkResult& res) {
+  Napi::Object obj = Napi::Object::New(env);
+  obj.Set("fd", Napi::Number::New(env, res.master));
+  obj.Set("pid", Napi::Number::New(env, res.pid));
+  obj.Set("pty", Napi::String::New(env, res.pty));
+
+  Napi::Array timestamps = Napi::Array::New(env, 4);
+  timestamps.Set(0u, Napi::Number::New(env, static_cast<double>(res.started)));
+  timestamps.Set(1u, Napi::Number::New(env, static_cast<double>(res.marshalled)));
+  timestamps.Set(2u, Napi::Number::New(env, static_cast<double>(res.opened)));
+  timestamps.Set(3u, Napi::Number::New(env, static_cast<double>(res.spawned)));
+  obj.Set("timestamps", timestamps);
+  obj.Set("timingFd", Napi::Number::New(env, res.timing_fd));
   return obj;
 }
 
-Napi::Value PtyOpen(const Napi::CallbackInfo& info) {
-  Napi::Env env(info.Env());
-  Napi::HandleScope scope(env);
+Napi::Value PtyFork(const Napi::CallbackInfo& info) {
+  Napi::Env napiEnv(info.Env());
+  Napi::HandleScope scope(napiEnv);
 
-  if (info.Length() != 2 ||
-      !info[0].IsNumber() ||
-      !info[1].IsNumber()) {
-    throw Napi::Error::New(env, "Usage: pty.open(cols, rows)");
+  PtyForkResult res;
+  res.started = uv_hrtime();
+
+  PtyForkArgs args(info);
+  if (args.Length() != 11 || !pty_fork_args_valid(args) || !args[10].IsFunction()) {
+    throw Napi::Error::New(napiEnv, "Usage: pty.fork(file, args, env, cwd, cols, rows, uid, gid, utf8, helperPath, onexit)");
   }
 
-  // size
-  struct winsize winp;
-  winp.ws_col = info[0].As<Napi::Number>().Int32Value();
-  winp.ws_row = info[1].As<Napi::Number>().Int32Value();
-  winp.ws_xpixel = 0;
-  winp.ws_ypixel = 0;
+  PtyForkRequest req;
+  pty_fork_marshal(args, &req);
+  res.marshalled = uv_hrtime();
 
-  // pty
-  int master, slave;
-  int ret = openpty(&master, &slave, nullptr, NULL, static_cast<winsize*>(&winp));
+  std::string err = pty_fork_spawn(&req, &res);
+  if (!err.empty()) {
+    throw Napi::Error::New(napiEnv, err);
+  }
 
-  if (ret == -1) {
-    throw Napi::Error::New(env, "openpty(3) failed.");
+  // Set up process exit callback.
+  Napi::Function cb = info[10].As<Napi::Function>();
+  reaper::Watch(napiEnv, cb, res.pid, res.spawned);
+  return pty_fork_result(napiEnv, res);
+}
+
+/**
+ * Batch Fork
+ * Validates and marshals every spec up front, spawns them back to back and
+ * then registers all of the children with the reaper at once. Entries that
+ * fail resolve to { error } rather than failing the whole batch.
+ */
+
+Napi::Value PtyForkMany(const Napi::CallbackInfo& info) {
+  Napi::Env napiEnv(info.Env());
+  Napi::HandleScope scope(napiEnv);
+
+  if (info.Length() != 2 ||
+      !info[0].IsArray() ||
+      !info[1].IsFunction()) {
+    throw Napi::Error::New(napiEnv, "Usage: pty.forkMany(specs, onexit)");
   }
 
-  if (pty_nonblock(master) == -1) {
-    throw Napi::Error::New(env, "Could not set master fd to nonblocking.");
+  uint64_t started = uv_hrtime();
+  Napi::Array specs = info[0].As<Napi::Array>();
+  uint32_t count = specs.Length();
+  std::vector<PtyForkRequest> requests(count);
+  std::vector<std::string> errors(count);
+  for (uint32_t i = 0; i < count; i++) {
+    Napi::Value spec = specs.Get(i);
+    if (spec.IsArray()) {
+      PtyForkArgs args(spec.As<Napi::Array>());
+      if (args.Length() == 10 && pty_fork_args_valid(args)) {
+        pty_fork_marshal(args, &requests[i]);
+        continue;
+      }
+    }
+    errors[i] = "Usage: spec = [file, args, env, cwd, cols, rows, uid, gid, utf8, helperPath]";
   }
 
-  if (pty_nonblock(slave) == -1) {
-    throw Napi::Error::New(env, "Could not set slave fd to nonblocking.");
+  uint64_t marshalled = uv_hrtime();
+  std::vector<PtyForkResult> results(count);
+  std::vector<reaper::Child> children;
+  children.reserve(count);
+  for (uint32_t i = 0; i < count; i++) {
+    if (!errors[i].empty()) {
+      continue;
+    }
+    results[i].started = started;
+    results[i].marshalled = marshalled;
+    errors[i] = pty_fork_spawn(&requests[i], &results[i]);
+    if (errors[i].empty()) {
+      children.push_back({results[i].pid, results[i].spawned});
+    }
   }
 
-  Napi::Object obj = Napi::Object::New(env);
-  obj.Set("master", Napi::Number::New(env, master));
-  obj.Set("slave", Napi::Number::New(env, slave));
-  obj.Set("pty", Napi::String::New(env, ptsname(master)));
+  // Set up process exit callback, shared by the whole batch.
+  reaper::WatchMany(napiEnv, info[1].As<Napi::Function>(), children);
 
-  return obj;
+  Napi::Array forked = Napi::Array::New(napiEnv, count);
+  for (uint32_t i = 0; i < count; i++) {
+    if (errors[i].empty()) {
+      forked.Set(i, pty_fork_result(napiEnv, results[i]));
+    } else {
+      Napi::Object obj = Napi::Object::New(napiEnv);
+      obj.Set("error", Napi::String::New(napiEnv, errors[i]));
+      forked.Set(i, obj);
+    }
+  }
+  return forked;
 }
 
-Napi::Value PtyResize(const Napi::CallbackInfo& info) {
-  Napi::Env env(info.Env());
-  Napi::HandleScope scope(env);
+/**
+ * Async Fork
+ * Runs pty_fork_spawn on the libuv threadpool so opening the pty and starting
+ * the process never blocks the event loop. The promise resolves once the
+ * child is being reaped.
+ */
 
-  if (info.Length() != 5 ||
-      !info[0].IsNumber() ||
-      !info[1].IsNumber() ||
-      !info[2].IsNumber() ||
-      !info[3].IsNumber() ||
-      !info[4].IsNumber()) {
-    throw Napi::Error::New(env, "Usage: pty.resize(fd, cols, rows, xPixel, yPixel)");
+class PtyForkWorker : public Napi::AsyncWorker {
+ public:
+  PtyForkWorker(Napi::Env env, Napi::Function onexit)
+    : Napi::AsyncWorker(env, "node-pty.forkAsync"),
+      deferred_(Napi::Promise::Deferred::New(env)),
+      onexit_(Napi::Persistent(onexit)) {}
+
+  PtyForkRequest* Request() { return &req_; }
+  PtyForkResult* Result() { return &res_; }
+  Napi::Promise Promise() { return deferred_.Promise(); }
+  void KeepAlive(Napi::Object obj) { keep_alive_ = Napi::Persistent(obj); }
+
+ protected:
+  void Execute() override {
+    std::string err = pty_fork_spawn(&req_, &res_);
+    if (!err.empty()) {
+      SetError(err);
+    }
   }
 
-  int fd = info[0].As<Napi::Number>().Int32Value();
+  void OnOK() override {
+    Napi::Env env = Env();
+    try {
+      reaper::Watch(env, onexit_.Value(), res_.pid, res_.spawned);
+    } catch (const Napi::Error& e) {
+      // Nothing else will ever wait for the child, don't leave a zombie.
+      kill(res_.pid, SIGKILL);
+      while (waitpid(res_.pid, nullptr, 0) == -1 && errno == EINTR) {}
+      close(res_.master);
+      if (res_.timing_fd != -1) {
+        close(res_.timing_fd);
+      }
+      deferred_.Reject(e.Value());
+      return;
+    }
+    deferred_.Resolve(pty_fork_result(env, res_));
+  }
 
-  struct winsize winp;
-  winp.ws_col = info[1].As<Napi::Number>().Int32Value();
-  winp.ws_row = info[2].As<Napi::Number>().Int32Value();
-  winp.ws_xpixel = info[3].As<Napi::Number>().Int32Value();
-  winp.ws_ypixel = info[4].As<Napi::Number>().Int32Value();
+  void OnError(const Napi::Error& e) override {
+    deferred_.Reject(e.Value());
+  }
+
+ private:
+  Napi::Promise::Deferred deferred_;
+  Napi::FunctionReference onexit_;
+  Napi::ObjectReference keep_alive_;
+  PtyForkRequest req_;
+  PtyForkResult res_;
+};
+
+Napi::Value PtyForkAsync(const Napi::CallbackInfo& info) {
+  Napi::Env napiEnv(info.Env());
+  Napi::HandleScope scope(napiEnv);
+
+  uint64_t started = uv_hrtime();
+  PtyForkArgs args(info);
+  if (args.Length() != 11 || !pty_fork_args_valid(args) || !args[10].IsFunction()) {
+    throw Napi::Error::New(napiEnv, "Usage: pty.forkAsync(file, args, env, cwd, cols, rows, uid, gid, utf8, helperPath, onexit)");
+  }
+
+  // Owned by the worker itself once queued.
+  std::unique_ptr<PtyForkWorker> worker(new PtyForkWorker(napiEnv, info[10].As<Napi::Function>()));
+  worker->Result()->started = started;
+  pty_fork_marshal(args, worker->Request());
+  worker->Result()->marshalled = uv_hrtime();
+  Napi::Promise promise = worker->Promise();
+  worker.release()->Queue();
+  return promise;
+}
+
+/**
+ * pty_resolve_file
+ * Searches the PATH of env for file like execvp(3) would, so sessions spawned
+ * from a template exec an absolute path. Returns file unchanged when it
+ * contains a slash, when PATH has relative entries that depend on the cwd of
+ * the session, or when it is not found, leaving the search to execvp.
+ */
+
+static std::string
+pty_resolve_file(const std::string& file, char** env) {
+  if (file.empty() || file.find('/') != std::string::npos) {
+    return file;
+  }
+
+  const char *path = nullptr;
+  for (char **e = env; *e != NULL; e++) {
+    if (strncmp(*e, "PATH=", 5) == 0) {
+      path = *e + 5;
+      break;
+    }
+  }
+  if (path == nullptr) {
+    return file;
+  }
+
+  std::string dirs(path);
+  size_t start = 0;
+  while (start <= dirs.size()) {
+    size_t end = dirs.find(':', start);
+    if (end == std::string::npos) {
+      end = dirs.size();
+    }
+    std::string dir = dirs.substr(start, end - start);
+    if (dir.empty() || dir[0] != '/') {
+      return file;
+    }
+    std::string candidate = dir + "/" + file;
+    struct stat st;
+    if (stat(candidate.c_str(), &st) == 0 && S_ISREG(st.st_mode) &&
+        access(candidate.c_str(), X_OK) == 0) {
+      return candidate;
+    }
+    start = end + 1;
+  }
+  return file;
+}
+
+/**
+ * Spawn Template
+ * Keeps a marshalled fork request around so sessions that share a shell and
+ * environment only copy their own overrides. Every session borrows the
+ * template's environment strings rather than duplicating them.
+ */
+
+class PtySpawnTemplate : public Napi::ObjectWrap<PtySpawnTemplate> {
+ public:
+  static Napi::Function Init(Napi::Env env) {
+    return DefineClass(env, "SpawnTemplate", {
+      InstanceMethod("fork", &PtySpawnTemplate::Fork),
+      InstanceMethod("forkAsync", &PtySpawnTemplate::ForkAsync),
+    });
+  }
+
+  explicit PtySpawnTemplate(const Napi::CallbackInfo& info);
+
+ private:
+  Napi::Value Fork(const Napi::CallbackInfo& info);
+  Napi::Value ForkAsync(const Napi::CallbackInfo& info);
+  bool MarshalSession(const Napi::CallbackInfo& info, PtyForkRequest* req);
+
+  PtyForkRequest template_;
+  // The file as given and as found on PATH, see pty_resolve_file.
+  std::string file_;
+  std::string resolved_file_;
+  // Entries of template_.argv and template_.env, excluding the NULL.
+  int argc_ = 0;
+  int envc_ = 0;
+};
+
+PtySpawnTemplate::PtySpawnTemplate(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<PtySpawnTemplate>(info) {
+  Napi::Env napiEnv(info.Env());
+
+  PtyForkArgs args(info);
+  if (args.Length() != 10 || !pty_fork_args_valid(args)) {
+    throw Napi::Error::New(napiEnv, "Usage: new pty.SpawnTemplate(file, args, env, cwd, cols, rows, uid, gid, utf8, helperPath)");
+  }
+
+  pty_fork_marshal(args, &template_);
+  argc_ = info[1].As<Napi::Array>().Length();
+#if defined(__APPLE__) || defined(__linux__)
+  argc_ += 5;
+#else
+  argc_ += 1;
+#endif
+  envc_ = info[2].As<Napi::Array>().Length();
+
+  file_ = info[0].As<Napi::String>();
+  // After setuid the child may not be able to execute what the parent found.
+  if (template_.uid == -1 || template_.gid == -1) {
+    resolved_file_ = pty_resolve_file(file_, template_.env.get());
+  } else {
+    resolved_file_ = file_;
+  }
+}
+
+bool PtySpawnTemplate::MarshalSession(const Napi::CallbackInfo& info,
+                                      PtyForkRequest* req) {
+  if (info.Length() != 6 ||
+      !info[0].IsArray() ||
+      !info[1].IsArray() ||
+      !info[2].IsString() ||
+      !info[3].IsNumber() ||
+      !info[4].IsNumber() ||
+      !info[5].IsFunction()) {
+    return false;
+  }
+
+  // env, the overrides are copied and come first so DelBuf only frees those,
+  // the rest point into the template.
+  Napi::Array env_ = info[1].As<Napi::Array>();
+  int overridec = env_.Length();
+  std::vector<std::string> keys;
+  req->env = std::unique_ptr<char *, DelBuf>(new char *[overridec + envc_ + 1], DelBuf(overridec));
+  char **env = req->env.get();
+  bool path_overridden = false;
+  for (int i = 0; i < overridec; i++) {
+    std::string pair = env_.Get(i).As<Napi::String>();
+    size_t eq = pair.find('=');
+    std::string key = eq == std::string::npos ? pair + "=" : pair.substr(0, eq + 1);
+    path_overridden |= key == "PATH=";
+    keys.push_back(key);
+    env[i] = strdup(pair.c_str());
+  }
+  int envc = overridec;
+  char **template_env = template_.env.get();
+  for (int i = 0; i < envc_; i++) {
+    bool overridden = false;
+    for (const std::string& key : keys) {
+      if (strncmp(template_env[i], key.c_str(), key.size()) == 0) {
+        overridden = true;
+        break;
+      }
+    }
+    if (!overridden) {
+      env[envc++] = template_env[i];
+    }
+  }
+  env[envc] = NULL;
+
+  // cwd
+  std::string cwd = info[2].As<Napi::String>();
+  req->cwd = cwd.empty() ? template_.cwd : cwd;
+
+  // size
+  req->winp = template_.winp;
+  req->winp.ws_col = info[3].As<Napi::Number>().Int32Value();
+  req->winp.ws_row = info[4].As<Napi::Number>().Int32Value();
+
+  req->uid = template_.uid;
+  req->gid = template_.gid;
+  req->term = template_.term;
+
+  // args, appended to those of the template
+  Napi::Array argv_ = info[0].As<Napi::Array>();
+  int argc = argv_.Length();
+  int argl = argc_ + argc + 1;
+  req->argv = std::unique_ptr<char *, DelBuf>(new char *[argl], DelBuf(argl));
+  char **argv = req->argv.get();
+  char **template_argv = template_.argv.get();
+  for (int i = 0; i < argc_; i++) {
+    argv[i] = strdup(template_argv[i]);
+  }
+  // A PATH override means the search has to happen in the child again.
+  const std::string& file = path_overridden ? file_ : resolved_file_;
+#if defined(__APPLE__) || defined(__linux__)
+  free(argv[1]);
+  argv[1] = strdup(req->cwd.c_str());
+  free(argv[4]);
+  argv[4] = strdup(file.c_str());
+#else
+  free(argv[0]);
+  argv[0] = strdup(file.c_str());
+#endif
+  for (int i = 0; i < argc; i++) {
+    std::string arg = argv_.Get(i).As<Napi::String>();
+    argv[argc_ + i] = strdup(arg.c_str());
+  }
+  argv[argl - 1] = NULL;
+  return true;
+}
+
+Napi::Value PtySpawnTemplate::Fork(const Napi::CallbackInfo& info) {
+  Napi::Env napiEnv(info.Env());
+  Napi::HandleScope scope(napiEnv);
+
+  PtyForkResult res;
+  res.started = uv_hrtime();
+
+  PtyForkRequest req;
+  if (!MarshalSession(info, &req)) {
+    throw Napi::Error::New(napiEnv, "Usage: template.fork(args, env, cwd, cols, rows, onexit)");
+  }
+  res.marshalled = uv_hrtime();
+
+  std::string err = pty_fork_spawn(&req, &res);
+  if (!err.empty()) {
+    throw Napi::Error::New(napiEnv, err);
+  }
+
+  // Set up process exit callback.
+  Napi::Function cb = info[5].As<Napi::Function>();
+  reaper::Watch(napiEnv, cb, res.pid, res.spawned);
+  return pty_fork_result(napiEnv, res);
+}
+
+Napi::Value PtySpawnTemplate::ForkAsync(const Napi::CallbackInfo& info) {
+  Napi::Env napiEnv(info.Env());
+  Napi::HandleScope scope(napiEnv);
+
+  uint64_t started = uv_hrtime();
+  if (info.Length() != 6 || !info[5].IsFunction()) {
+    throw Napi::Error::New(napiEnv, "Usage: template.forkAsync(args, env, cwd, cols, rows, onexit)");
+  }
+  // Owned by the worker itself once queued.
+  std::unique_ptr<PtyForkWorker> worker(new PtyForkWorker(napiEnv, info[5].As<Napi::Function>()));
+  worker->Result()->started = started;
+  if (!MarshalSession(info, worker->Request())) {
+    throw Napi::Error::New(napiEnv, "Usage: template.forkAsync(args, env, cwd, cols, rows, onexit)");
+  }
+  worker->Result()->marshalled = uv_hrtime();
+  // The request borrows the template's environment until it has run.
+  worker->KeepAlive(Value());
+  Napi::Promise promise = worker->Promise();
+  worker.release()->Queue();
+  return promise;
+}
+
+Napi::Value PtyOpen(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  Napi::HandleScope scope(env);
+
+  if (info.Length() != 2 ||
+      !info[0].IsNumber() ||
+      !info[1].IsNumber()) {
+    throw Napi::Error::New(env, "Usage: pty.open(cols, rows)");
+  }
+
+  // size
+  struct winsize winp;
+  winp.ws_col = info[0].As<Napi::Number>().Int32Value();
+  winp.ws_row = info[1].As<Napi::Number>().Int32Value();
+  winp.ws_xpixel = 0;
+  winp.ws_ypixel = 0;
+
+  // pty
+  int master, slave;
+  int ret = openpty(&master, &slave, nullptr, NULL, static_cast<winsize*>(&winp));
+
+  if (ret == -1) {
+    throw Napi::Error::New(env, "openpty(3) failed.");
+  }
+
+  if (pty_nonblock(master) == -1) {
+    throw Napi::Error::New(env, "Could not set master fd to nonblocking.");
+  }
+
+  if (pty_nonblock(slave) == -1) {
+    throw Napi::Error::New(env, "Could not set slave fd to nonblocking.");
+  }
+
+  Napi::Object obj = Napi::Object::New(env);
+  obj.Set("master", Napi::Number::New(env, master));
+  obj.Set("slave", Napi::Number::New(env, slave));
+  obj.Set("pty", Napi::String::New(env, ptsname(master)));
+
+  return obj;
+}
+
+Napi::Value PtyResize(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  Napi::HandleScope scope(env);
+
+  if (info.Length() != 5 ||
+      !info[0].IsNumber() ||
+      !info[1].IsNumber() ||
+      !info[2].IsNumber() ||
+      !info[3].IsNumber() ||
+      !info[4].IsNumber()) {
+    throw Napi::Error::New(env, "Usage: pty.resize(fd, cols, rows, xPixel, yPixel)");
+  }
+
+  int fd = info[0].As<Napi::Number>().Int32Value();
+
+  struct winsize winp;
+  winp.ws_col = info[1].As<Napi::Number>().Int32Value();
+  winp.ws_row = info[2].As<Napi::Number>().Int32Value();
+  winp.ws_xpixel = info[3].As<Napi::Number>().Int32Value();
+  winp.ws_ypixel = info[4].As<Napi::Number>().Int32Value();
 
   if (ioctl(fd, TIOCSWINSZ, &winp) == -1) {
     switch (errno) {
@@ -575,49 +992,784 @@ Napi::Value PtyResize(const Napi::CallbackInfo& info) {
       case ENOTTY:
         throw Napi::Error::New(env, "ioctl(2) failed, ENOTTY");
     }
-    throw Napi::Error::New(env, "ioctl(2) failed");
+    throw Napi::Error::New(env, "ioctl(2) failed");
+  }
+
+  return env.Undefined();
+}
+
+/**
+ * Foreground Process Name
+ */
+Napi::Value PtyGetProc(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  Napi::HandleScope scope(env);
+
+#if defined(__APPLE__)
+  if (info.Length() != 1 ||
+      !info[0].IsNumber()) {
+    throw Napi::Error::New(env, "Usage: pty.process(pid)");
+  }
+
+  int fd = info[0].As<Napi::Number>().Int32Value();
+  char *name = pty_getproc(fd);
+#else
+  if (info.Length() != 2 ||
+      !info[0].IsNumber() ||
+      !info[1].IsString()) {
+    throw Napi::Error::New(env, "Usage: pty.process(fd, tty)");
+  }
+
+  int fd = info[0].As<Napi::Number>().Int32Value();
+
+  std::string tty_ = info[1].As<Napi::String>();
+  char *tty = strdup(tty_.c_str());
+  char *name = pty_getproc(fd, tty);
+  free(tty);
+#endif
+
+  if (name == NULL) {
+    return env.Undefined();
+  }
+
+  Napi::String name_ = Napi::String::New(env, name);
+  free(name);
+  return name_;
+}
+
+/**
+ * Foreground Process Info
+ * Describes the foreground process of many ptys on the libuv threadpool, so
+ * polling every terminal never blocks the event loop on /proc. The fds are
+ * duplicated first, a pty closed meanwhile can't have its fd reused under
+ * the worker.
+ */
+
+class PtyProcessInfoWorker : public Napi::AsyncWorker {
+ public:
+  PtyProcessInfoWorker(Napi::Env env, std::vector<int> fds)
+    : Napi::AsyncWorker(env, "node-pty.getProcessInfo"),
+      deferred_(Napi::Promise::Deferred::New(env)),
+      fds_(std::move(fds)),
+      infos_(fds_.size()),
+      found_(fds_.size(), false) {}
+
+  ~PtyProcessInfoWorker() override {
+    for (int fd : fds_) {
+      if (fd != -1) {
+        close(fd);
+      }
+    }
+  }
+
+  Napi::Promise Promise() { return deferred_.Promise(); }
+
+ protected:
+  void Execute() override {
+    for (size_t i = 0; i < fds_.size(); i++) {
+      found_[i] = fds_[i] != -1 &&
+                  procinfo::Get(fds_[i], procinfo::kAll, &infos_[i]);
+    }
+  }
+
+  void OnOK() override {
+    Napi::Env env = Env();
+    Napi::HandleScope scope(env);
+    Napi::Array result = Napi::Array::New(env, infos_.size());
+    for (size_t i = 0; i < infos_.size(); i++) {
+      if (!found_[i]) {
+        result.Set(i, env.Undefined());
+        continue;
+      }
+      const procinfo::Info& info = infos_[i];
+      Napi::Object obj = Napi::Object::New(env);
+      obj.Set("pid", Napi::Number::New(env, info.pid));
+      obj.Set("name", Napi::String::New(env, info.name));
+      Napi::Array argv = Napi::Array::New(env, info.argv.size());
+      for (size_t j = 0; j < info.argv.size(); j++) {
+        argv.Set(j, Napi::String::New(env, info.argv[j]));
+      }
+      obj.Set("argv", argv);
+      if (info.cwd.empty()) {
+        obj.Set("cwd", env.Undefined());
+      } else {
+        obj.Set("cwd", Napi::String::New(env, info.cwd));
+      }
+      result.Set(i, obj);
+    }
+    deferred_.Resolve(result);
+  }
+
+  void OnError(const Napi::Error& e) override {
+    deferred_.Reject(e.Value());
+  }
+
+ private:
+  Napi::Promise::Deferred deferred_;
+  std::vector<int> fds_;
+  std::vector<procinfo::Info> infos_;
+  std::vector<bool> found_;
+};
+
+Napi::Value PtyGetProcessInfo(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  Napi::HandleScope scope(env);
+
+  if (info.Length() != 1 ||
+      !info[0].IsArray()) {
+    throw Napi::Error::New(env, "Usage: pty.getProcessInfo(fds)");
+  }
+
+  Napi::Array fds_ = info[0].As<Napi::Array>();
+  std::vector<int> fds(fds_.Length(), -1);
+  for (uint32_t i = 0; i < fds_.Length(); i++) {
+    Napi::Value fd = fds_.Get(i);
+    if (!fd.IsNumber()) {
+      throw Napi::Error::New(env, "Usage: pty.getProcessInfo(fds)");
+    }
+    fds[i] = fd.As<Napi::Number>().Int32Value();
+  }
+  for (int& fd : fds) {
+    // Closed terminals are passed as -1.
+    fd = fd >= 0 ? fcntl(fd, F_DUPFD_CLOEXEC, 0) : -1;
+  }
+
+  // Owned by the worker itself once queued.
+  PtyProcessInfoWorker* worker = new PtyProcessInfoWorker(env, std::move(fds));
+  Napi::Promise promise = worker->Promise();
+  worker->Queue();
+  return promise;
+}
+
+/**
+ * Pty Pool
+ */
+
+Napi::Value PtyConfigurePool(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  Napi::HandleScope scope(env);
+
+  if (info.Length() != 2 ||
+      !info[0].IsNumber() ||
+      !info[1].IsNumber()) {
+    throw Napi::Error::New(env, "Usage: pty.configurePool(size, lowWatermark)");
+  }
+
+  int size = info[0].As<Napi::Number>().Int32Value();
+  int low_watermark = info[1].As<Napi::Number>().Int32Value();
+  if (size < 0 || low_watermark < 0) {
+    throw Napi::Error::New(env, "The pool size and low watermark must not be negative.");
+  }
+
+#if defined(__APPLE__) || defined(__linux__)
+  pty_pool::Configure(size, low_watermark, pty_pool_open);
+#else
+  // Only spawns through posix_spawn take pairs from the pool.
+  (void)size;
+  (void)low_watermark;
+#endif
+  return env.Undefined();
+}
+
+Napi::Value PtyGetPoolStats(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  Napi::HandleScope scope(env);
+
+  pty_pool::Stats stats = pty_pool::GetStats();
+  Napi::Object obj = Napi::Object::New(env);
+  obj.Set("size", Napi::Number::New(env, stats.size));
+  obj.Set("lowWatermark", Napi::Number::New(env, stats.low_watermark));
+  obj.Set("available", Napi::Number::New(env, stats.available));
+  obj.Set("hits", Napi::Number::New(env, stats.hits));
+  obj.Set("misses", Napi::Number::New(env, stats.misses));
+  return obj;
+}
+
+/**
+ * Spawn Timings
+ * Drains and closes the timing pipe of a spawn, returning the uv_hrtime()
+ * style timestamps spawn-helper wrote to it. Only complete once the target has
+ * been exec'd, which is certain after its first output or its exit.
+ */
+
+Napi::Value PtyReadSpawnTimings(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  Napi::HandleScope scope(env);
+
+  if (info.Length() != 1 ||
+      !info[0].IsNumber()) {
+    throw Napi::Error::New(env, "Usage: pty.readSpawnTimings(fd)");
+  }
+
+  int fd = info[0].As<Napi::Number>().Int32Value();
+  uint64_t stamps[8];
+  size_t len = 0;
+  if (fd != -1) {
+    char *buf = reinterpret_cast<char *>(stamps);
+    while (len < sizeof(stamps)) {
+      ssize_t r = read(fd, buf + len, sizeof(stamps) - len);
+      if (r == -1 && errno == EINTR) {
+        continue;
+      }
+      if (r <= 0) {
+        break;
+      }
+      len += r;
+    }
+    close(fd);
+  }
+
+  size_t count = len / sizeof(uint64_t);
+  Napi::Array timestamps = Napi::Array::New(env, count);
+  for (size_t i = 0; i < count; i++) {
+    timestamps.Set(i, Napi::Number::New(env, static_cast<double>(stamps[i])));
+  }
+  return timestamps;
+}
+
+/**
+ * Scrollback
+ * Wraps a scrollback::Log, kept in memory or, given a directory, in segment
+ * files. The log is shared with the reader that fills it, see startReading.
+ * Sequence numbers are passed to JS as numbers, which are exact up to 2^53
+ * bytes.
+ */
+
+class PtyScrollback : public Napi::ObjectWrap<PtyScrollback> {
+ public:
+  static Napi::Function Init(Napi::Env env) {
+    return DefineClass(env, "Scrollback", {
+      InstanceMethod("read", &PtyScrollback::Read),
+      InstanceMethod("range", &PtyScrollback::Range),
+    });
+  }
+
+  explicit PtyScrollback(const Napi::CallbackInfo& info);
+
+  std::shared_ptr<scrollback::Log> log() const { return log_; }
+
+ private:
+  Napi::Value Read(const Napi::CallbackInfo& info);
+  Napi::Value Range(const Napi::CallbackInfo& info);
+
+  std::shared_ptr<scrollback::Log> log_;
+};
+
+PtyScrollback::PtyScrollback(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<PtyScrollback>(info) {
+  Napi::Env env(info.Env());
+  if ((info.Length() != 1 && info.Length() != 3) ||
+      !info[0].IsNumber() ||
+      info[0].As<Napi::Number>().DoubleValue() < 1 ||
+      (info.Length() == 3 && (!info[1].IsString() ||
+                              !info[2].IsNumber() ||
+                              info[2].As<Napi::Number>().DoubleValue() < 1))) {
+    throw Napi::Error::New(env, "Usage: new pty.Scrollback(limit[, directory, segmentSize])");
+  }
+  size_t limit = static_cast<size_t>(info[0].As<Napi::Number>().DoubleValue());
+  if (info.Length() == 1) {
+    log_ = std::make_shared<scrollback::MemoryLog>(limit);
+    return;
+  }
+
+  std::string directory = info[1].As<Napi::String>();
+  size_t segment_size = static_cast<size_t>(info[2].As<Napi::Number>().DoubleValue());
+  auto log = std::make_shared<scrollback::SegmentLog>(directory, segment_size, limit);
+  std::string err;
+  if (!log->Open(&err)) {
+    throw Napi::Error::New(env, err);
+  }
+  log_ = log;
+}
+
+Napi::Value PtyScrollback::Read(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  Napi::HandleScope scope(env);
+
+  if (info.Length() != 2 ||
+      !info[0].IsNumber() ||
+      !info[1].IsNumber()) {
+    throw Napi::Error::New(env, "Usage: scrollback.read(seq, end)");
+  }
+
+  uint64_t seq = static_cast<uint64_t>(std::max(0.0, info[0].As<Napi::Number>().DoubleValue()));
+  uint64_t end = static_cast<uint64_t>(std::max(0.0, info[1].As<Napi::Number>().DoubleValue()));
+  std::string data;
+  uint64_t from = log_->Read(seq, end, &data);
+
+  Napi::Object obj = Napi::Object::New(env);
+  obj.Set("seq", Napi::Number::New(env, static_cast<double>(from)));
+  obj.Set("data", Napi::Buffer<char>::Copy(env, data.data(), data.size()));
+  std::string error = log_->Error();
+  if (!error.empty()) {
+    obj.Set("error", Napi::String::New(env, error));
+  }
+  return obj;
+}
+
+Napi::Value PtyScrollback::Range(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  Napi::HandleScope scope(env);
+
+  Napi::Array range = Napi::Array::New(env, 2);
+  range.Set(0u, Napi::Number::New(env, static_cast<double>(log_->Start())));
+  range.Set(1u, Napi::Number::New(env, static_cast<double>(log_->End())));
+  return range;
+}
+
+/**
+ * ShellTracker
+ * Wraps a tracker::Tracker, fed by the reader it is passed to.
+ */
+
+class PtyShellTracker : public Napi::ObjectWrap<PtyShellTracker> {
+ public:
+  static Napi::Function Init(Napi::Env env) {
+    return DefineClass(env, "ShellTracker", {
+      InstanceMethod("snapshot", &PtyShellTracker::Snapshot),
+    });
+  }
+
+  explicit PtyShellTracker(const Napi::CallbackInfo& info);
+
+  std::shared_ptr<tracker::Tracker> tracker() const { return tracker_; }
+
+ private:
+  Napi::Value Snapshot(const Napi::CallbackInfo& info);
+
+  std::shared_ptr<tracker::Tracker> tracker_;
+};
+
+PtyShellTracker::PtyShellTracker(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<PtyShellTracker>(info) {
+  Napi::Env env(info.Env());
+  if (info.Length() != 1 ||
+      !info[0].IsNumber() ||
+      info[0].As<Napi::Number>().DoubleValue() < 0) {
+    throw Napi::Error::New(env, "Usage: new pty.ShellTracker(history)");
+  }
+  size_t history = static_cast<size_t>(info[0].As<Napi::Number>().DoubleValue());
+  tracker_ = std::make_shared<tracker::Tracker>(history);
+}
+
+Napi::Value PtyShellTracker::Snapshot(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  Napi::HandleScope scope(env);
+
+  tracker::Snapshot snapshot = tracker_->GetSnapshot();
+  Napi::Object obj = Napi::Object::New(env);
+  obj.Set("cwd", snapshot.cwd);
+  Napi::Array commands = Napi::Array::New(env, snapshot.commands.size());
+  for (size_t i = 0; i < snapshot.commands.size(); i++) {
+    commands.Set(static_cast<uint32_t>(i), reader::CommandToObject(env, snapshot.commands[i]));
+  }
+  obj.Set("commands", commands);
+  if (snapshot.has_current) {
+    obj.Set("current", reader::CommandToObject(env, snapshot.current));
+  }
+  return obj;
+}
+
+/**
+ * Recording
+ * Wraps a recorder::Recording. Output is queued by the reader it is attached
+ * to with recordOutput, input by the writer it is attached to with record,
+ * resizes by JS.
+ */
+
+class PtyRecording : public Napi::ObjectWrap<PtyRecording> {
+ public:
+  static Napi::Function Init(Napi::Env env) {
+    return DefineClass(env, "Recording", {
+      InstanceMethod("resize", &PtyRecording::Resize),
+      InstanceMethod("close", &PtyRecording::Close),
+    });
+  }
+
+  explicit PtyRecording(const Napi::CallbackInfo& info);
+
+  std::shared_ptr<recorder::Recording> recording() const { return recording_; }
+
+ private:
+  Napi::Value Resize(const Napi::CallbackInfo& info);
+  Napi::Value Close(const Napi::CallbackInfo& info);
+
+  std::shared_ptr<recorder::Recording> recording_;
+};
+
+PtyRecording::PtyRecording(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<PtyRecording>(info) {
+  Napi::Env env(info.Env());
+  if (info.Length() != 5 ||
+      !info[0].IsString() ||
+      !info[1].IsNumber() ||
+      !info[2].IsNumber() ||
+      !info[3].IsString() ||
+      !info[4].IsString()) {
+    throw Napi::Error::New(env, "Usage: new pty.Recording(path, cols, rows, title, term)");
+  }
+
+  std::string err;
+  recording_ = recorder::Open(info[0].As<Napi::String>(),
+                              info[1].As<Napi::Number>().Int32Value(),
+                              info[2].As<Napi::Number>().Int32Value(),
+                              info[3].As<Napi::String>(),
+                              info[4].As<Napi::String>(), &err);
+  if (!recording_) {
+    throw Napi::Error::New(env, err);
+  }
+}
+
+Napi::Value PtyRecording::Resize(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  Napi::HandleScope scope(env);
+
+  if (info.Length() != 2 ||
+      !info[0].IsNumber() ||
+      !info[1].IsNumber()) {
+    throw Napi::Error::New(env, "Usage: recording.resize(cols, rows)");
+  }
+
+  recording_->Resize(info[0].As<Napi::Number>().Int32Value(),
+                     info[1].As<Napi::Number>().Int32Value(), uv_hrtime());
+  return env.Undefined();
+}
+
+Napi::Value PtyRecording::Close(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  recording_->Close();
+  return env.Undefined();
+}
+
+/**
+ * Writer
+ * Wraps a writer::Writer, calling back on the JS thread with 0 once queued
+ * input was written or with the errno of a failed write. Input is queued to
+ * the recording attached with record as it is written, on the same clock as
+ * the output the reader queues.
+ */
+
+class PtyWriter : public Napi::ObjectWrap<PtyWriter> {
+ public:
+  static Napi::Function Init(Napi::Env env) {
+    return DefineClass(env, "Writer", {
+      InstanceMethod("write", &PtyWriter::Write),
+      InstanceMethod("record", &PtyWriter::Record),
+      InstanceMethod("stats", &PtyWriter::Stats),
+      InstanceMethod("close", &PtyWriter::Close),
+    });
+  }
+
+  explicit PtyWriter(const Napi::CallbackInfo& info);
+
+ private:
+  Napi::Value Write(const Napi::CallbackInfo& info);
+  Napi::Value Record(const Napi::CallbackInfo& info);
+  Napi::Value Stats(const Napi::CallbackInfo& info);
+  Napi::Value Close(const Napi::CallbackInfo& info);
+  void Call(int error);
+
+  Napi::FunctionReference cb_;
+  std::shared_ptr<recorder::Recording> recording_;
+  std::unique_ptr<Napi::AsyncContext> context_;
+  // Destroyed first, it never calls back once closed.
+  std::unique_ptr<writer::Writer> writer_;
+};
+
+PtyWriter::PtyWriter(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<PtyWriter>(info) {
+  Napi::Env env(info.Env());
+  if (info.Length() != 5 ||
+      !info[0].IsNumber() ||
+      !info[1].IsString() ||
+      !info[2].IsBoolean() ||
+      !info[3].IsBoolean() ||
+      !info[4].IsFunction()) {
+    throw Napi::Error::New(env, "Usage: new pty.Writer(fd, slave, discardOnInterrupt, paced, callback)");
+  }
+
+  uv_loop_t* loop = nullptr;
+  if (napi_get_uv_event_loop(env, &loop) != napi_ok) {
+    throw Napi::Error::New(env, "napi_get_uv_event_loop() failed.");
+  }
+  cb_ = Napi::Persistent(info[4].As<Napi::Function>());
+  context_.reset(new Napi::AsyncContext(env, "node-pty.writer"));
+  std::string slave = info[1].As<Napi::String>();
+  writer_.reset(new writer::Writer(loop, info[0].As<Napi::Number>().Int32Value(),
+                                   slave, info[2].As<Napi::Boolean>().Value(),
+                                   info[3].As<Napi::Boolean>().Value(),
+                                   [this](int error) { Call(error); }));
+  std::string err;
+  if (!writer_->Open(&err)) {
+    throw Napi::Error::New(env, err);
+  }
+}
+
+void PtyWriter::Call(int error) {
+  Napi::Env env = cb_.Env();
+  Napi::HandleScope scope(env);
+  try {
+    cb_.MakeCallback(env.Global(), {Napi::Number::New(env, error)}, *context_);
+  } catch (const Napi::Error& e) {
+    // Called from libuv, there is no JS caller to throw to.
+    napi_fatal_exception(env, e.Value());
+  }
+}
+
+Napi::Value PtyWriter::Write(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  Napi::HandleScope scope(env);
+
+  // What is queued is not copied: buffers are referenced until written, as
+  // they are by fs.write, and strings are converted once.
+  size_t queued;
+  if (info.Length() == 1 && info[0].IsBuffer()) {
+    Napi::Buffer<char> data = info[0].As<Napi::Buffer<char>>();
+    if (recording_) {
+      recording_->Input(data.Data(), data.Length(), uv_hrtime());
+    }
+    queued = writer_->Write(data.Data(), data.Length(), [&data]() {
+      Napi::Object buffer = data;
+      return std::shared_ptr<void>(
+          new Napi::ObjectReference(Napi::Persistent(buffer)),
+          [](void* ref) { delete static_cast<Napi::ObjectReference*>(ref); });
+    });
+  } else if (info.Length() == 1 && info[0].IsString()) {
+    auto data = std::make_shared<std::string>(info[0].As<Napi::String>());
+    if (recording_) {
+      recording_->Input(data->data(), data->size(), uv_hrtime());
+    }
+    queued = writer_->Write(data->data(), data->size(), [&data]() {
+      return std::shared_ptr<void>(data);
+    });
+  } else {
+    throw Napi::Error::New(env, "Usage: writer.write(data)");
+  }
+  return Napi::Number::New(env, static_cast<double>(queued));
+}
+
+Napi::Value PtyWriter::Record(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  Napi::HandleScope scope(env);
+
+  if (info.Length() != 1 ||
+      !(info[0].IsObject() || info[0].IsNull())) {
+    throw Napi::Error::New(env, "Usage: writer.record(recording)");
+  }
+
+  recording_.reset();
+  if (info[0].IsObject()) {
+    recording_ = PtyRecording::Unwrap(info[0].As<Napi::Object>())->recording();
   }
+  return env.Undefined();
+}
+
+Napi::Value PtyWriter::Stats(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  Napi::HandleScope scope(env);
+
+  writer::Stats stats = writer_->GetStats();
+  Napi::Object obj = Napi::Object::New(env);
+  obj.Set("writes", static_cast<double>(stats.writes));
+  obj.Set("bytes", static_cast<double>(stats.bytes));
+  obj.Set("retries", static_cast<double>(stats.retries));
+  obj.Set("backpressuredTime", stats.backpressured / 1e6);
+  obj.Set("queue", static_cast<double>(stats.queue));
+  obj.Set("queueBytes", static_cast<double>(stats.queue_bytes));
+  return obj;
+}
 
+Napi::Value PtyWriter::Close(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  writer_->Close();
   return env.Undefined();
 }
 
 /**
- * Foreground Process Name
+ * Native Reader
+ * See reader.h, ids are passed to JS as numbers.
  */
-Napi::Value PtyGetProc(const Napi::CallbackInfo& info) {
+
+Napi::Value PtyStartReading(const Napi::CallbackInfo& info) {
   Napi::Env env(info.Env());
   Napi::HandleScope scope(env);
 
-#if defined(__APPLE__)
+  if (info.Length() < 2 || info.Length() > 3 ||
+      !info[0].IsNumber() ||
+      !info[1].IsFunction() ||
+      (info.Length() == 3 && !info[2].IsObject())) {
+    throw Napi::Error::New(env, "Usage: pty.startReading(fd, ondata[, options])");
+  }
+
+  // Every option may be left out, null or undefined.
+  Napi::Value ring = env.Undefined();
+  reader::Options options;
+  if (info.Length() == 3) {
+    Napi::Object obj = info[2].As<Napi::Object>();
+    ring = obj.Get("ring");
+    Napi::Value scrollback = obj.Get("scrollback");
+    Napi::Value tracker = obj.Get("tracker");
+    Napi::Value hold_partial = obj.Get("holdPartial");
+    Napi::Value plain = obj.Get("plain");
+    if ((ring.IsTypedArray() &&
+         ring.As<Napi::TypedArray>().TypedArrayType() != napi_uint8_array) ||
+        (!ring.IsTypedArray() && !ring.IsNull() && !ring.IsUndefined()) ||
+        (!scrollback.IsObject() && !scrollback.IsNull() && !scrollback.IsUndefined()) ||
+        (!tracker.IsObject() && !tracker.IsNull() && !tracker.IsUndefined()) ||
+        (!hold_partial.IsBoolean() && !hold_partial.IsUndefined()) ||
+        (!plain.IsFunction() && !plain.IsNull() && !plain.IsUndefined()) ||
+        (ring.IsTypedArray() && hold_partial.IsBoolean() && hold_partial.As<Napi::Boolean>())) {
+      throw Napi::Error::New(env, "Usage: pty.startReading(fd, ondata[, { ring, scrollback, tracker, holdPartial, plain }])");
+    }
+    options.hold_partial = hold_partial.IsBoolean() && hold_partial.As<Napi::Boolean>();
+    if (plain.IsFunction()) {
+      options.plain = plain.As<Napi::Function>();
+    }
+    if (scrollback.IsObject()) {
+      options.log = PtyScrollback::Unwrap(scrollback.As<Napi::Object>())->log();
+    }
+    if (tracker.IsObject()) {
+      options.tracker = PtyShellTracker::Unwrap(tracker.As<Napi::Object>())->tracker();
+    }
+  }
+
+  int fd = info[0].As<Napi::Number>().Int32Value();
+  uint64_t id = ring.IsTypedArray()
+    ? reader::StartRing(env, info[1].As<Napi::Function>(), fd,
+                        ring.As<Napi::Uint8Array>(), std::move(options))
+    : reader::Start(env, info[1].As<Napi::Function>(), fd, std::move(options));
+  return Napi::Number::New(env, static_cast<double>(id));
+}
+
+static uint64_t
+pty_reader_id(const Napi::CallbackInfo& info, const char* usage) {
   if (info.Length() != 1 ||
       !info[0].IsNumber()) {
-    throw Napi::Error::New(env, "Usage: pty.process(pid)");
+    throw Napi::Error::New(info.Env(), usage);
   }
+  return static_cast<uint64_t>(info[0].As<Napi::Number>().DoubleValue());
+}
+
+Napi::Value PtyPauseReading(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  Napi::HandleScope scope(env);
+  reader::Pause(env, pty_reader_id(info, "Usage: pty.pauseReading(id)"));
+  return env.Undefined();
+}
+
+Napi::Value PtyResumeReading(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  Napi::HandleScope scope(env);
+  reader::Resume(env, pty_reader_id(info, "Usage: pty.resumeReading(id)"));
+  return env.Undefined();
+}
+
+Napi::Value PtyRingConsumed(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  Napi::HandleScope scope(env);
+  reader::Consumed(env, pty_reader_id(info, "Usage: pty.ringConsumed(id)"));
+  return env.Undefined();
+}
+
+Napi::Value PtyRecordOutput(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  Napi::HandleScope scope(env);
 
-  int fd = info[0].As<Napi::Number>().Int32Value();
-  char *name = pty_getproc(fd);
-#else
   if (info.Length() != 2 ||
       !info[0].IsNumber() ||
-      !info[1].IsString()) {
-    throw Napi::Error::New(env, "Usage: pty.process(fd, tty)");
+      !(info[1].IsObject() || info[1].IsNull())) {
+    throw Napi::Error::New(env, "Usage: pty.recordOutput(id, recording)");
   }
 
-  int fd = info[0].As<Napi::Number>().Int32Value();
+  uint64_t id = static_cast<uint64_t>(info[0].As<Napi::Number>().DoubleValue());
+  std::shared_ptr<recorder::Recording> recording;
+  if (info[1].IsObject()) {
+    recording = PtyRecording::Unwrap(info[1].As<Napi::Object>())->recording();
+  }
+  reader::Record(env, id, std::move(recording));
+  return env.Undefined();
+}
 
-  std::string tty_ = info[1].As<Napi::String>();
-  char *tty = strdup(tty_.c_str());
-  char *name = pty_getproc(fd, tty);
-  free(tty);
-#endif
+Napi::Value PtyWaitFor(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  Napi::HandleScope scope(env);
 
-  if (name == NULL) {
-    return env.Undefined();
+  if (info.Length() != 3 ||
+      !info[0].IsNumber() ||
+      !info[1].IsArray() ||
+      !info[2].IsFunction()) {
+    throw Napi::Error::New(env, "Usage: pty.waitFor(id, patterns, callback)");
   }
 
-  Napi::String name_ = Napi::String::New(env, name);
-  free(name);
-  return name_;
+  Napi::Array array = info[1].As<Napi::Array>();
+  std::vector<std::string> patterns;
+  for (uint32_t i = 0; i < array.Length(); i++) {
+    Napi::Value value = array.Get(i);
+    if (!value.IsBuffer() || value.As<Napi::Buffer<char>>().Length() == 0) {
+      throw Napi::Error::New(env, "Patterns must be non-empty Buffers.");
+    }
+    Napi::Buffer<char> pattern = value.As<Napi::Buffer<char>>();
+    patterns.emplace_back(pattern.Data(), pattern.Length());
+  }
+  if (patterns.empty()) {
+    throw Napi::Error::New(env, "At least one pattern is required.");
+  }
+
+  uint64_t id = static_cast<uint64_t>(info[0].As<Napi::Number>().DoubleValue());
+  uint32_t wait = reader::WaitFor(env, id, patterns, info[2].As<Napi::Function>());
+  return Napi::Number::New(env, wait);
+}
+
+Napi::Value PtyCancelWait(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  Napi::HandleScope scope(env);
+
+  if (info.Length() != 2 ||
+      !info[0].IsNumber() ||
+      !info[1].IsNumber()) {
+    throw Napi::Error::New(env, "Usage: pty.cancelWait(id, wait)");
+  }
+
+  uint64_t id = static_cast<uint64_t>(info[0].As<Napi::Number>().DoubleValue());
+  reader::CancelWait(env, id, info[1].As<Napi::Number>().Uint32Value());
+  return env.Undefined();
+}
+
+Napi::Value PtyReadStats(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  Napi::HandleScope scope(env);
+
+  std::shared_ptr<const reader::Stats> stats =
+      reader::GetStats(env, pty_reader_id(info, "Usage: pty.readStats(id)"));
+  if (!stats) {
+    return env.Null();
+  }
+  const auto relaxed = std::memory_order_relaxed;
+  uint64_t stalled = stats->stalled.load(relaxed);
+  uint64_t since = stats->stalled_since.load(relaxed);
+  if (since != 0) {
+    stalled += uv_hrtime() - since;
+  }
+  Napi::Array sizes = Napi::Array::New(env, reader::kSizeBuckets);
+  for (size_t i = 0; i < reader::kSizeBuckets; i++) {
+    sizes.Set(static_cast<uint32_t>(i),
+              static_cast<double>(stats->sizes[i].load(relaxed)));
+  }
+  Napi::Object obj = Napi::Object::New(env);
+  obj.Set("reads", static_cast<double>(stats->reads.load(relaxed)));
+  obj.Set("wouldBlock", static_cast<double>(stats->would_block.load(relaxed)));
+  obj.Set("bytes", static_cast<double>(stats->bytes.load(relaxed)));
+  obj.Set("sizes", sizes);
+  obj.Set("pending", static_cast<double>(stats->pending.load(relaxed)));
+  obj.Set("stalledTime", stalled / 1e6);
+  return obj;
+}
+
+Napi::Value PtyStopReading(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  Napi::HandleScope scope(env);
+  reader::Stop(env, pty_reader_id(info, "Usage: pty.stopReading(id)"));
+  return env.Undefined();
 }
 
 /**
@@ -657,42 +1809,12 @@ pty_nonblock(int fd) {
 
 static char *
 pty_getproc(int fd, char *tty) {
-  FILE *f;
-  char *path, *buf;
-  size_t len;
-  int ch;
-  pid_t pgrp;
-  int r;
-
-  if ((pgrp = tcgetpgrp(fd)) == -1) {
-    return NULL;
-  }
-
-  r = asprintf(&path, "/proc/%lld/cmdline", (long long)pgrp);
-  if (r == -1 || path == NULL) return NULL;
-
-  if ((f = fopen(path, "r")) == NULL) {
-    free(path);
+  procinfo::Info info;
+  if (!procinfo::Get(fd, procinfo::kArgv, &info) ||
+      info.argv.empty() || info.argv[0].empty()) {
     return NULL;
   }
-
-  free(path);
-
-  len = 0;
-  buf = NULL;
-  while ((ch = fgetc(f)) != EOF) {
-    if (ch == '\0') break;
-    buf = (char *)realloc(buf, len + 2);
-    if (buf == NULL) return NULL;
-    buf[len++] = ch;
-  }
-
-  if (buf != NULL) {
-    buf[len] = '\0';
-  }
-
-  fclose(f);
-  return buf;
+  return strdup(info.argv[0].c_str());
 }
 
 #elif defined(__APPLE__)
@@ -728,97 +1850,260 @@ pty_getproc(int fd, char *tty) {
 
 #endif
 
-#if defined(__APPLE__)
+#if defined(__APPLE__) || defined(__linux__)
 static std::string format_error(const char* func, int err_code) {
   char buf[256];
   snprintf(buf, sizeof(buf), "%s: %s", func, strerror(err_code));
   return buf;
 }
 
+/**
+ * pty_open_pair
+ * Allocates a pty pair with termp and winp applied. Both fds are opened
+ * close-on-exec, pairs are opened off the main thread while node may spawn
+ * other children, which must not inherit them.
+ */
+
 static void
-pty_posix_spawn(char** argv, char** env,
-                const struct termios *termp,
-                const struct winsize *winp,
-                int* master,
-                pid_t* pid,
-                std::string* err) {
-  int low_fds[3];
-  size_t count = 0;
+pty_open_pair(int* master,
+              int* slave,
+              std::string* pty_name,
+              const struct termios *termp,
+              const struct winsize *winp,
+              std::string* err) {
   int res = 0;
-  int slave = -1;
   char slave_pty_name[128];
-  int spawn_err;
-  sigset_t signal_set;
-
-  for (; count < 3; count++) {
-    low_fds[count] = posix_openpt(O_RDWR);
-    if (low_fds[count] >= STDERR_FILENO)
-      break;
-  }
-
-  int flags = POSIX_SPAWN_CLOEXEC_DEFAULT |
-              POSIX_SPAWN_SETSIGDEF |
-              POSIX_SPAWN_SETSIGMASK |
-              POSIX_SPAWN_SETSID;
-
-  posix_spawn_file_actions_t acts;
-  posix_spawn_file_actions_init(&acts);
 
-  posix_spawnattr_t attrs;
-  posix_spawnattr_init(&attrs);
+  *master = -1;
+  *slave = -1;
 
-  *master = posix_openpt(O_RDWR);
+  *master = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+#if defined(__APPLE__)
+  if (*master == -1 && errno == EINVAL) {
+    // Older macOS rejects any flag beyond O_RDWR and O_NOCTTY.
+    *master = posix_openpt(O_RDWR | O_NOCTTY);
+  }
+#endif
   if (*master == -1) {
     *err = format_error("posix_openpt failed", errno);
-    goto done;
+    return;
   }
 
   res = grantpt(*master);
   if (res == -1) {
     *err = format_error("grantpt failed", errno);
-    goto done;
+    goto fail;
   }
 
   res = unlockpt(*master);
   if (res == -1) {
     *err = format_error("unlockpt failed", errno);
-    goto done;
+    goto fail;
   }
 
+#if defined(__APPLE__)
   // Use TIOCPTYGNAME instead of ptsname() to avoid threading problems.
   res = ioctl(*master, TIOCPTYGNAME, slave_pty_name);
   if (res == -1) {
     *err = format_error("ioctl(TIOCPTYGNAME) failed", errno);
-    goto done;
+    goto fail;
+  }
+#else
+  // ptsname(3) uses a static buffer, spawns may run on several threads.
+  res = ptsname_r(*master, slave_pty_name, sizeof(slave_pty_name));
+  if (res != 0) {
+    *err = format_error("ptsname_r failed", res);
+    goto fail;
   }
+#endif
 
-  slave = open(slave_pty_name, O_RDWR | O_NOCTTY);
-  if (slave == -1) {
+  *slave = open(slave_pty_name, O_RDWR | O_NOCTTY | O_CLOEXEC);
+  if (*slave == -1) {
     *err = format_error("open slave pty failed", errno);
-    goto done;
+    goto fail;
+  }
+
+  // Only does anything where posix_openpt() ignored O_CLOEXEC.
+  if (SetCloseOnExec(*master) == -1) {
+    *err = format_error("fcntl(FD_CLOEXEC) failed", errno);
+    goto fail;
   }
 
   if (termp) {
-    res = tcsetattr(slave, TCSANOW, termp);
+    res = tcsetattr(*slave, TCSANOW, termp);
     if (res == -1) {
       *err = format_error("tcsetattr failed", errno);
-      goto done;
+      goto fail;
     };
   }
 
   if (winp) {
-    res = ioctl(slave, TIOCSWINSZ, winp);
+    res = ioctl(*slave, TIOCSWINSZ, winp);
     if (res == -1) {
       *err = format_error("ioctl(TIOCSWINSZ) failed", errno);
+      goto fail;
+    }
+  }
+
+  *pty_name = slave_pty_name;
+  return;
+
+fail:
+  close(*master);
+  *master = -1;
+  if (*slave != -1) {
+    close(*slave);
+    *slave = -1;
+  }
+}
+
+/**
+ * pty_pool_open
+ * Opens a pair for the warm pool with the termios and size PtyFork would use
+ * by default and makes the master nonblocking. Neither fd may be 0-2, where
+ * the dup2 file actions of pty_posix_spawn would clobber it. Spawns reserve
+ * the low fds while opening, pooled pairs are moved instead.
+ */
+
+static bool
+pty_pool_open(pty_pool::Pair* pair) {
+  struct termios term;
+  struct winsize winp;
+  pty_pool_defaults(&term, &winp);
+
+  std::string err;
+  pty_open_pair(&pair->master, &pair->slave, &pair->name, &term, &winp, &err);
+  if (!err.empty()) {
+    return false;
+  }
+  for (int* fd : {&pair->master, &pair->slave}) {
+    if (*fd <= STDERR_FILENO) {
+      int moved = fcntl(*fd, F_DUPFD_CLOEXEC, STDERR_FILENO + 1);
+      close(*fd);
+      *fd = moved;
+    }
+  }
+  if (pair->master == -1 || pair->slave == -1 ||
+      pty_nonblock(pair->master) == -1) {
+    if (pair->master != -1) close(pair->master);
+    if (pair->slave != -1) close(pair->slave);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * pty_posix_spawn
+ * Takes a pty pair from the pool, or opens one up front, and starts
+ * spawn-helper on the slave with posix_spawn(3). Unlike forkpty(3) this never
+ * copies the page tables of the parent: macOS spawns directly and glibc uses
+ * clone(CLONE_VM|CLONE_VFORK), so the cost of a spawn does not grow with the
+ * size of the node heap.
+ */
+
+static void
+pty_posix_spawn(char** argv, char** env,
+                const struct termios *termp,
+                const struct winsize *winp,
+                PtyForkResult* res,
+                std::string* err) {
+  int low_fds[3];
+  size_t count = 0;
+  int slave = -1;
+  int timing[2] = {-1, -1};
+  int spawn_err;
+  sigset_t signal_set;
+  pty_pool::Pair pair;
+  int* master = &res->master;
+  std::string* pty_name = &res->pty;
+
+  // Take the lowest fds if stdio is closed, so that neither the pty nor the
+  // timing pipe end up as fd 0-2 where dup2 in the child would clobber them.
+  while (count < 3) {
+    int fd = open("/dev/null", O_RDWR | O_CLOEXEC);
+    low_fds[count++] = fd;
+    if (fd == -1 || fd >= STDERR_FILENO)
+      break;
+  }
+
+  int flags = POSIX_SPAWN_SETSIGDEF |
+              POSIX_SPAWN_SETSIGMASK |
+              POSIX_SPAWN_SETSID;
+#if defined(__APPLE__)
+  flags |= POSIX_SPAWN_CLOEXEC_DEFAULT;
+#endif
+
+  posix_spawn_file_actions_t acts;
+  posix_spawn_file_actions_init(&acts);
+
+  posix_spawnattr_t attrs;
+  posix_spawnattr_init(&attrs);
+
+  if (pty_pool::Take(&pair)) {
+    *master = pair.master;
+    slave = pair.slave;
+    *pty_name = pair.name;
+
+    // Pooled pairs are opened with the defaults, only apply what differs.
+    struct termios default_term;
+    struct winsize default_winp;
+    pty_pool_defaults(&default_term, &default_winp);
+    if (termp && memcmp(termp, &default_term, sizeof(default_term)) != 0 &&
+        tcsetattr(slave, TCSANOW, termp) == -1) {
+      *err = format_error("tcsetattr failed", errno);
+      goto done;
+    }
+    if (winp && memcmp(winp, &default_winp, sizeof(default_winp)) != 0 &&
+        ioctl(slave, TIOCSWINSZ, winp) == -1) {
+      *err = format_error("ioctl(TIOCSWINSZ) failed", errno);
+      goto done;
+    }
+  } else {
+    pty_open_pair(master, &slave, pty_name, termp, winp, err);
+    if (!err->empty()) {
+      goto done;
+    }
+    // Before the spawn, so that no failure past it leaves a child behind.
+    // The child closes the master, the flag never reaches it.
+    if (pty_nonblock(*master) == -1) {
+      *err = "Could not set master fd to nonblocking.";
       goto done;
     }
   }
+  res->opened = uv_hrtime();
+
+  // spawn-helper reports the time of each of its phases on fd 3, see
+  // spawn-helper.cc. The write end is close-on-exec there, so the pipe hits
+  // EOF once the target has been exec'd or the helper has failed.
+#if defined(__linux__)
+  if (pipe2(timing, O_CLOEXEC) == -1) {
+#else
+  if (pipe(timing) == -1 ||
+      SetCloseOnExec(timing[0]) == -1 ||
+      SetCloseOnExec(timing[1]) == -1) {
+#endif
+    *err = format_error("pipe failed", errno);
+    goto done;
+  }
+  if (timing[1] == 3) {
+    // dup2 onto itself would keep the close-on-exec flag.
+    int moved = fcntl(timing[1], F_DUPFD_CLOEXEC, 4);
+    close(timing[1]);
+    timing[1] = moved;
+  }
+  if (timing[1] == -1 || pty_nonblock(timing[0]) == -1) {
+    *err = format_error("fcntl failed", errno);
+    goto done;
+  }
 
   posix_spawn_file_actions_adddup2(&acts, slave, STDIN_FILENO);
   posix_spawn_file_actions_adddup2(&acts, slave, STDOUT_FILENO);
   posix_spawn_file_actions_adddup2(&acts, slave, STDERR_FILENO);
   posix_spawn_file_actions_addclose(&acts, slave);
   posix_spawn_file_actions_addclose(&acts, *master);
+  // After the closes, either of which may have been fd 3.
+  posix_spawn_file_actions_adddup2(&acts, timing[1], 3);
+  posix_spawn_file_actions_addclose(&acts, timing[1]);
 
   spawn_err = posix_spawnattr_setflags(&attrs, flags);
   if (spawn_err != 0) {
@@ -843,8 +2128,9 @@ pty_posix_spawn(char** argv, char** env,
   }
 
   do
-    spawn_err = posix_spawn(pid, argv[0], &acts, &attrs, argv, env);
+    spawn_err = posix_spawn(&res->pid, argv[0], &acts, &attrs, argv, env);
   while (spawn_err == EINTR);
+  res->spawned = uv_hrtime();
   if (spawn_err != 0) {
     *err = format_error("posix_spawn failed", spawn_err);
   }
@@ -854,9 +2140,18 @@ done:
   if (slave != -1) {
     close(slave);
   }
+  if (timing[1] != -1) {
+    close(timing[1]);
+  }
+  if (err->empty()) {
+    res->timing_fd = timing[0];
+  } else if (timing[0] != -1) {
+    close(timing[0]);
+  }
 
-  for (size_t i = 0; i <= count; i++) {
-    close(low_fds[i]);
+  for (size_t i = 0; i < count; i++) {
+    if (low_fds[i] != -1)
+      close(low_fds[i]);
   }
 }
 #endif
@@ -867,9 +2162,29 @@ done:
 
 Napi::Object init(Napi::Env env, Napi::Object exports) {
   exports.Set("fork",    Napi::Function::New(env, PtyFork));
+  exports.Set("forkAsync", Napi::Function::New(env, PtyForkAsync));
+  exports.Set("forkMany", Napi::Function::New(env, PtyForkMany));
+  exports.Set("SpawnTemplate", PtySpawnTemplate::Init(env));
+  exports.Set("configurePool", Napi::Function::New(env, PtyConfigurePool));
+  exports.Set("getPoolStats", Napi::Function::New(env, PtyGetPoolStats));
+  exports.Set("readSpawnTimings", Napi::Function::New(env, PtyReadSpawnTimings));
+  exports.Set("startReading", Napi::Function::New(env, PtyStartReading));
+  exports.Set("pauseReading", Napi::Function::New(env, PtyPauseReading));
+  exports.Set("resumeReading", Napi::Function::New(env, PtyResumeReading));
+  exports.Set("ringConsumed", Napi::Function::New(env, PtyRingConsumed));
+  exports.Set("Scrollback", PtyScrollback::Init(env));
+  exports.Set("ShellTracker", PtyShellTracker::Init(env));
+  exports.Set("Recording", PtyRecording::Init(env));
+  exports.Set("recordOutput", Napi::Function::New(env, PtyRecordOutput));
+  exports.Set("waitFor", Napi::Function::New(env, PtyWaitFor));
+  exports.Set("cancelWait", Napi::Function::New(env, PtyCancelWait));
+  exports.Set("readStats", Napi::Function::New(env, PtyReadStats));
+  exports.Set("stopReading", Napi::Function::New(env, PtyStopReading));
+  exports.Set("Writer", PtyWriter::Init(env));
   exports.Set("open",    Napi::Function::New(env, PtyOpen));
   exports.Set("resize",  Napi::Function::New(env, PtyResize));
   exports.Set("process", Napi::Function::New(env, PtyGetProc));
+  exports.Set("getProcessInfo", Napi::Function::New(env, PtyGetProcessInfo));
   return exports;
 }
 
@@ -0,0 +1,1008 @@
+/**
+ * Copyright (c) 2026, Microsoft Corporation (MIT License).
+ *
+ * reader.cc:
+ *   One thread per environment reads every pty master that opted in, instead
+ *   of a tty.ReadStream with its own libuv handle per terminal. Masters are
+ *   watched with epoll on Linux, kqueue on macOS and the BSDs and poll(2)
+ *   elsewhere. Output is read into native buffers, or straight into a ring in
+ *   shared memory, coalesced per terminal and handed to JS in batches through
+ *   a single ThreadSafeFunction.
+ */
+
+#include "reader.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <uv.h>
+
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "boundary.h"
+#include "matcher.h"
+#include "stripper.h"
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#define READER_USE_EPOLL
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || \
+      defined(__NetBSD__)
+#include <sys/event.h>
+#define READER_USE_KQUEUE
+#else
+#include <poll.h>
+#endif
+
+namespace reader {
+
+namespace {
+
+// Event payload of the wake pipe. Sources are keyed by id, which is never 0.
+const uint64_t kWakeToken = 0;
+
+// A source is no longer polled while this much of its output waits for JS,
+// leaving the rest in the kernel buffer so the child blocks on write.
+const size_t kMaxPending = 1024 * 1024;
+
+// Reads per ready source and wakeup, so a busy terminal cannot starve the
+// others.
+const int kMaxReads = 4;
+
+const size_t kReadSize = 64 * 1024;
+
+// See kSizeBuckets.
+size_t SizeBucket(size_t size) {
+  size_t bucket = 0;
+  size_t bound = 16;
+  while (size > bound && bucket + 1 < kSizeBuckets) {
+    bound <<= 2;
+    bucket++;
+  }
+  return bucket;
+}
+
+// Counts a read that returned size bytes.
+void Count(Stats* stats, size_t size) {
+  stats->reads.fetch_add(1, std::memory_order_relaxed);
+  stats->bytes.fetch_add(size, std::memory_order_relaxed);
+  stats->sizes[SizeBucket(size)].fetch_add(1, std::memory_order_relaxed);
+}
+
+// See Options::hold_partial.
+const size_t kMaxCarry = 64 * 1024;
+const int kHoldTimeoutMs = 50;
+
+struct Source {
+  int fd;
+  // Paused by JS.
+  bool paused = false;
+  // Too much output waiting for JS, see kMaxPending.
+  bool throttled = false;
+  // Hit EOF or an error.
+  bool done = false;
+  // Currently in the poll set.
+  bool polled = false;
+  // Bytes read but not yet handed to JS.
+  size_t pending = 0;
+  // The data and counters of the ring of a StartRing() source, kept alive by
+  // Reader::rings_.
+  uint8_t* ring = nullptr;
+  uint32_t ring_size = 0;
+  uint32_t* head = nullptr;
+  uint32_t* tail = nullptr;
+  // Bytes read so far.
+  uint64_t read = 0;
+  // Also get everything read, may be null.
+  std::shared_ptr<scrollback::Log> log;
+  std::shared_ptr<recorder::Recording> recording;
+  std::shared_ptr<tracker::Tracker> tracker;
+  // Set when there is an Options::plain callback.
+  std::unique_ptr<stripper::Stripper> stripper;
+  // See Options::hold_partial, carry is the incomplete sequence held back
+  // since held_since.
+  bool hold_partial = false;
+  std::string carry;
+  uint64_t held_since = 0;
+  // Shared with Reader::stats_.
+  std::shared_ptr<Stats> stats;
+};
+
+struct Chunk {
+  uint64_t id;
+  std::string data;
+  // The source is done, error is the errno or 0 on EOF.
+  bool end = false;
+  int error = 0;
+  // Output was written to the ring of the source, head is read on delivery.
+  bool written = false;
+  uint32_t head = 0;
+  // Found by the tracker of the source in data.
+  std::vector<tracker::Event> events;
+  // What the stripper of the source made of data.
+  std::string plain;
+};
+
+struct Wait {
+  uint32_t id;
+  std::unique_ptr<matcher::Matcher> matcher;
+  Napi::FunctionReference cb;
+};
+
+// The output delivered to JS so far of a Start() source and the waits on it.
+struct Watch {
+  uint64_t delivered = 0;
+  uint32_t next_wait = 1;
+  std::vector<Wait> waits;
+};
+
+// A wait that matched, called once the chunk was delivered.
+struct Match {
+  Napi::FunctionReference cb;
+  size_t index;
+  uint64_t offset;
+};
+
+class Reader;
+void CallJs(Napi::Env env, Napi::Function, Reader* reader, void*);
+using ReaderTsfn = Napi::TypedThreadSafeFunction<Reader, void, CallJs>;
+
+class Reader {
+ public:
+  explicit Reader(Napi::Env env);
+  ~Reader();
+
+  uint64_t Start(Napi::Env env, Napi::Function cb, int fd, Options options);
+  uint64_t StartRing(Napi::Env env, Napi::Function cb, int fd,
+                     Napi::Uint8Array ring, Options options);
+  void Consumed(uint64_t id);
+  void Record(uint64_t id, std::shared_ptr<recorder::Recording> recording);
+  uint32_t WaitFor(Napi::Env env, uint64_t id,
+                   const std::vector<std::string>& patterns, Napi::Function cb);
+  void CancelWait(uint64_t id, uint32_t wait);
+  void Pause(uint64_t id);
+  void Resume(uint64_t id);
+  void Stop(Napi::Env env, uint64_t id);
+  std::shared_ptr<const Stats> GetStats(uint64_t id);
+  void Deliver(Napi::Env env);
+
+ private:
+  void Run();
+  void Wake();
+  void Update(uint64_t id, Source* source);
+  void Started(uint64_t id, Source* source, Options* options);
+  void ReadReady(uint64_t id, std::vector<Chunk>* batch);
+  std::shared_ptr<scrollback::Log> ReadLocked(uint64_t id,
+                                              std::vector<Chunk>* batch);
+  void Tap(Source* source, const char* data, size_t length, uint64_t time,
+           Chunk* chunk);
+  void Hold(uint64_t id, Source* source, Chunk* chunk);
+  void FlushHeld(std::vector<Chunk>* batch);
+  void Post(std::vector<Chunk>* batch);
+  std::vector<Match> Scan(uint64_t id, const std::string& data);
+
+  ReaderTsfn tsfn_;
+  std::thread thread_;
+  std::atomic<bool> stopping_{false};
+  int poll_fd_ = -1;
+  int wake_fds_[2] = {-1, -1};
+
+  // Guards sources_, ready_ and ready_index_, shared with the reader thread.
+  // It is also held while reading so Stop() never closes an fd mid-read.
+  std::mutex mutex_;
+  uint64_t next_id_ = 1;
+  std::unordered_map<uint64_t, Source> sources_;
+  std::vector<Chunk> ready_;
+  // id -> the data chunk of ready_ further output is appended to.
+  std::unordered_map<uint64_t, size_t> ready_index_;
+
+  // Reader thread only.
+  char buf_[kReadSize];
+  // What ReadReady() read for the log of the source, appended once mutex_ is
+  // released.
+  std::string logged_;
+  // Sources with a carry.
+  std::unordered_set<uint64_t> held_;
+
+  // JS thread only.
+  std::unordered_map<uint64_t, Napi::FunctionReference> callbacks_;
+  std::unordered_map<uint64_t, Napi::ObjectReference> rings_;
+  std::unordered_map<uint64_t, Watch> watches_;
+  std::unordered_map<uint64_t, Napi::FunctionReference> plain_callbacks_;
+  std::unordered_map<uint64_t, std::shared_ptr<Stats>> stats_;
+};
+
+std::mutex g_readers_mutex;
+std::unordered_map<napi_env, Reader*> g_readers;
+
+void CallJs(Napi::Env env, Napi::Function, Reader* reader, void*) {
+  if (env != nullptr && reader != nullptr) {
+    reader->Deliver(env);
+  }
+}
+
+Reader::Reader(Napi::Env env) {
+  tsfn_ = ReaderTsfn::New(env,
+                          "node-pty.reader", // Name
+                          0,                 // Unlimited queue
+                          1,                 // Only the reader thread
+                          this);
+  // Only keep the event loop alive while there are terminals to read.
+  tsfn_.Unref(env);
+
+  if (pipe(wake_fds_) == -1) {
+    throw Napi::Error::New(env, "pipe(2) failed.");
+  }
+  for (int fd : wake_fds_) {
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  }
+
+#if defined(READER_USE_EPOLL)
+  poll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  if (poll_fd_ == -1) {
+    throw Napi::Error::New(env, "epoll_create1(2) failed.");
+  }
+  struct epoll_event ev = {};
+  ev.events = EPOLLIN;
+  ev.data.u64 = kWakeToken;
+  epoll_ctl(poll_fd_, EPOLL_CTL_ADD, wake_fds_[0], &ev);
+#elif defined(READER_USE_KQUEUE)
+  poll_fd_ = kqueue();
+  if (poll_fd_ == -1) {
+    throw Napi::Error::New(env, "kqueue(2) failed.");
+  }
+  fcntl(poll_fd_, F_SETFD, FD_CLOEXEC);
+  struct kevent change;
+  EV_SET(&change, wake_fds_[0], EVFILT_READ, EV_ADD, 0, 0,
+         reinterpret_cast<void*>(static_cast<uintptr_t>(kWakeToken)));
+  kevent(poll_fd_, &change, 1, NULL, 0, NULL);
+#endif
+
+  thread_ = std::thread([this] { Run(); });
+}
+
+Reader::~Reader() {
+  stopping_ = true;
+  Wake();
+  thread_.join();
+
+  for (auto& source : sources_) {
+    close(source.second.fd);
+  }
+  if (poll_fd_ != -1) {
+    close(poll_fd_);
+  }
+  close(wake_fds_[0]);
+  close(wake_fds_[1]);
+  tsfn_.Release();
+}
+
+uint64_t Reader::Start(Napi::Env env, Napi::Function cb, int fd,
+                       Options options) {
+  uint64_t id;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    id = next_id_++;
+    Source& source = sources_[id];
+    source.fd = fd;
+    source.log = std::move(options.log);
+    source.tracker = std::move(options.tracker);
+    source.hold_partial = options.hold_partial;
+    Started(id, &source, &options);
+  }
+  if (!options.plain.IsEmpty()) {
+    plain_callbacks_[id] = Napi::Persistent(options.plain);
+  }
+  watches_[id];
+  callbacks_[id] = Napi::Persistent(cb);
+  if (callbacks_.size() == 1) {
+    tsfn_.Ref(env);
+  }
+  return id;
+}
+
+uint64_t Reader::StartRing(Napi::Env env, Napi::Function cb, int fd,
+                           Napi::Uint8Array ring, Options options) {
+  size_t length = ring.ByteLength();
+  size_t size = length > kRingHeaderSize ? length - kRingHeaderSize : 0;
+  if (size == 0 || (size & (size - 1)) != 0 || size > (1u << 31)) {
+    throw Napi::Error::New(env, "The ring must be a header followed by a power of two bytes of data.");
+  }
+  uint8_t* data = ring.Data();
+
+  uint64_t id;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    id = next_id_++;
+    Source& source = sources_[id];
+    source.fd = fd;
+    source.ring = data + kRingHeaderSize;
+    source.ring_size = static_cast<uint32_t>(size);
+    source.head = reinterpret_cast<uint32_t*>(data);
+    source.tail = reinterpret_cast<uint32_t*>(data + 4);
+    source.log = std::move(options.log);
+    source.tracker = std::move(options.tracker);
+    Started(id, &source, &options);
+  }
+  if (!options.plain.IsEmpty()) {
+    plain_callbacks_[id] = Napi::Persistent(options.plain);
+  }
+  rings_[id] = Napi::Persistent(ring);
+  callbacks_[id] = Napi::Persistent(cb);
+  if (callbacks_.size() == 1) {
+    tsfn_.Ref(env);
+  }
+  return id;
+}
+
+// Sets up what Start() and StartRing() share and starts polling. Called with
+// mutex_ held.
+void Reader::Started(uint64_t id, Source* source, Options* options) {
+  if (!options->plain.IsEmpty()) {
+    source->stripper.reset(new stripper::Stripper());
+  }
+  source->stats = std::make_shared<Stats>();
+  stats_[id] = source->stats;
+  Update(id, source);
+}
+
+void Reader::Consumed(uint64_t id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = sources_.find(id);
+  if (it == sources_.end() || it->second.ring == nullptr) {
+    return;
+  }
+  Source& source = it->second;
+  uint32_t head = __atomic_load_n(source.head, __ATOMIC_RELAXED);
+  uint32_t tail = __atomic_load_n(source.tail, __ATOMIC_ACQUIRE);
+  if (source.throttled && head - tail < source.ring_size) {
+    source.throttled = false;
+    Update(id, &source);
+  }
+}
+
+void Reader::Record(uint64_t id,
+                    std::shared_ptr<recorder::Recording> recording) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = sources_.find(id);
+  if (it != sources_.end()) {
+    it->second.recording = std::move(recording);
+  }
+}
+
+uint32_t Reader::WaitFor(Napi::Env env, uint64_t id,
+                         const std::vector<std::string>& patterns,
+                         Napi::Function cb) {
+  auto it = watches_.find(id);
+  if (it == watches_.end()) {
+    throw Napi::Error::New(env, "Not reading, or reading into a ring.");
+  }
+  Watch& watch = it->second;
+  uint32_t wait = watch.next_wait++;
+  watch.waits.push_back({wait, std::unique_ptr<matcher::Matcher>(
+                                   new matcher::Matcher(patterns)),
+                         Napi::Persistent(cb)});
+  return wait;
+}
+
+void Reader::CancelWait(uint64_t id, uint32_t wait) {
+  auto it = watches_.find(id);
+  if (it == watches_.end()) {
+    return;
+  }
+  auto& waits = it->second.waits;
+  waits.erase(std::remove_if(waits.begin(), waits.end(),
+                             [wait](const Wait& w) { return w.id == wait; }),
+              waits.end());
+}
+
+void Reader::Pause(uint64_t id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = sources_.find(id);
+  if (it != sources_.end()) {
+    it->second.paused = true;
+    Update(id, &it->second);
+  }
+}
+
+void Reader::Resume(uint64_t id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = sources_.find(id);
+  if (it != sources_.end()) {
+    it->second.paused = false;
+    Update(id, &it->second);
+  }
+}
+
+void Reader::Stop(Napi::Env env, uint64_t id) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = sources_.find(id);
+    if (it != sources_.end()) {
+      it->second.done = true;
+      Update(id, &it->second);
+      close(it->second.fd);
+      sources_.erase(it);
+    }
+  }
+  rings_.erase(id);
+  watches_.erase(id);
+  plain_callbacks_.erase(id);
+  stats_.erase(id);
+  if (callbacks_.erase(id) != 0 && callbacks_.empty()) {
+    tsfn_.Unref(env);
+  }
+}
+
+std::shared_ptr<const Stats> Reader::GetStats(uint64_t id) {
+  auto it = stats_.find(id);
+  return it != stats_.end() ? it->second : nullptr;
+}
+
+// Adds the source to or removes it from the poll set as its state requires.
+// Called with mutex_ held.
+void Reader::Update(uint64_t id, Source* source) {
+  bool poll = !source->paused && !source->throttled && !source->done;
+  if (poll == source->polled) {
+    return;
+  }
+  source->polled = poll;
+  if (!source->done) {
+    Stats& stats = *source->stats;
+    uint64_t now = uv_hrtime();
+    if (poll) {
+      uint64_t since = stats.stalled_since.exchange(0, std::memory_order_relaxed);
+      if (since != 0) {
+        stats.stalled.fetch_add(now - since, std::memory_order_relaxed);
+      }
+    } else if (source->paused || source->throttled) {
+      stats.stalled_since.store(now, std::memory_order_relaxed);
+    }
+  }
+#if defined(READER_USE_EPOLL)
+  // Removed rather than masked, EPOLLHUP is reported regardless of the mask.
+  struct epoll_event ev = {};
+  ev.events = EPOLLIN;
+  ev.data.u64 = id;
+  epoll_ctl(poll_fd_, poll ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, source->fd, &ev);
+#elif defined(READER_USE_KQUEUE)
+  struct kevent change;
+  EV_SET(&change, source->fd, EVFILT_READ, poll ? EV_ADD : EV_DELETE, 0, 0,
+         reinterpret_cast<void*>(static_cast<uintptr_t>(id)));
+  kevent(poll_fd_, &change, 1, NULL, 0, NULL);
+#else
+  // The reader thread rebuilds its pollfds when woken.
+  Wake();
+#endif
+}
+
+void Reader::Wake() {
+  char c = 0;
+  ssize_t r;
+  do
+    r = write(wake_fds_[1], &c, 1);
+  while (r == -1 && errno == EINTR);
+}
+
+void Reader::Run() {
+  std::vector<uint64_t> ready;
+  std::vector<Chunk> batch;
+  while (!stopping_) {
+    bool wake = false;
+    ready.clear();
+    // Wake up to flush carries whose rest did not arrive in time.
+    int timeout = held_.empty() ? -1 : kHoldTimeoutMs;
+#if defined(READER_USE_EPOLL)
+    struct epoll_event events[256];
+    int n = epoll_wait(poll_fd_, events, 256, timeout);
+    for (int i = 0; i < n; i++) {
+      if (events[i].data.u64 == kWakeToken) {
+        wake = true;
+      } else {
+        ready.push_back(events[i].data.u64);
+      }
+    }
+#elif defined(READER_USE_KQUEUE)
+    struct kevent events[256];
+    struct timespec ts = { 0, kHoldTimeoutMs * 1000000L };
+    int n = kevent(poll_fd_, NULL, 0, events, 256, timeout == -1 ? NULL : &ts);
+    for (int i = 0; i < n; i++) {
+      uint64_t id = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(events[i].udata));
+      if (id == kWakeToken) {
+        wake = true;
+      } else {
+        ready.push_back(id);
+      }
+    }
+#else
+    std::vector<struct pollfd> fds;
+    std::vector<uint64_t> ids;
+    fds.push_back({ wake_fds_[0], POLLIN, 0 });
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (const auto& source : sources_) {
+        if (source.second.polled) {
+          fds.push_back({ source.second.fd, POLLIN, 0 });
+          ids.push_back(source.first);
+        }
+      }
+    }
+    if (poll(fds.data(), fds.size(), timeout) > 0) {
+      wake = fds[0].revents != 0;
+      for (size_t i = 1; i < fds.size(); i++) {
+        if (fds[i].revents != 0) {
+          ready.push_back(ids[i - 1]);
+        }
+      }
+    }
+#endif
+    if (wake) {
+      char buf[64];
+      while (read(wake_fds_[0], buf, sizeof(buf)) > 0) {}
+      if (stopping_) {
+        break;
+      }
+    }
+    for (uint64_t id : ready) {
+      ReadReady(id, &batch);
+    }
+    if (!held_.empty()) {
+      FlushHeld(&batch);
+    }
+    if (!batch.empty()) {
+      Post(&batch);
+    }
+  }
+}
+
+void Reader::ReadReady(uint64_t id, std::vector<Chunk>* batch) {
+  std::shared_ptr<scrollback::Log> log = ReadLocked(id, batch);
+  // Appending may create a segment file and fault its pages in, which must
+  // not keep the JS thread waiting for mutex_.
+  if (log && !logged_.empty()) {
+    log->Append(logged_.data(), logged_.size());
+  }
+  logged_.clear();
+}
+
+// Reads what is ready and returns the log of the source, if it has one.
+std::shared_ptr<scrollback::Log> Reader::ReadLocked(
+    uint64_t id, std::vector<Chunk>* batch) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = sources_.find(id);
+  // Paused, throttled or stopped since it was polled.
+  if (it == sources_.end() || !it->second.polled) {
+    return nullptr;
+  }
+  Source& source = it->second;
+  Stats& stats = *source.stats;
+
+  Chunk chunk;
+  chunk.id = id;
+  for (int i = 0; i < kMaxReads && !source.throttled; i++) {
+    ssize_t n;
+    if (source.ring != nullptr) {
+      // Only this thread writes head, the consumer writes tail.
+      uint32_t head = __atomic_load_n(source.head, __ATOMIC_RELAXED);
+      uint32_t tail = __atomic_load_n(source.tail, __ATOMIC_ACQUIRE);
+      uint32_t space = source.ring_size - (head - tail);
+      if (space == 0) {
+        // Resumed by Consumed() once the consumer caught up.
+        source.throttled = true;
+        Update(id, &source);
+        break;
+      }
+      uint32_t offset = head & (source.ring_size - 1);
+      struct iovec iov[2];
+      iov[0].iov_base = source.ring + offset;
+      iov[0].iov_len = std::min(space, source.ring_size - offset);
+      iov[1].iov_base = source.ring;
+      iov[1].iov_len = space - iov[0].iov_len;
+      n = readv(source.fd, iov, iov[1].iov_len != 0 ? 2 : 1);
+      if (n > 0) {
+        Count(&stats, n);
+        size_t first = std::min(static_cast<size_t>(n), iov[0].iov_len);
+        // Both parts share the timestamp, so they are recorded as one event.
+        uint64_t now = source.recording || source.tracker ? uv_hrtime() : 0;
+        Tap(&source, reinterpret_cast<char*>(source.ring + offset), first, now, &chunk);
+        Tap(&source, reinterpret_cast<char*>(source.ring), n - first, now, &chunk);
+        __atomic_store_n(source.head, head + static_cast<uint32_t>(n),
+                         __ATOMIC_RELEASE);
+        chunk.written = true;
+        if (static_cast<uint32_t>(n) < space) {
+          break;
+        }
+        continue;
+      }
+    } else {
+      n = read(source.fd, buf_, kReadSize);
+      if (n > 0) {
+        Count(&stats, n);
+        uint64_t now = source.recording || source.tracker ? uv_hrtime() : 0;
+        Tap(&source, buf_, n, now, &chunk);
+        chunk.data.append(buf_, n);
+        source.pending += n;
+        stats.pending.store(source.pending, std::memory_order_relaxed);
+        if (source.pending >= kMaxPending) {
+          source.throttled = true;
+          Update(id, &source);
+        }
+        if (static_cast<size_t>(n) < kReadSize) {
+          break;
+        }
+        continue;
+      }
+    }
+    if (n == -1 && errno == EINTR) {
+      continue;
+    }
+    if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      stats.would_block.fetch_add(1, std::memory_order_relaxed);
+      break;
+    }
+    // EOF, or EIO once every slave fd has been closed.
+    chunk.end = true;
+    chunk.error = n == 0 ? 0 : errno;
+    source.done = true;
+    Update(id, &source);
+    break;
+  }
+  if (source.hold_partial && (!chunk.data.empty() || chunk.end)) {
+    Hold(id, &source, &chunk);
+  }
+  if (!chunk.data.empty() || chunk.written || chunk.end) {
+    batch->push_back(std::move(chunk));
+  }
+  return source.log;
+}
+
+// Puts the carry of the source back in front of the chunk and holds back a
+// new one from its end. Called with mutex_ held.
+void Reader::Hold(uint64_t id, Source* source, Chunk* chunk) {
+  if (!source->carry.empty()) {
+    chunk->data.insert(0, source->carry);
+    source->carry.clear();
+  }
+  size_t length = chunk->data.size();
+  size_t keep = chunk->end
+    ? length
+    : boundary::CompleteLength(chunk->data.data(), length);
+  if (length - keep > kMaxCarry) {
+    keep = length;
+  }
+  if (keep == length) {
+    held_.erase(id);
+    return;
+  }
+  source->carry.assign(chunk->data, keep, std::string::npos);
+  source->held_since = uv_hrtime();
+  chunk->data.resize(keep);
+  held_.insert(id);
+}
+
+// Hands over the carries held for longer than kHoldTimeoutMs.
+void Reader::FlushHeld(std::vector<Chunk>* batch) {
+  uint64_t now = uv_hrtime();
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto it = held_.begin(); it != held_.end();) {
+    auto source = sources_.find(*it);
+    if (source == sources_.end()) {
+      it = held_.erase(it);
+      continue;
+    }
+    if (now - source->second.held_since < kHoldTimeoutMs * 1000000ULL) {
+      ++it;
+      continue;
+    }
+    Chunk chunk;
+    chunk.id = *it;
+    chunk.data.swap(source->second.carry);
+    batch->push_back(std::move(chunk));
+    it = held_.erase(it);
+  }
+}
+
+// Hands what was just read to everything else that gets the output of the
+// source, the log once mutex_ is released. Called with mutex_ held.
+void Reader::Tap(Source* source, const char* data, size_t length,
+                 uint64_t time, Chunk* chunk) {
+  if (length == 0) {
+    return;
+  }
+  if (source->log) {
+    logged_.append(data, length);
+  }
+  if (source->recording) {
+    source->recording->Output(data, length, time);
+  }
+  if (source->tracker) {
+    source->tracker->Feed(data, length, source->read, time, &chunk->events);
+  }
+  if (source->stripper) {
+    source->stripper->Feed(data, length, &chunk->plain);
+  }
+  source->read += length;
+}
+
+void Reader::Post(std::vector<Chunk>* batch) {
+  bool schedule;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    schedule = ready_.empty();
+    for (Chunk& chunk : *batch) {
+      auto it = ready_index_.find(chunk.id);
+      if (it != ready_index_.end()) {
+        ready_[it->second].data.append(chunk.data);
+        ready_[it->second].written |= chunk.written;
+        std::move(chunk.events.begin(), chunk.events.end(),
+                  std::back_inserter(ready_[it->second].events));
+        ready_[it->second].plain.append(chunk.plain);
+        if (chunk.end) {
+          ready_[it->second].end = true;
+          ready_[it->second].error = chunk.error;
+          ready_index_.erase(it);
+        }
+        continue;
+      }
+      if (!chunk.end) {
+        ready_index_[chunk.id] = ready_.size();
+      }
+      ready_.push_back(std::move(chunk));
+    }
+  }
+  batch->clear();
+  // A single pending call drains everything queued until it runs.
+  if (schedule) {
+    auto status = tsfn_.NonBlockingCall();
+    switch (status) {
+      case napi_ok:
+      case napi_closing:
+        break;
+
+      case napi_queue_full:
+        Napi::Error::Fatal("Reader", "Queue was full");
+
+      default:
+        Napi::Error::Fatal("Reader", "ThreadSafeFunction.NonBlockingCall() failed");
+    }
+  }
+}
+
+// Feeds data to the waits of the source, removing those that matched.
+std::vector<Match> Reader::Scan(uint64_t id, const std::string& data) {
+  std::vector<Match> matches;
+  auto it = watches_.find(id);
+  if (it == watches_.end()) {
+    return matches;
+  }
+  Watch& watch = it->second;
+  uint64_t base = watch.delivered;
+  watch.delivered += data.size();
+  auto& waits = watch.waits;
+  for (auto w = waits.begin(); w != waits.end();) {
+    size_t index;
+    size_t end;
+    if (w->matcher->Feed(data.data(), data.size(), &index, &end)) {
+      uint64_t offset = base + end - w->matcher->PatternLength(index);
+      matches.push_back({std::move(w->cb), index, offset});
+      w = waits.erase(w);
+    } else {
+      ++w;
+    }
+  }
+  return matches;
+}
+
+Napi::Object EventToObject(Napi::Env env, const tracker::Event& event) {
+  static const char* const kTypes[] = {
+    "prompt", "commandStart", "commandFinish", "cwd"
+  };
+  Napi::Object obj = Napi::Object::New(env);
+  obj.Set("type", kTypes[event.type]);
+  obj.Set("offset", static_cast<double>(event.offset));
+  if (event.type == tracker::Event::kCwd) {
+    obj.Set("cwd", event.cwd);
+  } else {
+    obj.Set("command", CommandToObject(env, event.command));
+  }
+  return obj;
+}
+
+void Reader::Deliver(Napi::Env env) {
+  std::vector<Chunk> batch;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    batch.swap(ready_);
+    ready_index_.clear();
+    // Handed to JS now, let throttled sources read again.
+    for (Chunk& chunk : batch) {
+      auto it = sources_.find(chunk.id);
+      if (it == sources_.end()) {
+        continue;
+      }
+      if (chunk.written) {
+        chunk.head = __atomic_load_n(it->second.head, __ATOMIC_ACQUIRE);
+        continue;
+      }
+      it->second.pending -= chunk.data.size();
+      it->second.stats->pending.store(it->second.pending,
+                                      std::memory_order_relaxed);
+      if (it->second.throttled && it->second.pending < kMaxPending) {
+        it->second.throttled = false;
+        Update(chunk.id, &it->second);
+      }
+    }
+  }
+
+  Napi::HandleScope scope(env);
+  Napi::Error error;
+  for (const Chunk& chunk : batch) {
+    auto it = callbacks_.find(chunk.id);
+    if (it == callbacks_.end()) {
+      // Stopped while the chunk was queued.
+      continue;
+    }
+    // Keep delivering the rest of the batch if a listener throws, the first
+    // exception is rethrown afterwards.
+    // The callback may start or stop sources, don't hold on to the iterator.
+    Napi::Function cb = it->second.Value();
+    std::vector<Match> matches = Scan(chunk.id, chunk.data);
+    Napi::Function plain;
+    auto plain_it = plain_callbacks_.find(chunk.id);
+    if (plain_it != plain_callbacks_.end()) {
+      plain = plain_it->second.Value();
+    }
+    try {
+      if (chunk.end) {
+        callbacks_.erase(it);
+        watches_.erase(chunk.id);
+        plain_callbacks_.erase(chunk.id);
+        if (callbacks_.empty()) {
+          tsfn_.Unref(env);
+        }
+      }
+      if (!chunk.data.empty()) {
+        cb.Call({Napi::Buffer<char>::Copy(env, chunk.data.data(),
+                                          chunk.data.size())});
+      }
+      if (chunk.written) {
+        cb.Call({Napi::Number::New(env, chunk.head)});
+      }
+      if (!chunk.events.empty()) {
+        Napi::Array events = Napi::Array::New(env, chunk.events.size());
+        for (size_t i = 0; i < chunk.events.size(); i++) {
+          events.Set(static_cast<uint32_t>(i), EventToObject(env, chunk.events[i]));
+        }
+        cb.Call({events});
+      }
+      if (!chunk.plain.empty() && !plain.IsEmpty()) {
+        plain.Call({Napi::Buffer<char>::Copy(env, chunk.plain.data(),
+                                             chunk.plain.size())});
+      }
+      if (chunk.end) {
+        cb.Call({env.Null(), Napi::Number::New(env, chunk.error)});
+      }
+    } catch (const Napi::Error& e) {
+      if (error.IsEmpty()) {
+        error = e;
+      }
+    }
+    // Called even if the data listener threw, nothing else would settle them.
+    for (Match& match : matches) {
+      try {
+        match.cb.Call({Napi::Number::New(env, static_cast<double>(match.index)),
+                       Napi::Number::New(env, static_cast<double>(match.offset))});
+      } catch (const Napi::Error& e) {
+        if (error.IsEmpty()) {
+          error = e;
+        }
+      }
+    }
+  }
+  if (!error.IsEmpty()) {
+    throw error;
+  }
+}
+
+Reader* GetReader(Napi::Env env) {
+  std::lock_guard<std::mutex> lock(g_readers_mutex);
+  auto it = g_readers.find(env);
+  if (it != g_readers.end()) {
+    return it->second;
+  }
+  Reader* reader = new Reader(env);
+  g_readers[env] = reader;
+  napi_env raw_env = env;
+  env.AddCleanupHook([raw_env, reader]() {
+    {
+      std::lock_guard<std::mutex> lock(g_readers_mutex);
+      g_readers.erase(raw_env);
+    }
+    delete reader;
+  });
+  return reader;
+}
+
+}  // namespace
+
+Napi::Object CommandToObject(Napi::Env env, const tracker::Command& command) {
+  Napi::Object obj = Napi::Object::New(env);
+  // Markers that were not seen are left out.
+  const std::pair<const char*, uint64_t> offsets[] = {
+    {"promptOffset", command.prompt},
+    {"inputOffset", command.input},
+    {"outputOffset", command.output},
+    {"endOffset", command.end},
+  };
+  for (const auto& offset : offsets) {
+    if (offset.second != tracker::kUnknown) {
+      obj.Set(offset.first, static_cast<double>(offset.second));
+    }
+  }
+  if (command.start_time != tracker::kUnknown &&
+      command.end_time != tracker::kUnknown) {
+    obj.Set("duration", (command.end_time - command.start_time) / 1e6);
+  }
+  if (command.has_exit_code) {
+    obj.Set("exitCode", command.exit_code);
+  }
+  obj.Set("cwd", command.cwd);
+  return obj;
+}
+
+uint64_t Start(Napi::Env env, Napi::Function cb, int fd, Options options) {
+  return GetReader(env)->Start(env, cb, fd, std::move(options));
+}
+
+uint64_t StartRing(Napi::Env env, Napi::Function cb, int fd,
+                   Napi::Uint8Array ring, Options options) {
+  return GetReader(env)->StartRing(env, cb, fd, ring, std::move(options));
+}
+
+void Consumed(Napi::Env env, uint64_t id) {
+  GetReader(env)->Consumed(id);
+}
+
+void Record(Napi::Env env, uint64_t id,
+            std::shared_ptr<recorder::Recording> recording) {
+  GetReader(env)->Record(id, std::move(recording));
+}
+
+uint32_t WaitFor(Napi::Env env, uint64_t id,
+                 const std::vector<std::string>& patterns, Napi::Function cb) {
+  return GetReader(env)->WaitFor(env, id, patterns, cb);
+}
+
+void CancelWait(Napi::Env env, uint64_t id, uint32_t wait) {
+  GetReader(env)->CancelWait(id, wait);
+}
+
+void Pause(Napi::Env env, uint64_t id) {
+  GetReader(env)->Pause(id);
+}
+
+void Resume(Napi::Env env, uint64_t id) {
+  GetReader(env)->Resume(id);
+}
+
+void Stop(Napi::Env env, uint64_t id) {
+  GetReader(env)->Stop(env, id);
+}
+
+std::shared_ptr<const Stats> GetStats(Napi::Env env, uint64_t id) {
+  return GetReader(env)->GetStats(id);
+}
+
+}  // namespace reader
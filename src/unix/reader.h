@@ -0,0 +1,113 @@
+/**
+ * Copyright (c) 2026, Microsoft Corporation (MIT License).
+ *
+ * reader.h:
+ *   Reads every pty master that opted in on a single thread per environment
+ *   and hands the output to JS in batches.
+ */
+
+#ifndef NODE_PTY_READER_H_
+#define NODE_PTY_READER_H_
+
+#define NODE_ADDON_API_DISABLE_DEPRECATED
+#include <napi.h>
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "recorder.h"
+#include "scrollback.h"
+#include "tracker.h"
+
+namespace reader {
+
+// Where the output goes besides cb, see Start(). Each may be null.
+struct Options {
+  // Everything read is appended to log.
+  std::shared_ptr<scrollback::Log> log;
+  // Everything read is fed to tracker, whose events are passed to cb as an
+  // Array of objects after the output they were found in.
+  std::shared_ptr<tracker::Tracker> tracker;
+  // Hold back an incomplete UTF-8 or escape sequence at the end of what was
+  // read until the rest arrives, so cb never gets part of one. Gives up on
+  // sequences longer than 64KB and after 50ms without the rest. Not supported
+  // by StartRing().
+  bool hold_partial = false;
+  // Called with a Buffer of the output as plain text, see stripper.h, after
+  // cb got the output it came from. Optional.
+  Napi::Function plain;
+};
+
+// The number of buckets of Stats::sizes, whose upper bounds are 16 bytes and
+// then four times the previous one, the last catches everything larger.
+const size_t kSizeBuckets = 8;
+
+// Counters of a source, updated with relaxed atomics on the reader thread so
+// reading them never waits for it. Times are in nanoseconds.
+struct Stats {
+  // read(2) calls that returned output, and those that found none.
+  std::atomic<uint64_t> reads{0};
+  std::atomic<uint64_t> would_block{0};
+  std::atomic<uint64_t> bytes{0};
+  // Reads that returned output by size, see kSizeBuckets.
+  std::atomic<uint64_t> sizes[kSizeBuckets] = {};
+  // Bytes read but not yet handed to JS, always 0 for a ring.
+  std::atomic<uint64_t> pending{0};
+  // Time the fd was not polled because JS paused it or fell behind, and
+  // uv_hrtime() when the current stall started, 0 if there is none.
+  std::atomic<uint64_t> stalled{0};
+  std::atomic<uint64_t> stalled_since{0};
+};
+
+// Starts reading the nonblocking fd, calling cb(data) on the JS thread with a
+// Buffer of everything read since the last call, and cb(null, errno) once
+// when the fd hit EOF (errno 0) or failed. Returns the id used by the
+// functions below. Must be called from the JS thread, like all of them.
+uint64_t Start(Napi::Env env, Napi::Function cb, int fd, Options options);
+
+// Like Start() but reads straight into ring, a Uint8Array over shared memory,
+// and calls cb(head) rather than cb(data). The ring starts with a
+// kRingHeaderSize byte header holding the head and tail byte counters as
+// uint32 at offsets 0 and 4, followed by the data, whose size must be a power
+// of two. The reader advances head, the consumer advances tail and calls
+// Consumed(), output is left in the kernel while the ring is full.
+const size_t kRingHeaderSize = 64;
+uint64_t StartRing(Napi::Env env, Napi::Function cb, int fd,
+                   Napi::Uint8Array ring, Options options);
+void Consumed(Napi::Env env, uint64_t id);
+
+// Queues everything read from now on to recording as well, or stops doing so
+// when it is null.
+void Record(Napi::Env env, uint64_t id,
+            std::shared_ptr<recorder::Recording> recording);
+
+// Calls cb(index, offset) once the output delivered to the cb of a Start()
+// source from now on contains one of patterns, with the index of the pattern
+// and the offset of its first byte from the start of the output. Matched
+// right before the output is handed to JS, so output read but not yet
+// delivered is matched as well. Returns an id for CancelWait(), cb is not
+// called if the source stops first.
+uint32_t WaitFor(Napi::Env env, uint64_t id,
+                 const std::vector<std::string>& patterns, Napi::Function cb);
+void CancelWait(Napi::Env env, uint64_t id, uint32_t wait);
+
+// Stops and resumes polling the fd, data already read is still delivered.
+void Pause(Napi::Env env, uint64_t id);
+void Resume(Napi::Env env, uint64_t id);
+
+// Stops reading and closes the fd, cb is not called again.
+void Stop(Napi::Env env, uint64_t id);
+
+// The counters of a source until it is stopped, null afterwards.
+std::shared_ptr<const Stats> GetStats(Napi::Env env, uint64_t id);
+
+// The JS object for a command of a tracker, as passed to cb in events.
+Napi::Object CommandToObject(Napi::Env env, const tracker::Command& command);
+
+}  // namespace reader
+
+#endif  // NODE_PTY_READER_H_
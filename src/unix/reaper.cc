@@ -0,0 +1,554 @@
+/**
+ * Copyright (c) 2026, Microsoft Corporation (MIT License).
+ *
+ * reaper.cc:
+ *   One thread per environment reaps every pty child. Children are watched
+ *   with pidfd_open(2) and epoll on Linux 5.3+ and with EVFILT_PROC on kqueue
+ *   platforms. Children that cannot be watched that way (older kernels, other
+ *   platforms) are rescanned whenever SIGCHLD is delivered. Exits are handed
+ *   to JS in batches through a single ThreadSafeFunction.
+ */
+
+#include "reaper.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <uv.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+#define REAPER_USE_EPOLL
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || \
+      defined(__NetBSD__)
+#include <sys/event.h>
+#define REAPER_USE_KQUEUE
+#else
+#include <poll.h>
+#endif
+
+/* pidfd_open(2) was added in Linux 5.3, newer than the sysroot headers */
+#if defined(__linux__) && !defined(SYS_pidfd_open)
+#define SYS_pidfd_open 434
+#endif
+
+#define HANDLE_EINTR(x) ({ \
+  int eintr_wrapper_counter = 0; \
+  decltype(x) eintr_wrapper_result; \
+  do { \
+    eintr_wrapper_result = (x); \
+  } while (eintr_wrapper_result == -1 && errno == EINTR && \
+           eintr_wrapper_counter++ < 100); \
+  eintr_wrapper_result; \
+})
+
+namespace reaper {
+
+namespace {
+
+struct ExitEvent {
+  pid_t pid;
+  int exit_code = 0, signal_code = 0;
+  // Filled by wait4(2), unless the child was reaped elsewhere.
+  bool has_usage = false;
+  struct rusage usage;
+  // uv_hrtime() when the child was reaped.
+  uint64_t reaped_at = 0;
+};
+
+class Reaper;
+void CallJs(Napi::Env env, Napi::Function, Reaper* reaper, void*);
+using ExitTsfn = Napi::TypedThreadSafeFunction<Reaper, void, CallJs>;
+
+// Event payload of the wake pipe. Children are keyed by pid, which is never 0.
+const uint64_t kWakeToken = 0;
+
+// Marks a child that has no pidfd/kevent and is only found by Scan().
+const int kNoSource = -1;
+
+struct ExitCallback {
+  // Shared by every child of a WatchMany() batch.
+  std::shared_ptr<Napi::FunctionReference> fn;
+  // Whether the pid is passed as the first argument.
+  bool with_pid;
+  // uv_hrtime() right after the spawn of the child.
+  uint64_t spawned;
+};
+
+class Reaper {
+ public:
+  explicit Reaper(Napi::Env env);
+  ~Reaper();
+
+  void Watch(Napi::Env env, Napi::Function cb, pid_t pid, uint64_t spawned);
+  void WatchMany(Napi::Env env, Napi::Function cb,
+                 const std::vector<Child>& children);
+  void Deliver(Napi::Env env);
+
+ private:
+  void Run();
+  void Wake();
+  void Arm(Napi::Env env, pid_t pid);
+  bool Reap(pid_t pid, int options, std::vector<ExitEvent>* batch);
+  void Scan(std::vector<ExitEvent>* batch);
+  void Post(std::vector<ExitEvent>* batch);
+  void StartSigchldWatcher(Napi::Env env);
+
+  ExitTsfn tsfn_;
+  std::thread thread_;
+  std::atomic<bool> stopping_{false};
+  int poll_fd_ = -1;
+  int wake_fds_[2] = {-1, -1};
+
+  // Guards children_ and exited_, shared with the reaper thread.
+  std::mutex mutex_;
+  // pid -> pidfd on Linux, or kNoSource when the child is found by Scan().
+  std::unordered_map<pid_t, int> children_;
+  std::vector<ExitEvent> exited_;
+
+  // JS thread only.
+  std::unordered_map<pid_t, ExitCallback> callbacks_;
+  uv_signal_t* sigchld_ = nullptr;
+#if defined(REAPER_USE_EPOLL)
+  bool pidfd_supported_ = true;
+#endif
+};
+
+std::mutex g_reapers_mutex;
+std::unordered_map<napi_env, Reaper*> g_reapers;
+
+void CallJs(Napi::Env env, Napi::Function, Reaper* reaper, void*) {
+  if (env != nullptr && reaper != nullptr) {
+    reaper->Deliver(env);
+  }
+}
+
+Reaper::Reaper(Napi::Env env) {
+  tsfn_ = ExitTsfn::New(env,
+                        "node-pty.reaper", // Name
+                        0,                 // Unlimited queue
+                        1,                 // Only the reaper thread
+                        this);
+  // Only keep the event loop alive while there are children to wait for.
+  tsfn_.Unref(env);
+
+  if (pipe(wake_fds_) == -1) {
+    throw Napi::Error::New(env, "pipe(2) failed.");
+  }
+  for (int fd : wake_fds_) {
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  }
+
+#if defined(REAPER_USE_EPOLL)
+  poll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  if (poll_fd_ == -1) {
+    throw Napi::Error::New(env, "epoll_create1(2) failed.");
+  }
+  struct epoll_event ev = {};
+  ev.events = EPOLLIN;
+  ev.data.u64 = kWakeToken;
+  epoll_ctl(poll_fd_, EPOLL_CTL_ADD, wake_fds_[0], &ev);
+#elif defined(REAPER_USE_KQUEUE)
+  poll_fd_ = HANDLE_EINTR(kqueue());
+  if (poll_fd_ == -1) {
+    throw Napi::Error::New(env, "kqueue(2) failed.");
+  }
+  fcntl(poll_fd_, F_SETFD, FD_CLOEXEC);
+  struct kevent change;
+  EV_SET(&change, wake_fds_[0], EVFILT_READ, EV_ADD, 0, 0, NULL);
+  HANDLE_EINTR(kevent(poll_fd_, &change, 1, NULL, 0, NULL));
+#endif
+
+  thread_ = std::thread([this] { Run(); });
+}
+
+Reaper::~Reaper() {
+  stopping_ = true;
+  Wake();
+  thread_.join();
+
+  for (auto& child : children_) {
+    if (child.second != kNoSource) {
+#if defined(REAPER_USE_EPOLL)
+      close(child.second);
+#endif
+    }
+  }
+  if (sigchld_ != nullptr) {
+    uv_close(reinterpret_cast<uv_handle_t*>(sigchld_), [](uv_handle_t* handle) {
+      delete reinterpret_cast<uv_signal_t*>(handle);
+    });
+  }
+  if (poll_fd_ != -1) {
+    close(poll_fd_);
+  }
+  close(wake_fds_[0]);
+  close(wake_fds_[1]);
+  tsfn_.Release();
+}
+
+void Reaper::Watch(Napi::Env env, Napi::Function cb, pid_t pid,
+                   uint64_t spawned) {
+  auto fn = std::make_shared<Napi::FunctionReference>(Napi::Persistent(cb));
+  callbacks_[pid] = ExitCallback{fn, false, spawned};
+  if (callbacks_.size() == 1) {
+    tsfn_.Ref(env);
+  }
+  Arm(env, pid);
+}
+
+void Reaper::WatchMany(Napi::Env env, Napi::Function cb,
+                       const std::vector<Child>& children) {
+  if (children.empty()) {
+    return;
+  }
+  auto fn = std::make_shared<Napi::FunctionReference>(Napi::Persistent(cb));
+  bool was_empty = callbacks_.empty();
+  for (const Child& child : children) {
+    callbacks_[child.pid] = ExitCallback{fn, true, child.spawned};
+  }
+  if (was_empty) {
+    tsfn_.Ref(env);
+  }
+  for (const Child& child : children) {
+    Arm(env, child.pid);
+  }
+}
+
+void Reaper::Arm(Napi::Env env, pid_t pid) {
+#if defined(REAPER_USE_EPOLL)
+  int pidfd = -1;
+  if (pidfd_supported_) {
+    pidfd = syscall(SYS_pidfd_open, pid, 0);
+    if (pidfd == -1 && (errno == ENOSYS || errno == EPERM)) {
+      // Kernel older than 5.3, or the syscall is filtered by seccomp.
+      pidfd_supported_ = false;
+    }
+  }
+  if (pidfd != -1) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      children_[pid] = pidfd;
+    }
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.u64 = static_cast<uint64_t>(pid);
+    if (epoll_ctl(poll_fd_, EPOLL_CTL_ADD, pidfd, &ev) == 0) {
+      return;
+    }
+    close(pidfd);
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    children_[pid] = kNoSource;
+  }
+  StartSigchldWatcher(env);
+  // The child may have exited before SIGCHLD was being watched.
+  Wake();
+#elif defined(REAPER_USE_KQUEUE)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    children_[pid] = 0;
+  }
+  struct kevent change;
+  EV_SET(&change, pid, EVFILT_PROC, EV_ADD | EV_ONESHOT, NOTE_EXIT, 0, NULL);
+  if (HANDLE_EINTR(kevent(poll_fd_, &change, 1, NULL, 0, NULL)) == -1) {
+    // ESRCH, the child is already dead or dying. Let Scan() deal with it.
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      children_[pid] = kNoSource;
+    }
+    Wake();
+  }
+#else
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    children_[pid] = kNoSource;
+  }
+  StartSigchldWatcher(env);
+  Wake();
+#endif
+}
+
+void Reaper::StartSigchldWatcher(Napi::Env env) {
+  if (sigchld_ != nullptr) {
+    return;
+  }
+  uv_loop_t* loop = nullptr;
+  if (napi_get_uv_event_loop(env, &loop) != napi_ok) {
+    Napi::Error::Fatal("Reaper", "napi_get_uv_event_loop() failed");
+  }
+  // libuv supports several watchers per signal, so this coexists with the
+  // SIGCHLD handling of child_process.
+  sigchld_ = new uv_signal_t;
+  uv_signal_init(loop, sigchld_);
+  sigchld_->data = this;
+  uv_signal_start(sigchld_, [](uv_signal_t* handle, int) {
+    static_cast<Reaper*>(handle->data)->Wake();
+  }, SIGCHLD);
+  uv_unref(reinterpret_cast<uv_handle_t*>(sigchld_));
+}
+
+void Reaper::Wake() {
+  char c = 0;
+  HANDLE_EINTR(write(wake_fds_[1], &c, 1));
+}
+
+void Reaper::Run() {
+  std::vector<ExitEvent> batch;
+  while (!stopping_) {
+    bool scan = false;
+#if defined(REAPER_USE_EPOLL)
+    struct epoll_event events[64];
+    int n = epoll_wait(poll_fd_, events, 64, -1);
+    for (int i = 0; i < n; i++) {
+      if (events[i].data.u64 == kWakeToken) {
+        scan = true;
+      } else {
+        // The pidfd is readable once the child is a zombie, this won't block.
+        Reap(static_cast<pid_t>(events[i].data.u64), 0, &batch);
+      }
+    }
+#elif defined(REAPER_USE_KQUEUE)
+    struct kevent events[64];
+    int n = kevent(poll_fd_, NULL, 0, events, 64, NULL);
+    for (int i = 0; i < n; i++) {
+      if (events[i].filter == EVFILT_READ) {
+        scan = true;
+      } else if (events[i].filter == EVFILT_PROC &&
+                 (events[i].fflags & NOTE_EXIT)) {
+        // The process is dead or dying. This won't block for long, if at
+        // all.
+        Reap(static_cast<pid_t>(events[i].ident), 0, &batch);
+      }
+    }
+#else
+    struct pollfd pfd = { wake_fds_[0], POLLIN, 0 };
+    scan = poll(&pfd, 1, -1) == 1;
+#endif
+    if (scan) {
+      char buf[64];
+      while (read(wake_fds_[0], buf, sizeof(buf)) > 0) {}
+      if (stopping_) {
+        break;
+      }
+      Scan(&batch);
+    }
+    if (!batch.empty()) {
+      Post(&batch);
+    }
+  }
+}
+
+// Returns false when WNOHANG found the child still running.
+bool Reaper::Reap(pid_t pid, int options, std::vector<ExitEvent>* batch) {
+  int stat_loc = 0;
+  ExitEvent exit_event;
+  int ret = HANDLE_EINTR(wait4(pid, &stat_loc, options, &exit_event.usage));
+  if (ret == 0) {
+    // Still running
+    return false;
+  }
+
+  exit_event.pid = pid;
+  exit_event.reaped_at = uv_hrtime();
+  // ret == -1 with ECHILD: waitpid is already handled elsewhere, report a
+  // clean exit.
+  if (ret == pid) {
+    exit_event.has_usage = true;
+    if (WIFEXITED(stat_loc)) {
+      exit_event.exit_code = WEXITSTATUS(stat_loc);
+    }
+    if (WIFSIGNALED(stat_loc)) {
+      exit_event.signal_code = WTERMSIG(stat_loc);
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = children_.find(pid);
+    if (it != children_.end()) {
+#if defined(REAPER_USE_EPOLL)
+      if (it->second != kNoSource) {
+        // Closing the pidfd also removes it from the epoll set.
+        close(it->second);
+      }
+#endif
+      children_.erase(it);
+    }
+  }
+  batch->push_back(exit_event);
+  return true;
+}
+
+void Reaper::Scan(std::vector<ExitEvent>* batch) {
+  std::vector<pid_t> pids;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& child : children_) {
+      if (child.second == kNoSource) {
+        pids.push_back(child.first);
+      }
+    }
+  }
+  for (pid_t pid : pids) {
+#if defined(REAPER_USE_KQUEUE)
+    // EVFILT_PROC registration failed with ESRCH. At this point, one of the
+    // following has occurred:
+    // 1. The process has died but has not yet been reaped.
+    // 2. The process has died and has already been reaped.
+    // 3. The process is in the process of dying. It's no longer
+    //    kqueueable, but it may not be waitable yet either. Mark calls
+    //    this case the "zombie death race".
+    // A single WNOHANG wait4() reports cases 1 and 2, so case 1 keeps its
+    // exit status. Only case 3 is killed and waited for.
+    if (!Reap(pid, WNOHANG, batch) && kill(pid, SIGKILL) != -1) {
+      Reap(pid, 0, batch);
+    }
+#else
+    Reap(pid, WNOHANG, batch);
+#endif
+  }
+}
+
+void Reaper::Post(std::vector<ExitEvent>* batch) {
+  bool schedule;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    schedule = exited_.empty();
+    exited_.insert(exited_.end(), batch->begin(), batch->end());
+  }
+  batch->clear();
+  // A single pending call drains everything queued until it runs.
+  if (schedule) {
+    auto status = tsfn_.NonBlockingCall();
+    switch (status) {
+      case napi_ok:
+      case napi_closing:
+        break;
+
+      case napi_queue_full:
+        Napi::Error::Fatal("Reaper", "Queue was full");
+
+      default:
+        Napi::Error::Fatal("Reaper", "ThreadSafeFunction.NonBlockingCall() failed");
+    }
+  }
+}
+
+double ToMs(const struct timeval& tv) {
+  return tv.tv_sec * 1e3 + tv.tv_usec / 1e3;
+}
+
+Napi::Value ResourceUsage(Napi::Env env, const ExitEvent& exit_event,
+                          const ExitCallback& cb) {
+  if (!exit_event.has_usage) {
+    return env.Undefined();
+  }
+  const struct rusage& usage = exit_event.usage;
+  Napi::Object obj = Napi::Object::New(env);
+  obj.Set("userTime", Napi::Number::New(env, ToMs(usage.ru_utime)));
+  obj.Set("systemTime", Napi::Number::New(env, ToMs(usage.ru_stime)));
+#if defined(__APPLE__)
+  double max_rss = static_cast<double>(usage.ru_maxrss);
+#else
+  // Kilobytes everywhere but macOS.
+  double max_rss = static_cast<double>(usage.ru_maxrss) * 1024;
+#endif
+  obj.Set("maxRss", Napi::Number::New(env, max_rss));
+  obj.Set("voluntaryContextSwitches",
+          Napi::Number::New(env, static_cast<double>(usage.ru_nvcsw)));
+  obj.Set("involuntaryContextSwitches",
+          Napi::Number::New(env, static_cast<double>(usage.ru_nivcsw)));
+  uint64_t lifetime = exit_event.reaped_at > cb.spawned
+      ? exit_event.reaped_at - cb.spawned : 0;
+  obj.Set("lifetime", Napi::Number::New(env, lifetime / 1e6));
+  return obj;
+}
+
+void Reaper::Deliver(Napi::Env env) {
+  std::vector<ExitEvent> batch;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    batch.swap(exited_);
+  }
+
+  Napi::HandleScope scope(env);
+  Napi::Error error;
+  for (const ExitEvent& exit_event : batch) {
+    auto it = callbacks_.find(exit_event.pid);
+    if (it == callbacks_.end()) {
+      continue;
+    }
+    ExitCallback cb = std::move(it->second);
+    callbacks_.erase(it);
+    if (callbacks_.empty()) {
+      tsfn_.Unref(env);
+    }
+    // Keep delivering the rest of the batch if a listener throws, the first
+    // exception is rethrown afterwards.
+    try {
+      Napi::Value exit_code = Napi::Number::New(env, exit_event.exit_code);
+      Napi::Value signal_code = Napi::Number::New(env, exit_event.signal_code);
+      Napi::Value usage = ResourceUsage(env, exit_event, cb);
+      if (cb.with_pid) {
+        cb.fn->Call({Napi::Number::New(env, exit_event.pid), exit_code,
+                     signal_code, usage});
+      } else {
+        cb.fn->Call({exit_code, signal_code, usage});
+      }
+    } catch (const Napi::Error& e) {
+      if (error.IsEmpty()) {
+        error = e;
+      }
+    }
+  }
+  if (!error.IsEmpty()) {
+    throw error;
+  }
+}
+
+Reaper* GetReaper(Napi::Env env) {
+  std::lock_guard<std::mutex> lock(g_reapers_mutex);
+  auto it = g_reapers.find(env);
+  if (it != g_reapers.end()) {
+    return it->second;
+  }
+  Reaper* reaper = new Reaper(env);
+  g_reapers[env] = reaper;
+  napi_env raw_env = env;
+  env.AddCleanupHook([raw_env, reaper]() {
+    {
+      std::lock_guard<std::mutex> lock(g_reapers_mutex);
+      g_reapers.erase(raw_env);
+    }
+    delete reaper;
+  });
+  return reaper;
+}
+
+}  // namespace
+
+void Watch(Napi::Env env, Napi::Function cb, pid_t pid, uint64_t spawned) {
+  GetReaper(env)->Watch(env, cb, pid, spawned);
+}
+
+void WatchMany(Napi::Env env, Napi::Function cb,
+               const std::vector<Child>& children) {
+  GetReaper(env)->WatchMany(env, cb, children);
+}
+
+}  // namespace reaper
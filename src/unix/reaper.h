@@ -0,0 +1,40 @@
+/**
+ * Copyright (c) 2026, Microsoft Corporation (MIT License).
+ *
+ * reaper.h:
+ *   Waits for pty children to exit on a single thread per environment and
+ *   reports their exit status back to JS.
+ */
+
+#ifndef NODE_PTY_REAPER_H_
+#define NODE_PTY_REAPER_H_
+
+#define NODE_ADDON_API_DISABLE_DEPRECATED
+#include <napi.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <vector>
+
+namespace reaper {
+
+struct Child {
+  pid_t pid;
+  // uv_hrtime() right after the spawn, the start of its lifetime.
+  uint64_t spawned;
+};
+
+// Calls cb(exitCode, signal, usage) on the JS thread once pid has exited and
+// has been reaped. usage holds the rusage of the child and how long it lived
+// since spawned, or is undefined when something else reaped it. Must be
+// called from the JS thread.
+void Watch(Napi::Env env, Napi::Function cb, pid_t pid, uint64_t spawned);
+
+// Like Watch() for a batch of children that share one callback, which is
+// called as cb(pid, exitCode, signal, usage) for each of them.
+void WatchMany(Napi::Env env, Napi::Function cb,
+               const std::vector<Child>& children);
+
+}  // namespace reaper
+
+#endif  // NODE_PTY_REAPER_H_
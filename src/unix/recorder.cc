@@ -0,0 +1,346 @@
+/**
+ * Copyright (c) 2026, Microsoft Corporation (MIT License).
+ *
+ * recorder.cc:
+ *   Events are queued per recording with their raw data and timestamp. The
+ *   writer thread wakes once a recording has something queued, waits a little
+ *   for more, then formats every queued event as an asciicast line and hands
+ *   the lines to writev(2) together.
+ */
+
+#include "recorder.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <uv.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <thread>
+
+namespace recorder {
+
+namespace {
+
+// How long the writer thread collects events before writing them.
+const std::chrono::milliseconds kBatchDelay(20);
+
+const int kMaxIov = 64;
+
+struct Writer {
+  // Guards everything below.
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::vector<std::shared_ptr<Recording>> recordings;
+  bool pending = false;
+  bool started = false;
+};
+
+// Never destroyed, the writer thread may still be waiting on it when the
+// process exits.
+Writer& GetWriter() {
+  static Writer* writer = new Writer();
+  return *writer;
+}
+
+void Run(Writer* w) {
+  std::unique_lock<std::mutex> lock(w->mutex);
+  while (true) {
+    w->wake.wait(lock, [w] { return w->pending; });
+    lock.unlock();
+    std::this_thread::sleep_for(kBatchDelay);
+    lock.lock();
+    w->pending = false;
+    std::vector<std::shared_ptr<Recording>> recordings = w->recordings;
+    lock.unlock();
+    for (const auto& recording : recordings) {
+      if (!recording->Flush()) {
+        lock.lock();
+        auto& list = w->recordings;
+        list.erase(std::remove(list.begin(), list.end(), recording), list.end());
+        lock.unlock();
+      }
+    }
+    lock.lock();
+  }
+}
+
+void Schedule() {
+  Writer* w = &GetWriter();
+  std::lock_guard<std::mutex> lock(w->mutex);
+  if (!w->pending) {
+    w->pending = true;
+    w->wake.notify_one();
+  }
+}
+
+// Writes every line, continuing after short writes. Returns false on errors,
+// after which the recording is given up on rather than retried.
+bool WriteLines(int fd, const std::vector<std::string>& lines) {
+  size_t index = 0;
+  size_t offset = 0;
+  while (index < lines.size()) {
+    struct iovec iov[kMaxIov];
+    int count = 0;
+    for (size_t i = index; i < lines.size() && count < kMaxIov; i++) {
+      size_t skip = i == index ? offset : 0;
+      iov[count].iov_base = const_cast<char*>(lines[i].data() + skip);
+      iov[count].iov_len = lines[i].size() - skip;
+      count++;
+    }
+    ssize_t n = writev(fd, iov, count);
+    if (n == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    size_t written = static_cast<size_t>(n);
+    while (index < lines.size() && written >= lines[index].size() - offset) {
+      written -= lines[index].size() - offset;
+      offset = 0;
+      index++;
+    }
+    offset += written;
+  }
+  return true;
+}
+
+// The length of the UTF-8 sequence starting with lead, 0 if it is invalid.
+int SequenceLength(unsigned char lead) {
+  if (lead < 0x80) return 1;
+  if (lead >= 0xc2 && lead <= 0xdf) return 2;
+  if (lead >= 0xe0 && lead <= 0xef) return 3;
+  if (lead >= 0xf0 && lead <= 0xf4) return 4;
+  return 0;
+}
+
+// Whether c may follow lead as the second byte, which rules out overlong
+// encodings, surrogates and code points above U+10FFFF.
+bool ValidSecond(unsigned char lead, unsigned char c) {
+  switch (lead) {
+    case 0xe0: return c >= 0xa0 && c <= 0xbf;
+    case 0xed: return c >= 0x80 && c <= 0x9f;
+    case 0xf0: return c >= 0x90 && c <= 0xbf;
+    case 0xf4: return c >= 0x80 && c <= 0x8f;
+    default: return c >= 0x80 && c <= 0xbf;
+  }
+}
+
+void AppendEscaped(std::string* out, unsigned char c) {
+  switch (c) {
+    case '"': out->append("\\\""); return;
+    case '\\': out->append("\\\\"); return;
+    case '\b': out->append("\\b"); return;
+    case '\f': out->append("\\f"); return;
+    case '\n': out->append("\\n"); return;
+    case '\r': out->append("\\r"); return;
+    case '\t': out->append("\\t"); return;
+  }
+  if (c < 0x20) {
+    char buf[8];
+    snprintf(buf, sizeof(buf), "\\u%04x", c);
+    out->append(buf);
+    return;
+  }
+  out->push_back(static_cast<char>(c));
+}
+
+// Appends data to out as the contents of a JSON string. Invalid UTF-8 is
+// replaced by U+FFFD, an incomplete sequence at the end is moved to *carry,
+// which is prepended first.
+void AppendJsonString(std::string* out, const std::string& data,
+                      std::string* carry) {
+  std::string input;
+  const std::string* s = &data;
+  if (!carry->empty()) {
+    input = *carry + data;
+    carry->clear();
+    s = &input;
+  }
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(s->data());
+  size_t length = s->size();
+  size_t i = 0;
+  while (i < length) {
+    unsigned char lead = p[i];
+    if (lead < 0x80) {
+      AppendEscaped(out, lead);
+      i++;
+      continue;
+    }
+    int n = SequenceLength(lead);
+    int valid = n == 0 ? 0 : 1;
+    while (valid > 0 && valid < n && i + valid < length) {
+      unsigned char c = p[i + valid];
+      bool ok = valid == 1 ? ValidSecond(lead, c) : (c >= 0x80 && c <= 0xbf);
+      if (!ok) {
+        break;
+      }
+      valid++;
+    }
+    if (n != 0 && valid == n) {
+      out->append(reinterpret_cast<const char*>(p + i), n);
+      i += n;
+    } else if (valid > 0 && i + valid == length) {
+      // Possibly completed by the next event.
+      carry->assign(reinterpret_cast<const char*>(p + i), valid);
+      return;
+    } else {
+      out->append("\xef\xbf\xbd");
+      i += valid > 0 ? valid : 1;
+    }
+  }
+}
+
+}  // namespace
+
+Recording::Recording(int fd, std::string header)
+    : fd_(fd), header_(std::move(header)), start_(uv_hrtime()) {}
+
+void Recording::Output(const char* data, size_t length, uint64_t time) {
+  Queue('o', data, length, time);
+}
+
+void Recording::Input(const char* data, size_t length, uint64_t time) {
+  Queue('i', data, length, time);
+}
+
+void Recording::Resize(int cols, int rows, uint64_t time) {
+  std::string size = std::to_string(cols) + "x" + std::to_string(rows);
+  Queue('r', size.data(), size.size(), time);
+}
+
+void Recording::Queue(char type, const char* data, size_t length,
+                      uint64_t time) {
+  bool schedule;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (closing_) {
+      return;
+    }
+    schedule = events_.empty();
+    if (type == 'o' && !events_.empty() && events_.back().type == 'o' &&
+        events_.back().time == time) {
+      events_.back().data.append(data, length);
+      return;
+    }
+    events_.push_back({time, type, std::string(data, length)});
+  }
+  if (schedule) {
+    Schedule();
+  }
+}
+
+void Recording::Close() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (closing_) {
+      return;
+    }
+    closing_ = true;
+  }
+  Schedule();
+}
+
+bool Recording::Flush() {
+  std::vector<Event> events;
+  bool closing;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    events.swap(events_);
+    closing = closing_;
+  }
+  if (fd_ == -1) {
+    return !closing;
+  }
+
+  std::vector<std::string> lines;
+  lines.reserve(events.size() + 1);
+  if (!header_.empty()) {
+    lines.push_back(std::move(header_));
+    header_.clear();
+  }
+  for (const Event& event : events) {
+    // Events may be stamped on another thread just before the recording
+    // started.
+    uint64_t elapsed = event.time > start_ ? event.time - start_ : 0;
+    char prefix[64];
+    snprintf(prefix, sizeof(prefix), "[%llu.%06llu, \"%c\", \"",
+             static_cast<unsigned long long>(elapsed / 1000000000),
+             static_cast<unsigned long long>(elapsed % 1000000000 / 1000),
+             event.type);
+    std::string line(prefix);
+    line.reserve(line.size() + event.data.size() + 4);
+    std::string* carry = event.type == 'o' ? &output_carry_
+                       : event.type == 'i' ? &input_carry_
+                       : nullptr;
+    std::string none;
+    AppendJsonString(&line, event.data, carry ? carry : &none);
+    line.append("\"]\n");
+    lines.push_back(std::move(line));
+  }
+
+  if (!WriteLines(fd_, lines)) {
+    // Most likely out of space, stop rather than write a corrupt file.
+    close(fd_);
+    fd_ = -1;
+    return !closing;
+  }
+  if (closing) {
+    close(fd_);
+    fd_ = -1;
+    return false;
+  }
+  return true;
+}
+
+std::shared_ptr<Recording> Open(const std::string& path, int cols, int rows,
+                                const std::string& title,
+                                const std::string& term, std::string* err) {
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd == -1) {
+    *err = "open(2) failed: " + std::string(strerror(errno));
+    return nullptr;
+  }
+
+  std::string header = "{\"version\": 2, \"width\": " + std::to_string(cols) +
+                       ", \"height\": " + std::to_string(rows) +
+                       ", \"timestamp\": " + std::to_string(time(NULL));
+  if (!title.empty()) {
+    std::string carry;
+    header += ", \"title\": \"";
+    AppendJsonString(&header, title, &carry);
+    header += "\"";
+  }
+  if (!term.empty()) {
+    std::string carry;
+    header += ", \"env\": {\"TERM\": \"";
+    AppendJsonString(&header, term, &carry);
+    header += "\"}";
+  }
+  header += "}\n";
+
+  auto recording = std::make_shared<Recording>(fd, std::move(header));
+  Writer* w = &GetWriter();
+  {
+    std::lock_guard<std::mutex> lock(w->mutex);
+    w->recordings.push_back(recording);
+    if (!w->started) {
+      w->started = true;
+      std::thread(Run, w).detach();
+    }
+    // Write the header right away.
+    w->pending = true;
+    w->wake.notify_one();
+  }
+  return recording;
+}
+
+}  // namespace recorder
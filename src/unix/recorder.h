@@ -0,0 +1,75 @@
+/**
+ * Copyright (c) 2026, Microsoft Corporation (MIT License).
+ *
+ * recorder.h:
+ *   Records the output and input of a pty to an asciicast v2 file. Events
+ *   are timestamped where they happen and written in batches by a single
+ *   process wide writer thread.
+ */
+
+#ifndef NODE_PTY_RECORDER_H_
+#define NODE_PTY_RECORDER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace recorder {
+
+struct Event {
+  // uv_hrtime() when it happened.
+  uint64_t time;
+  // 'o' for output, 'i' for input and 'r' for a resize.
+  char type;
+  std::string data;
+};
+
+class Recording {
+ public:
+  // Takes ownership of fd, which the header is written to first.
+  Recording(int fd, std::string header);
+
+  // Queue events for the writer thread, from any thread. Output with the same
+  // time as the previous event is merged into it.
+  void Output(const char* data, size_t length, uint64_t time);
+  void Input(const char* data, size_t length, uint64_t time);
+  void Resize(int cols, int rows, uint64_t time);
+
+  // Writes whatever is queued and closes the file. Events queued afterwards
+  // are dropped.
+  void Close();
+
+  // Writer thread only. Writes the queued events and returns false once the
+  // recording is closed and done with.
+  bool Flush();
+
+ private:
+  void Queue(char type, const char* data, size_t length, uint64_t time);
+
+  std::mutex mutex_;
+  std::vector<Event> events_;
+  bool closing_ = false;
+
+  // Writer thread only.
+  int fd_;
+  std::string header_;
+  uint64_t start_ = 0;
+  // Incomplete UTF-8 sequences left over at the end of the last output and
+  // input event.
+  std::string output_carry_;
+  std::string input_carry_;
+};
+
+// Opens path for a recording of a cols x rows terminal, returns null and sets
+// *err on failure. The recording starts now.
+std::shared_ptr<Recording> Open(const std::string& path, int cols, int rows,
+                                const std::string& title,
+                                const std::string& term, std::string* err);
+
+}  // namespace recorder
+
+#endif  // NODE_PTY_RECORDER_H_
@@ -0,0 +1,123 @@
+/**
+ * Copyright (c) 2026, Microsoft Corporation (MIT License).
+ *
+ * scan.cc:
+ *   Each vector loop only tells whether a block of 16 bytes holds a match.
+ *   The scalar loop that handles the tail then finds it within the block.
+ */
+
+#include "scan.h"
+
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace scan {
+
+namespace {
+
+const unsigned char kDel = 0x7f;
+
+inline bool IsControl(unsigned char c) {
+  return c < 0x20 || c == kDel;
+}
+
+}  // namespace
+
+const unsigned char* FindControl(const unsigned char* p,
+                                 const unsigned char* end) {
+#if defined(__SSE2__)
+  const __m128i space = _mm_set1_epi8(0x1f);
+  const __m128i del = _mm_set1_epi8(0x7f);
+  while (end - p >= 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    // v <= 0x1f unsigned, as max(v, 0x1f) == 0x1f.
+    __m128i control = _mm_or_si128(
+        _mm_cmpeq_epi8(_mm_max_epu8(v, space), space),
+        _mm_cmpeq_epi8(v, del));
+    if (_mm_movemask_epi8(control) != 0) {
+      break;
+    }
+    p += 16;
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  const uint8x16_t space = vdupq_n_u8(0x20);
+  const uint8x16_t del = vdupq_n_u8(0x7f);
+  while (end - p >= 16) {
+    uint8x16_t v = vld1q_u8(p);
+    uint8x16_t control = vorrq_u8(vcltq_u8(v, space), vceqq_u8(v, del));
+    if (vmaxvq_u8(control) != 0) {
+      break;
+    }
+    p += 16;
+  }
+#endif
+  while (p < end && !IsControl(*p)) {
+    p++;
+  }
+  return p;
+}
+
+void ByteSet::Add(unsigned char c) {
+  if (table_[c]) {
+    return;
+  }
+  table_[c] = true;
+  if (count_ < kMaxVectorBytes) {
+    bytes_[count_] = c;
+  }
+  count_++;
+}
+
+const unsigned char* ByteSet::Find(const unsigned char* p,
+                                   const unsigned char* end) const {
+  if (count_ == 1) {
+    const void* found = memchr(p, bytes_[0], end - p);
+    return found ? static_cast<const unsigned char*>(found) : end;
+  }
+  if (count_ <= kMaxVectorBytes) {
+#if defined(__SSE2__)
+    __m128i needles[kMaxVectorBytes];
+    for (size_t i = 0; i < count_; i++) {
+      needles[i] = _mm_set1_epi8(static_cast<char>(bytes_[i]));
+    }
+    while (end - p >= 16) {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+      __m128i hits = _mm_cmpeq_epi8(v, needles[0]);
+      for (size_t i = 1; i < count_; i++) {
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(v, needles[i]));
+      }
+      if (_mm_movemask_epi8(hits) != 0) {
+        break;
+      }
+      p += 16;
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    uint8x16_t needles[kMaxVectorBytes];
+    for (size_t i = 0; i < count_; i++) {
+      needles[i] = vdupq_n_u8(bytes_[i]);
+    }
+    while (end - p >= 16) {
+      uint8x16_t v = vld1q_u8(p);
+      uint8x16_t hits = vceqq_u8(v, needles[0]);
+      for (size_t i = 1; i < count_; i++) {
+        hits = vorrq_u8(hits, vceqq_u8(v, needles[i]));
+      }
+      if (vmaxvq_u8(hits) != 0) {
+        break;
+      }
+      p += 16;
+    }
+#endif
+  }
+  while (p < end && !table_[*p]) {
+    p++;
+  }
+  return p;
+}
+
+}  // namespace scan
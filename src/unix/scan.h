@@ -0,0 +1,44 @@
+/**
+ * Copyright (c) 2026, Microsoft Corporation (MIT License).
+ *
+ * scan.h:
+ *   Searches output for the next byte of interest 16 bytes at a time with
+ *   SSE2 or NEON where available, shared by the parsers on the read path.
+ */
+
+#ifndef NODE_PTY_SCAN_H_
+#define NODE_PTY_SCAN_H_
+
+#include <stddef.h>
+
+namespace scan {
+
+// The first C0 control or DEL from p on, or end.
+const unsigned char* FindControl(const unsigned char* p,
+                                 const unsigned char* end);
+
+// A set of bytes to search for. Up to kMaxVectorBytes distinct bytes are
+// compared against 16 bytes at a time, larger sets fall back to a lookup
+// table per byte.
+class ByteSet {
+ public:
+  static const size_t kMaxVectorBytes = 8;
+
+  void Add(unsigned char c);
+  bool Contains(unsigned char c) const { return table_[c]; }
+  bool Empty() const { return count_ == 0; }
+
+  // The first byte of the set from p on, or end.
+  const unsigned char* Find(const unsigned char* p,
+                            const unsigned char* end) const;
+
+ private:
+  bool table_[256] = {};
+  // The distinct bytes of the set, in the order they were added.
+  unsigned char bytes_[kMaxVectorBytes] = {};
+  size_t count_ = 0;
+};
+
+}  // namespace scan
+
+#endif  // NODE_PTY_SCAN_H_
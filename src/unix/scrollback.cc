@@ -0,0 +1,219 @@
+/**
+ * Copyright (c) 2026, Microsoft Corporation (MIT License).
+ *
+ * scrollback.cc:
+ *   Both logs are a deque of fixed size blocks, allocated on the heap or
+ *   mapped from a file. Output is copied into the last block, a new one is
+ *   added once it is full and the front block is freed once every byte in it
+ *   is older than the limit.
+ */
+
+#include "scrollback.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace scrollback {
+
+MemoryLog::MemoryLog(size_t limit) : limit_(limit) {}
+
+void MemoryLog::Append(const char* data, size_t length) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (length >= limit_) {
+    // Everything kept so far is dropped, skip copying it in the first place.
+    size_t skip = length - limit_;
+    blocks_.clear();
+    offset_ = 0;
+    end_ += skip;
+    start_ = end_;
+    data += skip;
+    length = limit_;
+  }
+  while (length > 0) {
+    size_t pos = offset_ + static_cast<size_t>(end_ - start_);
+    size_t index = pos / kBlockSize;
+    size_t within = pos % kBlockSize;
+    if (index == blocks_.size()) {
+      blocks_.emplace_back(new char[kBlockSize]);
+    }
+    size_t n = std::min(length, kBlockSize - within);
+    memcpy(blocks_[index].get() + within, data, n);
+    data += n;
+    length -= n;
+    end_ += n;
+  }
+  if (end_ - start_ > limit_) {
+    size_t drop = static_cast<size_t>(end_ - start_ - limit_);
+    start_ += drop;
+    offset_ += drop;
+    while (offset_ >= kBlockSize) {
+      blocks_.pop_front();
+      offset_ -= kBlockSize;
+    }
+  }
+}
+
+uint64_t MemoryLog::Start() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return start_;
+}
+
+uint64_t MemoryLog::End() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return end_;
+}
+
+uint64_t MemoryLog::Read(uint64_t seq, uint64_t end, std::string* out) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  end = std::min(end, end_);
+  uint64_t from = std::max(seq, start_);
+  if (from >= end) {
+    return std::min(from, end);
+  }
+  out->reserve(out->size() + static_cast<size_t>(end - from));
+  size_t pos = offset_ + static_cast<size_t>(from - start_);
+  size_t length = static_cast<size_t>(end - from);
+  while (length > 0) {
+    size_t within = pos % kBlockSize;
+    size_t n = std::min(length, kBlockSize - within);
+    out->append(blocks_[pos / kBlockSize].get() + within, n);
+    pos += n;
+    length -= n;
+  }
+  return from;
+}
+
+SegmentLog::SegmentLog(const std::string& directory, size_t segment_size,
+                       size_t limit)
+    : directory_(directory),
+      segment_size_(segment_size),
+      max_segments_(std::max<size_t>(1, limit / segment_size)) {}
+
+SegmentLog::~SegmentLog() {
+  for (const Segment& segment : segments_) {
+    munmap(segment.data, segment_size_);
+  }
+}
+
+bool SegmentLog::Open(std::string* err) {
+  return AddSegment(err);
+}
+
+// Maps a new segment at end_. Called on the appending thread, the lock is
+// only taken to add it to segments_.
+bool SegmentLog::AddSegment(std::string* err) {
+  std::string path = directory_ + "/node-pty-scrollback-XXXXXX";
+  std::vector<char> name(path.begin(), path.end());
+  name.push_back('\0');
+  int fd = mkstemp(name.data());
+  if (fd == -1) {
+    *err = "mkstemp(3) failed: " + std::string(strerror(errno));
+    return false;
+  }
+  // Only the mapping is needed from here on.
+  unlink(name.data());
+  void* data = MAP_FAILED;
+  if (ftruncate(fd, static_cast<off_t>(segment_size_)) == 0) {
+    data = mmap(NULL, segment_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  int error = errno;
+  close(fd);
+  if (data == MAP_FAILED) {
+    *err = "Mapping a scrollback segment failed: " + std::string(strerror(error));
+    return false;
+  }
+
+  Segment dropped = {0, nullptr};
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    segments_.push_back({end_, static_cast<char*>(data)});
+    if (segments_.size() > max_segments_) {
+      dropped = segments_.front();
+      segments_.pop_front();
+    }
+  }
+  if (dropped.data != nullptr) {
+    munmap(dropped.data, segment_size_);
+  }
+  return true;
+}
+
+void SegmentLog::Append(const char* data, size_t length) {
+  while (length > 0 && error_.empty()) {
+    const Segment& last = segments_.back();
+    size_t within = static_cast<size_t>(end_ - last.start);
+    if (within == segment_size_) {
+      std::string err;
+      if (!AddSegment(&err)) {
+        // Don't serve a log with a gap in it.
+        std::deque<Segment> segments;
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          segments.swap(segments_);
+          error_ = err;
+        }
+        for (const Segment& segment : segments) {
+          munmap(segment.data, segment_size_);
+        }
+        break;
+      }
+      continue;
+    }
+    // Past end_, so nothing reads it yet.
+    size_t n = std::min(length, segment_size_ - within);
+    memcpy(last.data + within, data, n);
+    data += n;
+    length -= n;
+    std::lock_guard<std::mutex> lock(mutex_);
+    end_ += n;
+  }
+  if (length > 0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    end_ += length;
+  }
+}
+
+uint64_t SegmentLog::Start() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return segments_.empty() ? end_ : segments_.front().start;
+}
+
+uint64_t SegmentLog::End() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return end_;
+}
+
+uint64_t SegmentLog::Read(uint64_t seq, uint64_t end, std::string* out) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  uint64_t start = segments_.empty() ? end_ : segments_.front().start;
+  end = std::min(end, end_);
+  uint64_t from = std::max(seq, start);
+  if (from >= end) {
+    return std::min(from, end);
+  }
+  out->reserve(out->size() + static_cast<size_t>(end - from));
+  // Segments are full except for the last, so the index is a division.
+  size_t index = static_cast<size_t>((from - start) / segment_size_);
+  uint64_t pos = from;
+  while (pos < end) {
+    const Segment& segment = segments_[index++];
+    size_t within = static_cast<size_t>(pos - segment.start);
+    size_t n = static_cast<size_t>(std::min<uint64_t>(end - pos, segment_size_ - within));
+    out->append(segment.data + within, n);
+    pos += n;
+  }
+  return from;
+}
+
+std::string SegmentLog::Error() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return error_;
+}
+
+}  // namespace scrollback
@@ -0,0 +1,113 @@
+/**
+ * Copyright (c) 2026, Microsoft Corporation (MIT License).
+ *
+ * scrollback.h:
+ *   A bounded log of the raw output of a pty kept in native memory or in
+ *   memory mapped files, so clients that reconnect can be sent what they
+ *   missed.
+ */
+
+#ifndef NODE_PTY_SCROLLBACK_H_
+#define NODE_PTY_SCROLLBACK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace scrollback {
+
+// Every byte is addressed by its sequence number, the number of bytes
+// appended before it. Appended to on the reader thread and read on the JS
+// thread.
+class Log {
+ public:
+  virtual ~Log() {}
+
+  virtual void Append(const char* data, size_t length) = 0;
+
+  // The sequence numbers of the oldest byte kept and one past the newest.
+  virtual uint64_t Start() const = 0;
+  virtual uint64_t End() const = 0;
+
+  // Copies the bytes from seq up to end, clamped to what is kept, to out and
+  // returns the sequence number of the first one. That is Start() when the
+  // output from seq on was already dropped.
+  virtual uint64_t Read(uint64_t seq, uint64_t end, std::string* out) const = 0;
+
+  // Why the log stopped keeping output, empty while it works.
+  virtual std::string Error() const { return std::string(); }
+};
+
+// Keeps the newest limit bytes in memory. Memory is taken in blocks as output
+// arrives, so an idle log costs next to nothing.
+class MemoryLog : public Log {
+ public:
+  explicit MemoryLog(size_t limit);
+
+  void Append(const char* data, size_t length) override;
+  uint64_t Start() const override;
+  uint64_t End() const override;
+  uint64_t Read(uint64_t seq, uint64_t end, std::string* out) const override;
+
+ private:
+  static const size_t kBlockSize = 16 * 1024;
+
+  mutable std::mutex mutex_;
+  const size_t limit_;
+  std::deque<std::unique_ptr<char[]>> blocks_;
+  // Where start_ is in the front block.
+  size_t offset_ = 0;
+  uint64_t start_ = 0;
+  uint64_t end_ = 0;
+};
+
+// Writes the output to memory mapped segment files of segment_size bytes in
+// directory, keeping only the index of where each segment starts in memory.
+// The oldest segment is dropped once the segments would take more than limit
+// bytes. The files are unlinked as soon as they are created, so nothing is
+// left behind when the process dies. Output is no longer kept once a segment
+// could not be created, see Error().
+//
+// Only one thread may append. It writes past End() and creates segments
+// without holding the lock Read() takes, so slow disks and page faults never
+// hold up readers, and only takes it to publish what it wrote.
+class SegmentLog : public Log {
+ public:
+  SegmentLog(const std::string& directory, size_t segment_size, size_t limit);
+  ~SegmentLog() override;
+
+  // Creates the first segment, returns false and sets *err on failure.
+  bool Open(std::string* err);
+
+  void Append(const char* data, size_t length) override;
+  uint64_t Start() const override;
+  uint64_t End() const override;
+  uint64_t Read(uint64_t seq, uint64_t end, std::string* out) const override;
+  std::string Error() const override;
+
+ private:
+  struct Segment {
+    uint64_t start;
+    char* data;
+  };
+
+  bool AddSegment(std::string* err);
+
+  // Guards segments_, end_ and error_ against the appending thread, which
+  // reads them without it.
+  mutable std::mutex mutex_;
+  const std::string directory_;
+  const size_t segment_size_;
+  const size_t max_segments_;
+  std::deque<Segment> segments_;
+  uint64_t end_ = 0;
+  std::string error_;
+};
+
+}  // namespace scrollback
+
+#endif  // NODE_PTY_SCROLLBACK_H_
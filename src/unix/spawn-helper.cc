@@ -1,23 +1,122 @@
 #include <errno.h>
 #include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
+#include <sys/ioctl.h>
 
+#if defined(__linux__)
+#include <sys/syscall.h>
+
+/**
+ * Close all file descriptors >= 3 to prevent FD leakage to child processes.
+ * Uses close_range() syscall on Linux 5.9+, falls back to setting CLOEXEC on
+ * each descriptor.
+ */
+static void
+pty_close_inherited_fds() {
+  // Try close_range() first (Linux 5.9+, glibc 2.34+)
+  #if defined(SYS_close_range) && defined(CLOSE_RANGE_CLOEXEC)
+  if (syscall(SYS_close_range, 3, ~0U, CLOSE_RANGE_CLOEXEC) == 0) {
+    return;
+  }
+  #endif
+
+  int fd;
+  // Set the CLOEXEC flag on all open descriptors. Unconditionally try the first
+  // 16 file descriptors. After that, bail out after the first error.
+  for (fd = 3; ; fd++) {
+    int flags = fcntl(fd, F_GETFD, 0);
+    if ((flags == -1 || fcntl(fd, F_SETFD, flags | FD_CLOEXEC) == -1) && fd > 15)
+      break;
+  }
+}
+#endif
+
+/**
+ * Writes the current time to the timing pipe pty.fork placed on fd 3, using
+ * the clock uv_hrtime() reads so the parent can compare the two.
+ */
+static void
+pty_mark_phase() {
+  struct timespec ts;
+#if defined(__APPLE__)
+  clock_gettime(CLOCK_UPTIME_RAW, &ts);
+#else
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+  uint64_t ns = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+  ssize_t r;
+  do
+    r = write(3, &ns, sizeof(ns));
+  while (r == -1 && errno == EINTR);
+}
+
+// Usage: spawn-helper <cwd> <uid> <gid> <file> [args...]
+//
+// Started by pty.fork through posix_spawn with the pty slave on stdio and in a
+// new session. A uid/gid of -1 leaves the credentials untouched. A timestamp
+// is written to fd 3 when the helper starts and after acquiring the
+// controlling terminal, chdir, setuid, closing inherited fds and right before
+// exec, fd 3 itself is closed by the exec.
 int main (int argc, char** argv) {
+  pty_mark_phase();
+  if (argc < 5) {
+    _exit(1);
+  }
+
+#if defined(__linux__)
+  // POSIX_SPAWN_SETSID made us a session leader without a controlling
+  // terminal, acquire the slave.
+  if (ioctl(STDIN_FILENO, TIOCSCTTY, 0) == -1) {
+    perror("ioctl(TIOCSCTTY) failed.");
+    _exit(1);
+  }
+#else
   char *slave_path = ttyname(STDIN_FILENO);
   // open implicit attaches a process to a terminal device if:
   // - process has no controlling terminal yet
   // - O_NOCTTY is not set
   close(open(slave_path, O_RDWR));
+#endif
+  pty_mark_phase();
 
   char *cwd = argv[1];
-  char *file = argv[2];
-  argv = &argv[2];
+  int uid = atoi(argv[2]);
+  int gid = atoi(argv[3]);
+  char *file = argv[4];
+  argv = &argv[4];
 
   if (strlen(cwd) && chdir(cwd) == -1) {
+    perror("chdir(2) failed.");
     _exit(1);
   }
+  pty_mark_phase();
+
+  if (uid != -1 && gid != -1) {
+    if (setgid(gid) == -1) {
+      perror("setgid(2) failed.");
+      _exit(1);
+    }
+    if (setuid(uid) == -1) {
+      perror("setuid(2) failed.");
+      _exit(1);
+    }
+  }
+  pty_mark_phase();
+
+#if defined(__linux__)
+  // Close inherited FDs to prevent leaking pty master FDs to child
+  pty_close_inherited_fds();
+#endif
+  pty_mark_phase();
 
+  fcntl(3, F_SETFD, FD_CLOEXEC);
+  pty_mark_phase();
   execvp(file, argv);
+  perror("execvp(3) failed.");
   return 1;
 }
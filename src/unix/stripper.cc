@@ -0,0 +1,120 @@
+/**
+ * Copyright (c) 2026, Microsoft Corporation (MIT License).
+ *
+ * stripper.cc:
+ *   Plain text is copied in runs up to the next control character, found
+ *   with scan::FindControl().
+ */
+
+#include "stripper.h"
+
+#include "scan.h"
+
+namespace stripper {
+
+namespace {
+
+const unsigned char kBel = 0x07;
+const unsigned char kTab = 0x09;
+const unsigned char kLf = 0x0a;
+const unsigned char kCr = 0x0d;
+const unsigned char kCan = 0x18;
+const unsigned char kSub = 0x1a;
+const unsigned char kEsc = 0x1b;
+
+}  // namespace
+
+void Stripper::Feed(const char* data, size_t length, std::string* out) {
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+  const unsigned char* end = p + length;
+  while (p < end) {
+    switch (state_) {
+      case kGround: {
+        const unsigned char* control = scan::FindControl(p, end);
+        if (control != p) {
+          out->append(reinterpret_cast<const char*>(p), control - p);
+          after_cr_ = false;
+          p = control;
+          if (p == end) {
+            return;
+          }
+        }
+        unsigned char c = *p++;
+        if (c == kEsc) {
+          state_ = kEscape;
+        } else if (c == kCr) {
+          if (!after_cr_) {
+            out->push_back('\n');
+            after_cr_ = true;
+          }
+        } else if (c == kLf) {
+          if (!after_cr_) {
+            out->push_back('\n');
+          }
+          after_cr_ = false;
+        } else if (c == kTab) {
+          out->push_back('\t');
+          after_cr_ = false;
+        }
+        break;
+      }
+      case kEscape: {
+        unsigned char c = *p++;
+        if (c == '[') {
+          state_ = kCsi;
+        } else if (c == ']' || c == 'P' || c == 'X' || c == '^' || c == '_') {
+          state_ = kString;
+        } else if (c >= 0x20 && c <= 0x2f) {
+          state_ = kEscapeIntermediate;
+        } else if (c != kEsc) {
+          state_ = kGround;
+        }
+        break;
+      }
+      case kEscapeIntermediate: {
+        unsigned char c = *p++;
+        if (c == kEsc) {
+          state_ = kEscape;
+        } else if (c < 0x20 || c > 0x2f) {
+          state_ = kGround;
+        }
+        break;
+      }
+      case kCsi: {
+        unsigned char c = *p++;
+        if (c == kEsc) {
+          state_ = kEscape;
+        } else if ((c >= 0x40 && c <= 0x7e) || c == kCan || c == kSub) {
+          state_ = kGround;
+        }
+        break;
+      }
+      case kString: {
+        // Only controls can end a string.
+        p = scan::FindControl(p, end);
+        if (p == end) {
+          return;
+        }
+        unsigned char c = *p++;
+        if (c == kEsc) {
+          state_ = kStringEscape;
+        } else if (c == kBel || c == kCan || c == kSub) {
+          state_ = kGround;
+        }
+        break;
+      }
+      case kStringEscape:
+        if (*p == '\\') {
+          state_ = kGround;
+          p++;
+        } else {
+          // Cut short by another escape sequence, started by the ESC just
+          // seen.
+          state_ = kEscape;
+        }
+        break;
+    }
+  }
+}
+
+}  // namespace stripper
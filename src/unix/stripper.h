@@ -0,0 +1,47 @@
+/**
+ * Copyright (c) 2026, Microsoft Corporation (MIT License).
+ *
+ * stripper.h:
+ *   Turns the output of a pty into plain text for logs and search, removing
+ *   escape sequences and control characters and normalising line endings.
+ */
+
+#ifndef NODE_PTY_STRIPPER_H_
+#define NODE_PTY_STRIPPER_H_
+
+#include <stddef.h>
+
+#include <string>
+
+namespace stripper {
+
+// Escape sequences (ESC, CSI, OSC, DCS, SOS, PM and APC) and C0 controls
+// other than tab are removed. CR, LF and CRLF all become LF, runs of CR
+// count once. Everything else, UTF-8 included, is passed through as is.
+class Stripper {
+ public:
+  // Appends the plain text of the next length bytes of output to *out.
+  // Sequences may be split across calls.
+  void Feed(const char* data, size_t length, std::string* out);
+
+ private:
+  enum State {
+    kGround,
+    kEscape,
+    // After ESC and intermediate bytes, waiting for the final byte.
+    kEscapeIntermediate,
+    kCsi,
+    // The payload of an OSC, DCS, SOS, PM or APC.
+    kString,
+    // After an ESC in a string, which should be the start of ST.
+    kStringEscape,
+  };
+
+  State state_ = kGround;
+  // The last character was a CR, turned into an LF already.
+  bool after_cr_ = false;
+};
+
+}  // namespace stripper
+
+#endif  // NODE_PTY_STRIPPER_H_
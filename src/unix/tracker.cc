@@ -0,0 +1,247 @@
+/**
+ * Copyright (c) 2026, Microsoft Corporation (MIT License).
+ *
+ * tracker.cc:
+ *   Outside of an OSC the output is only searched for ESC, and inside one
+ *   for the BEL or ESC that ends it, so plain output is skipped without
+ *   looking at each byte. Only the payloads of OSCs are copied, up to
+ *   kMaxPayload bytes.
+ */
+
+#include "tracker.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace tracker {
+
+namespace {
+
+const char kEsc = '\x1b';
+const char kBel = '\x07';
+
+// OSC payloads longer than this are not shell integration and are skipped.
+const size_t kMaxPayload = 4096;
+
+bool StartsWith(const std::string& s, const char* prefix) {
+  return s.compare(0, strlen(prefix), prefix) == 0;
+}
+
+int HexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// The path of an OSC 7 file://host/path URL, percent-decoded, or an empty
+// string if url is not one.
+std::string ParseFileUrl(const std::string& url) {
+  if (!StartsWith(url, "file://")) {
+    return "";
+  }
+  // Skip the host.
+  size_t slash = url.find('/', 7);
+  if (slash == std::string::npos) {
+    return "";
+  }
+  std::string path;
+  for (size_t i = slash; i < url.size(); i++) {
+    int high;
+    int low;
+    if (url[i] == '%' && i + 2 < url.size() &&
+        (high = HexValue(url[i + 1])) != -1 &&
+        (low = HexValue(url[i + 2])) != -1) {
+      path.push_back(static_cast<char>(high * 16 + low));
+      i += 2;
+    } else {
+      path.push_back(url[i]);
+    }
+  }
+  return path;
+}
+
+}  // namespace
+
+Tracker::Tracker(size_t history) : history_(history) {
+  payload_ends_.Add(kBel);
+  payload_ends_.Add(kEsc);
+}
+
+void Tracker::Feed(const char* data, size_t length, uint64_t offset,
+                   uint64_t time, std::vector<Event>* events) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const char* p = data;
+  const char* end = data + length;
+  while (p < end) {
+    switch (state_) {
+      case kGround: {
+        const char* esc = static_cast<const char*>(memchr(p, kEsc, end - p));
+        if (esc == nullptr) {
+          return;
+        }
+        start_ = offset + (esc - data);
+        state_ = kEscape;
+        p = esc + 1;
+        break;
+      }
+      case kEscape:
+        if (*p == ']') {
+          state_ = kOsc;
+          payload_.clear();
+          overflow_ = false;
+        } else if (*p == kEsc) {
+          start_ = offset + (p - data);
+        } else {
+          state_ = kGround;
+        }
+        p++;
+        break;
+      case kOsc: {
+        const char* q = reinterpret_cast<const char*>(payload_ends_.Find(
+            reinterpret_cast<const unsigned char*>(p),
+            reinterpret_cast<const unsigned char*>(end)));
+        size_t n = q - p;
+        if (!overflow_ && payload_.size() + n <= kMaxPayload) {
+          payload_.append(p, n);
+        } else {
+          overflow_ = true;
+        }
+        p = q;
+        if (p == end) {
+          return;
+        }
+        if (*p == kBel) {
+          Dispatch(time, events);
+          state_ = kGround;
+        } else {
+          escape_ = offset + (p - data);
+          state_ = kOscEscape;
+        }
+        p++;
+        break;
+      }
+      case kOscEscape:
+        if (*p == '\\') {
+          Dispatch(time, events);
+          state_ = kGround;
+          p++;
+        } else {
+          // The OSC was cut short by another escape sequence, which starts at
+          // the ESC just seen.
+          start_ = escape_;
+          state_ = kEscape;
+        }
+        break;
+    }
+  }
+}
+
+void Tracker::Dispatch(uint64_t time, std::vector<Event>* events) {
+  if (overflow_) {
+    return;
+  }
+  if (StartsWith(payload_, "133;") && payload_.size() >= 5) {
+    std::string args;
+    if (payload_.size() > 6 && payload_[5] == ';') {
+      args = payload_.substr(6);
+    }
+    Mark(payload_[4], args, time, events);
+  } else if (StartsWith(payload_, "7;")) {
+    std::string cwd = ParseFileUrl(payload_.substr(2));
+    if (!cwd.empty()) {
+      cwd_ = cwd;
+      Event event;
+      event.type = Event::kCwd;
+      event.offset = start_;
+      event.cwd = cwd;
+      events->push_back(std::move(event));
+    }
+  }
+}
+
+void Tracker::Mark(char marker, const std::string& args, uint64_t time,
+                   std::vector<Event>* events) {
+  switch (marker) {
+    case 'A': {
+      if (has_current_ && current_.output != kUnknown) {
+        // The shell never reported that the last command finished.
+        Mark('D', "", time, events);
+      }
+      current_ = Command();
+      current_.prompt = start_;
+      current_.cwd = cwd_;
+      has_current_ = true;
+      Event event;
+      event.type = Event::kPrompt;
+      event.offset = start_;
+      event.command = current_;
+      events->push_back(std::move(event));
+      return;
+    }
+    case 'B':
+      if (!has_current_) {
+        current_ = Command();
+        has_current_ = true;
+      }
+      current_.input = start_;
+      return;
+    case 'C': {
+      if (!has_current_) {
+        current_ = Command();
+        has_current_ = true;
+      }
+      current_.output = start_;
+      current_.start_time = time;
+      current_.cwd = cwd_;
+      Event event;
+      event.type = Event::kCommandStart;
+      event.offset = start_;
+      event.command = current_;
+      events->push_back(std::move(event));
+      return;
+    }
+    case 'D': {
+      if (!has_current_ || current_.output == kUnknown) {
+        // Nothing ran, like when the prompt was cancelled.
+        has_current_ = false;
+        return;
+      }
+      current_.end = start_;
+      current_.end_time = time;
+      if (!args.empty()) {
+        char* rest;
+        long code = strtol(args.c_str(), &rest, 10);
+        if (rest != args.c_str() && (*rest == '\0' || *rest == ';')) {
+          current_.has_exit_code = true;
+          current_.exit_code = static_cast<int>(code);
+        }
+      }
+      Event event;
+      event.type = Event::kCommandFinish;
+      event.offset = start_;
+      event.command = current_;
+      events->push_back(std::move(event));
+      commands_.push_back(std::move(current_));
+      while (commands_.size() > history_) {
+        commands_.pop_front();
+      }
+      has_current_ = false;
+      return;
+    }
+  }
+}
+
+Snapshot Tracker::GetSnapshot() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Snapshot snapshot;
+  snapshot.cwd = cwd_;
+  snapshot.commands.assign(commands_.begin(), commands_.end());
+  snapshot.has_current = has_current_;
+  if (has_current_) {
+    snapshot.current = current_;
+  }
+  return snapshot;
+}
+
+}  // namespace tracker
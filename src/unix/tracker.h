@@ -0,0 +1,116 @@
+/**
+ * Copyright (c) 2026, Microsoft Corporation (MIT License).
+ *
+ * tracker.h:
+ *   Follows the shell integration sequences in the output of a pty, OSC 133
+ *   for prompts and commands and OSC 7 for the working directory, keeping the
+ *   current directory and the most recent commands.
+ */
+
+#ifndef NODE_PTY_TRACKER_H_
+#define NODE_PTY_TRACKER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "scan.h"
+
+namespace tracker {
+
+// An offset or time that has not been seen.
+const uint64_t kUnknown = UINT64_MAX;
+
+// Offsets are of the ESC that starts the marker in the output, times are
+// uv_hrtime() when the marker was read.
+struct Command {
+  // OSC 133 A, B, C and D.
+  uint64_t prompt = kUnknown;
+  uint64_t input = kUnknown;
+  uint64_t output = kUnknown;
+  uint64_t end = kUnknown;
+  uint64_t start_time = kUnknown;
+  uint64_t end_time = kUnknown;
+  // The exit code D reported, if it did.
+  bool has_exit_code = false;
+  int exit_code = 0;
+  // The working directory when the command started.
+  std::string cwd;
+};
+
+struct Event {
+  enum Type {
+    kPrompt,
+    kCommandStart,
+    kCommandFinish,
+    kCwd,
+  };
+  Type type;
+  uint64_t offset;
+  // Everything known about the command so far, for all but kCwd.
+  Command command;
+  // For kCwd.
+  std::string cwd;
+};
+
+struct Snapshot {
+  std::string cwd;
+  // Oldest first.
+  std::vector<Command> commands;
+  // The prompt or command in progress, if any.
+  bool has_current = false;
+  Command current;
+};
+
+// Fed on the reader thread and read on the JS thread.
+class Tracker {
+ public:
+  // Keeps the last history finished commands.
+  explicit Tracker(size_t history);
+
+  // Feeds the next length bytes of output, which start at offset and were
+  // read at time, appending what happened to *events. Sequences may be split
+  // across calls.
+  void Feed(const char* data, size_t length, uint64_t offset, uint64_t time,
+            std::vector<Event>* events);
+
+  Snapshot GetSnapshot() const;
+
+ private:
+  enum State {
+    kGround,
+    // After an ESC outside of an OSC.
+    kEscape,
+    kOsc,
+    // After an ESC inside of an OSC, which should be the start of ST.
+    kOscEscape,
+  };
+
+  void Dispatch(uint64_t time, std::vector<Event>* events);
+  void Mark(char marker, const std::string& args, uint64_t time,
+            std::vector<Event>* events);
+
+  mutable std::mutex mutex_;
+  const size_t history_;
+  State state_ = kGround;
+  // BEL and ESC, which end the payload of an OSC.
+  scan::ByteSet payload_ends_;
+  std::string payload_;
+  bool overflow_ = false;
+  // The offset of the ESC that started the current OSC, and of the ESC
+  // after it that should start its ST.
+  uint64_t start_ = 0;
+  uint64_t escape_ = 0;
+  std::string cwd_;
+  std::deque<Command> commands_;
+  bool has_current_ = false;
+  Command current_;
+};
+
+}  // namespace tracker
+
+#endif  // NODE_PTY_TRACKER_H_
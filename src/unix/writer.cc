@@ -0,0 +1,541 @@
+/**
+ * Copyright (c) 2026, Microsoft Corporation (MIT License).
+ *
+ * writer.cc:
+ *   A write that comes up short means the kernel buffer is full, so the rest
+ *   is queued without trying again until the master polls writable. Up to
+ *   kMaxIov queued buffers then go out in a single writev(2).
+ *
+ *   A paced writer checks the termios of the slave before each write. A
+ *   canonical slave is given whole lines, at most kMaxCanon bytes more than
+ *   its reader has yet to read, and is polled for with a timer that backs off
+ *   while the reader makes no room, as the master reports writable long
+ *   before then.
+ */
+
+#include "writer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+
+#include <algorithm>
+
+namespace writer {
+
+namespace {
+
+const int kMaxIov = 64;
+
+// Longer writes are never interrupts, so most writes skip tcgetattr(3).
+const size_t kMaxInterrupt = 4;
+
+// The most a canonical slave may hold. Linux drops what a line has past its
+// N_TTY_BUF_SIZE buffer, other kernels flush all input past MAX_CANON.
+#if defined(__linux__)
+const size_t kMaxCanon = 4095;
+#else
+const size_t kMaxCanon = MAX_CANON - 2;
+#endif
+
+const uint64_t kMinPaceMs = 1;
+const uint64_t kMaxPaceMs = 32;
+
+// Whether c makes the line before it readable on a canonical slave.
+bool EndsLine(const struct termios& t, char c) {
+  cc_t cc = static_cast<cc_t>(c);
+  if (cc == '\n') {
+    return true;
+  }
+  if (cc == '\r') {
+    return (t.c_iflag & ICRNL) && !(t.c_iflag & IGNCR);
+  }
+  return cc != _POSIX_VDISABLE &&
+         (cc == t.c_cc[VEOF] || cc == t.c_cc[VEOL] || cc == t.c_cc[VEOL2]);
+}
+
+// The offset just past the last line end in the first length bytes of iov,
+// or 0.
+size_t LastLineEnd(const struct termios& t, const struct iovec* iov,
+                   size_t length) {
+  size_t end = 0;
+  size_t offset = 0;
+  for (int i = 0; offset < length; i++) {
+    const char* data = static_cast<const char*>(iov[i].iov_base);
+    size_t size = std::min(iov[i].iov_len, length - offset);
+    for (size_t j = 0; j < size; j++) {
+      if (EndsLine(t, data[j])) {
+        end = offset + j + 1;
+      }
+    }
+    offset += size;
+  }
+  return end;
+}
+
+}  // namespace
+
+Writer::Writer(uv_loop_t* loop, int fd, const std::string& slave,
+               bool discard_on_interrupt, bool paced, Callback cb)
+    : loop_(loop),
+      source_fd_(fd),
+      slave_(slave),
+      discard_on_interrupt_(discard_on_interrupt),
+      paced_(paced),
+      cb_(std::move(cb)) {}
+
+Writer::~Writer() {
+  Close();
+}
+
+bool Writer::Open(std::string* err) {
+  fd_ = fcntl(source_fd_, F_DUPFD_CLOEXEC, 0);
+  if (fd_ == -1) {
+    *err = std::string("dup(2) failed: ") + strerror(errno);
+    return false;
+  }
+  poll_ = new uv_poll_t;
+  int r = uv_poll_init(loop_, poll_, fd_);
+  if (r != 0) {
+    delete poll_;
+    poll_ = nullptr;
+    close(fd_);
+    fd_ = -1;
+    *err = std::string("uv_poll_init() failed: ") + uv_strerror(r);
+    return false;
+  }
+  poll_->data = this;
+  if (paced_) {
+    timer_ = new uv_timer_t;
+    uv_timer_init(loop_, timer_);
+    timer_->data = this;
+  }
+  return true;
+}
+
+size_t Writer::Write(const char* data, size_t length, const Pin& pin) {
+  if (fd_ == -1 || length == 0) {
+    return stats_.queue_bytes;
+  }
+  if (waiting()) {
+    bool flush;
+    if (length <= kMaxInterrupt && IsInterrupt(data, length, &flush)) {
+      Interrupt(data, length, flush);
+    } else {
+      Enqueue(data, length, pin);
+    }
+    return stats_.queue_bytes;
+  }
+  struct termios t;
+  size_t pending;
+  if (paced_ && IsCanonical(&t, &pending)) {
+    // Lent to FlushLines() rather than kept, as all of it usually goes out
+    // right away.
+    queue_.push_back({ data, length, nullptr });
+    stats_.queue++;
+    stats_.queue_bytes += length;
+    FlushLines(t, pending);
+    if (!queue_.empty() && !queue_.front().owner) {
+      Keep(&queue_.front(), pin);
+    }
+    return stats_.queue_bytes;
+  }
+  line_ = 0;
+  size_t written = 0;
+  while (written < length) {
+    ssize_t n = write(fd_, data + written, length - written);
+    stats_.writes++;
+    if (n == -1 && errno == EINTR) {
+      continue;
+    }
+    if (n == -1 && errno != EAGAIN && errno != EWOULDBLOCK) {
+      Fail(errno);
+      return stats_.queue_bytes;
+    }
+    if (n > 0) {
+      written += n;
+      stats_.bytes += n;
+    }
+    if (written < length) {
+      stats_.retries++;
+      break;
+    }
+  }
+  if (written < length) {
+    Enqueue(data + written, length - written, pin);
+    Park();
+  }
+  return stats_.queue_bytes;
+}
+
+void Writer::Enqueue(const char* data, size_t length, const Pin& pin) {
+  queue_.push_back({ data, length, nullptr });
+  stats_.queue++;
+  stats_.queue_bytes += length;
+  Keep(&queue_.back(), pin);
+}
+
+// Makes what is left of chunk, the front one when offset_ applies, outlive
+// the write that passed it.
+void Writer::Keep(Chunk* chunk, const Pin& pin) {
+  if (pin) {
+    chunk->owner = pin();
+    return;
+  }
+  size_t skip = chunk == &queue_.front() ? offset_ : 0;
+  auto copy = std::make_shared<std::string>(chunk->data + skip,
+                                            chunk->size - skip);
+  chunk->data = copy->data();
+  chunk->size = copy->size();
+  chunk->owner = std::move(copy);
+  if (skip != 0) {
+    offset_ = 0;
+  }
+}
+
+// The slave is opened for its termios as Linux keeps separate ones for the
+// master, and closed right away as the master only reports EIO once no slave
+// fd is left.
+int Writer::OpenSlave() const {
+  return open(slave_.c_str(), O_RDONLY | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+}
+
+// Whether data is only signal characters of the slave, setting *flush if the
+// line discipline flushes its input on them.
+bool Writer::IsInterrupt(const char* data, size_t length, bool* flush) {
+  struct termios t;
+  int slave = OpenSlave();
+  int r = tcgetattr(slave != -1 ? slave : fd_, &t);
+  if (slave != -1) {
+    close(slave);
+  }
+  if (r == -1 || !(t.c_lflag & ISIG)) {
+    return false;
+  }
+  *flush = !(t.c_lflag & NOFLSH);
+  const cc_t signals[] = { t.c_cc[VINTR], t.c_cc[VQUIT], t.c_cc[VSUSP] };
+  for (size_t i = 0; i < length; i++) {
+    cc_t c = static_cast<cc_t>(data[i]);
+    if (c == _POSIX_VDISABLE ||
+        (c != signals[0] && c != signals[1] && c != signals[2])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Writes data ahead of the queue. Waiting goes on either way, Flush() writes
+// what is left and reports the drain.
+void Writer::Interrupt(const char* data, size_t length, bool flush) {
+  if (discard_on_interrupt_) {
+    queue_.clear();
+    offset_ = 0;
+    stats_.queue = 0;
+    stats_.queue_bytes = 0;
+    if (flush) {
+      // Both what the line discipline has yet to take and what it took but
+      // the slave has yet to read.
+      int slave = OpenSlave();
+      if (slave != -1) {
+        tcflush(slave, TCIFLUSH);
+        close(slave);
+      }
+      line_ = 0;
+    }
+  }
+  urgent_.append(data, length);
+  WriteUrgent();
+}
+
+// Writes as much of urgent_ as the kernel takes. Returns false if some is
+// left, or the write failed and Fail() reported it.
+bool Writer::WriteUrgent() {
+  while (!urgent_.empty()) {
+    ssize_t n = write(fd_, urgent_.data(), urgent_.size());
+    stats_.writes++;
+    if (n == -1 && errno == EINTR) {
+      continue;
+    }
+    if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      stats_.retries++;
+      return false;
+    }
+    if (n == -1) {
+      Fail(errno);
+      return false;
+    }
+    stats_.bytes += n;
+    urgent_.erase(0, n);
+  }
+  return true;
+}
+
+// Whether the slave is canonical, setting *t to its termios and *pending to
+// the bytes of the lines its reader has yet to read.
+bool Writer::IsCanonical(struct termios* t, size_t* pending) const {
+  int slave = OpenSlave();
+  if (slave == -1) {
+    return false;
+  }
+  int n = 0;
+  bool canonical = tcgetattr(slave, t) == 0 && (t->c_lflag & ICANON) &&
+                   ioctl(slave, FIONREAD, &n) == 0;
+  close(slave);
+  *pending = n;
+  return canonical;
+}
+
+// Waits for the master to become writable, Flush() stops waiting once the
+// queue is empty.
+void Writer::Park() {
+  if (polling_) {
+    return;
+  }
+  if (pacing_) {
+    uv_timer_stop(timer_);
+    pacing_ = false;
+  } else {
+    parked_since_ = uv_hrtime();
+  }
+  polling_ = true;
+  uv_poll_start(poll_, UV_WRITABLE, [](uv_poll_t* handle, int status, int) {
+    Writer* writer = static_cast<Writer*>(handle->data);
+    if (status < 0) {
+      writer->Fail(-status);
+      return;
+    }
+    writer->Flush();
+  });
+}
+
+// Waits for the reader of a canonical slave to make room, twice as long as
+// the last time if it made none since.
+void Writer::Pace() {
+  if (polling_) {
+    uv_poll_stop(poll_);
+    polling_ = false;
+  } else if (!pacing_) {
+    parked_since_ = uv_hrtime();
+  }
+  pacing_ = true;
+  pace_ms_ = pace_ms_ == 0 ? kMinPaceMs : std::min(pace_ms_ * 2, kMaxPaceMs);
+  uv_timer_start(timer_, [](uv_timer_t* handle) {
+    static_cast<Writer*>(handle->data)->Flush();
+  }, pace_ms_, 0);
+}
+
+void Writer::Stop() {
+  if (!waiting()) {
+    return;
+  }
+  if (polling_) {
+    uv_poll_stop(poll_);
+    polling_ = false;
+  }
+  if (pacing_) {
+    uv_timer_stop(timer_);
+    pacing_ = false;
+  }
+  stats_.backpressured += uv_hrtime() - parked_since_;
+}
+
+void Writer::Flush() {
+  if (!WriteUrgent()) {
+    if (waiting()) {
+      Park();
+    }
+    return;
+  }
+  struct termios t;
+  size_t pending;
+  if (paced_ && IsCanonical(&t, &pending)) {
+    if (!FlushLines(t, pending)) {
+      return;
+    }
+  } else {
+    line_ = 0;
+  }
+  while (!queue_.empty()) {
+    struct iovec iov[kMaxIov];
+    int count = 0;
+    size_t total = 0;
+    for (auto it = queue_.begin(); it != queue_.end() && count < kMaxIov;
+         ++it, ++count) {
+      size_t skip = count == 0 ? offset_ : 0;
+      iov[count].iov_base = const_cast<char*>(it->data + skip);
+      iov[count].iov_len = it->size - skip;
+      total += iov[count].iov_len;
+    }
+    ssize_t n = writev(fd_, iov, count);
+    stats_.writes++;
+    if (n == -1 && errno == EINTR) {
+      continue;
+    }
+    if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      stats_.retries++;
+      Park();
+      return;
+    }
+    if (n == -1) {
+      Fail(errno);
+      return;
+    }
+    stats_.bytes += n;
+    Consume(n);
+    if (static_cast<size_t>(n) < total) {
+      stats_.retries++;
+      Park();
+      return;
+    }
+  }
+  Stop();
+  // Last, the callback may write or close.
+  cb_(0);
+}
+
+// Writes the queue to a canonical slave a few lines at a time. Returns true
+// once it is empty, otherwise it waits, or failed.
+bool Writer::FlushLines(const struct termios& t, size_t pending) {
+  const cc_t eof = t.c_cc[VEOF];
+  // Without VEOF nothing can be done about long lines.
+  const bool split = eof != _POSIX_VDISABLE;
+  while (!queue_.empty()) {
+    size_t held = pending + (split ? line_ : 0);
+    size_t room = kMaxCanon - std::min(held, kMaxCanon);
+    struct iovec iov[kMaxIov + 1];
+    int count = 0;
+    size_t seen = 0;
+    for (auto it = queue_.begin();
+         it != queue_.end() && count < kMaxIov && seen < room; ++it, ++count) {
+      size_t skip = count == 0 ? offset_ : 0;
+      iov[count].iov_base = const_cast<char*>(it->data + skip);
+      iov[count].iov_len = std::min(it->size - skip, room - seen);
+      seen += iov[count].iov_len;
+    }
+    size_t length = LastLineEnd(t, iov, seen);
+    bool end_line = false;
+    if (length == 0 && seen < room) {
+      // The rest of the queue, or all kMaxIov buffers, fit in the line.
+      length = seen;
+    } else if (length == 0 && pending == 0 && room > 0) {
+      // A line too long for the slave, the reader gets it in pieces.
+      length = split ? room - 1 : room;
+      end_line = split;
+    } else if (length == 0) {
+      Pace();
+      return false;
+    }
+
+    count = 0;
+    for (size_t offset = 0; offset < length; offset += iov[count++].iov_len) {
+      iov[count].iov_len = std::min(iov[count].iov_len, length - offset);
+    }
+    if (end_line) {
+      iov[count].iov_base = const_cast<cc_t*>(&eof);
+      iov[count].iov_len = 1;
+      count++;
+    }
+    ssize_t n = writev(fd_, iov, count);
+    stats_.writes++;
+    if (n == -1 && errno == EINTR) {
+      continue;
+    }
+    if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      stats_.retries++;
+      Park();
+      return false;
+    }
+    if (n == -1) {
+      Fail(errno);
+      return false;
+    }
+    stats_.bytes += n;
+    size_t written = std::min(static_cast<size_t>(n), length);
+    size_t lines = LastLineEnd(t, iov, written);
+    Consume(written);
+    if (static_cast<size_t>(n) > length) {
+      pending += line_ + written;
+      line_ = 0;
+    } else if (lines > 0) {
+      pending += line_ + lines;
+      line_ = written - lines;
+    } else {
+      line_ += written;
+    }
+    if (n > 0) {
+      pace_ms_ = 0;
+    }
+    if (static_cast<size_t>(n) < length + (end_line ? 1 : 0)) {
+      stats_.retries++;
+      Park();
+      return false;
+    }
+  }
+  return true;
+}
+
+void Writer::Consume(size_t written) {
+  while (written > 0) {
+    size_t left = queue_.front().size - offset_;
+    if (written < left) {
+      offset_ += written;
+      stats_.queue_bytes -= written;
+      return;
+    }
+    written -= left;
+    stats_.queue_bytes -= left;
+    stats_.queue--;
+    queue_.pop_front();
+    offset_ = 0;
+  }
+}
+
+void Writer::Fail(int error) {
+  urgent_.clear();
+  queue_.clear();
+  offset_ = 0;
+  stats_.queue = 0;
+  stats_.queue_bytes = 0;
+  Stop();
+  cb_(error);
+}
+
+Stats Writer::GetStats() const {
+  Stats stats = stats_;
+  if (waiting()) {
+    stats.backpressured += uv_hrtime() - parked_since_;
+  }
+  return stats;
+}
+
+void Writer::Close() {
+  if (fd_ == -1) {
+    return;
+  }
+  urgent_.clear();
+  queue_.clear();
+  offset_ = 0;
+  stats_.queue = 0;
+  stats_.queue_bytes = 0;
+  Stop();
+  // Libuv frees nothing of its own once the handles are closed.
+  uv_close(reinterpret_cast<uv_handle_t*>(poll_), [](uv_handle_t* handle) {
+    delete reinterpret_cast<uv_poll_t*>(handle);
+  });
+  poll_ = nullptr;
+  if (timer_) {
+    uv_close(reinterpret_cast<uv_handle_t*>(timer_), [](uv_handle_t* handle) {
+      delete reinterpret_cast<uv_timer_t*>(handle);
+    });
+    timer_ = nullptr;
+  }
+  close(fd_);
+  fd_ = -1;
+}
+
+}  // namespace writer
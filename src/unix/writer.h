@@ -0,0 +1,141 @@
+/**
+ * Copyright (c) 2026, Microsoft Corporation (MIT License).
+ *
+ * writer.h:
+ *   Writes input to a pty master from the JS thread, queueing what the kernel
+ *   buffer has no room for until the master is writable again.
+ */
+
+#ifndef NODE_PTY_WRITER_H_
+#define NODE_PTY_WRITER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <termios.h>
+#include <uv.h>
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace writer {
+
+// Only touched on the JS thread. Times are in nanoseconds.
+struct Stats {
+  // write(2) and writev(2) calls, including those that hit EAGAIN.
+  uint64_t writes = 0;
+  uint64_t bytes = 0;
+  // Calls that found the kernel buffer full, by hitting EAGAIN or writing
+  // less than asked.
+  uint64_t retries = 0;
+  // Time spent waiting for the master to become writable.
+  uint64_t backpressured = 0;
+  // Buffers and bytes queued right now.
+  size_t queue = 0;
+  size_t queue_bytes = 0;
+};
+
+// Writes are attempted right away. What the kernel does not take is copied to
+// a queue, which is flushed with writev(2) once a uv_poll_t reports the
+// master writable, rather than retrying on every tick of the event loop.
+//
+// A write of only signal characters, like ^C, while input is queued is an
+// interrupt and jumps the queue. With discard_on_interrupt the queue is
+// dropped as well, along with the input the kernel holds unless the slave has
+// NOFLSH set, which is what the line discipline itself does on a signal.
+//
+// When paced, input for a slave in canonical mode is written a few lines at a
+// time, so the line discipline never holds more than kMaxCanon bytes: a line
+// that outgrows its buffer is cut short. A longer line is ended with VEOF
+// instead, which hands what the reader got so far to read(2) without a
+// newline. Whether the slave is canonical is checked before each write, raw
+// mode input goes out as fast as without pacing.
+class Writer {
+ public:
+  // Called with 0 once the queue is empty again after a write had to be
+  // queued, or with the errno of a failed write, after which everything
+  // queued is dropped.
+  using Callback = std::function<void(int error)>;
+
+  // Returns something that keeps the data of a write valid for as long as it
+  // is held. Only called when some of the data is left once Write() returns.
+  using Pin = std::function<std::shared_ptr<void>()>;
+
+  // slave is the path of the slave, whose termios tell the signal
+  // characters and whether it is canonical.
+  Writer(uv_loop_t* loop, int fd, const std::string& slave,
+         bool discard_on_interrupt, bool paced, Callback cb);
+  ~Writer();
+
+  // Duplicates fd, as libuv allows only one poll handle per fd and the
+  // master may be read by a tty.ReadStream, and sets up polling. Returns
+  // false and sets *err on failure.
+  bool Open(std::string* err);
+
+  // Writes length bytes of data, queueing the rest. Returns the number of
+  // bytes queued afterwards. The rest is copied unless pin is set, in which
+  // case what it returns is held until the rest is written or dropped.
+  size_t Write(const char* data, size_t length, const Pin& pin = nullptr);
+
+  // Drops the queue and closes the fd, the poll handle is freed once libuv
+  // closed it. The callback is not called again.
+  void Close();
+
+  // The wait in progress, if any, is counted as well.
+  Stats GetStats() const;
+  size_t queued() const { return stats_.queue_bytes; }
+
+ private:
+  // Queued data, whose owner keeps it valid, or null while it is only lent
+  // by the write in progress.
+  struct Chunk {
+    const char* data;
+    size_t size;
+    std::shared_ptr<void> owner;
+  };
+
+  int OpenSlave() const;
+  bool IsInterrupt(const char* data, size_t length, bool* flush);
+  void Interrupt(const char* data, size_t length, bool flush);
+  bool WriteUrgent();
+  bool IsCanonical(struct termios* t, size_t* pending) const;
+  void Enqueue(const char* data, size_t length, const Pin& pin);
+  void Keep(Chunk* chunk, const Pin& pin);
+  void Flush();
+  bool FlushLines(const struct termios& t, size_t pending);
+  void Park();
+  void Pace();
+  void Stop();
+  void Fail(int error);
+  void Consume(size_t written);
+  bool waiting() const { return polling_ || pacing_; }
+
+  uv_loop_t* loop_;
+  int source_fd_;
+  const std::string slave_;
+  const bool discard_on_interrupt_;
+  const bool paced_;
+  int fd_ = -1;
+  uv_poll_t* poll_ = nullptr;
+  bool polling_ = false;
+  // Set while waiting for the reader of a canonical slave, which the master
+  // can't be polled for.
+  uv_timer_t* timer_ = nullptr;
+  bool pacing_ = false;
+  uint64_t pace_ms_ = 0;
+  // The length of the unfinished line last written to a canonical slave.
+  size_t line_ = 0;
+  uint64_t parked_since_ = 0;
+  Callback cb_;
+  // Interrupts the kernel had no room for, written before queue_.
+  std::string urgent_;
+  // The front chunk has been written up to offset_.
+  std::deque<Chunk> queue_;
+  size_t offset_ = 0;
+  Stats stats_;
+};
+
+}  // namespace writer
+
+#endif  // NODE_PTY_WRITER_H_
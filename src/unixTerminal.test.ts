@@ -8,10 +8,12 @@ import * as cp from 'child_process';
 import * as path from 'path';
 import * as tty from 'tty';
 import * as fs from 'fs';
-import { constants } from 'os';
+import { constants, tmpdir } from 'os';
 import { pollUntil } from './testUtils.test';
+import { configurePool, getIoStats, getPoolStats, getProcessInfo, getSpawnLatencyHistogram } from './index';
 import { pid } from 'process';
 import type { UnixTerminal as UnixTerminalType } from './unixTerminal';
+import type { IExitEvent } from './types';
 
 const FIXTURES_PATH = path.normalize(path.join(__dirname, '..', 'fixtures', 'utf8-character.txt'));
 
@@ -287,6 +289,39 @@ if (process.platform !== 'win32') {
             done();
           }, 1000);
         });
+        it('should start the child as a session leader controlled by the pty', (done) => {
+          const term = new UnixTerminal('/bin/sh', ['-c', 'cat /proc/$$/stat']);
+          let output = '';
+          term.onData(data => output += data);
+          term.onExit(() => {
+            // Fields following the command name: state ppid pgrp session tty_nr
+            const fields = output.slice(output.lastIndexOf(')') + 2).split(' ');
+            assert.strictEqual(fields[3], term.pid.toString());
+            assert.notStrictEqual(fields[4], '0');
+            done();
+          });
+        });
+        it('should wait for all children on a shared thread', async function(): Promise<void> {
+          this.timeout(10000);
+          const getThreadCount = (): number => {
+            const status = fs.readFileSync('/proc/self/status', 'utf8');
+            return parseInt(/^Threads:\s+(\d+)$/m.exec(status)![1]);
+          };
+          const waitForExit = (term: UnixTerminalType): Promise<number> => {
+            return new Promise<number>(resolve => term.onExit(e => resolve(e.exitCode)));
+          };
+
+          // The first spawn starts the reaper
+          await waitForExit(new UnixTerminal('/bin/sh', ['-c', 'exit 0']));
+          const initialCount = getThreadCount();
+          const exits: Array<Promise<number>> = [];
+          for (let i = 0; i < 20; i++) {
+            exits.push(waitForExit(new UnixTerminal('/bin/sh', ['-c', `sleep 0.5; exit ${i}`])));
+          }
+          assert.strictEqual(getThreadCount(), initialCount);
+          const codes = await Promise.all(exits);
+          assert.deepStrictEqual(codes, codes.map((_, i) => i));
+        });
       }
       if (process.platform === 'darwin') {
         it('should return the name of the process', (done) => {
@@ -460,5 +495,603 @@ if (process.platform !== 'win32') {
         });
       });
     });
+    describe('spawnAsync', () => {
+      it('should resolve to a running terminal', async () => {
+        const term = await UnixTerminal.spawnAsync('/bin/sh', ['-c', 'echo ready; exit 3']);
+        assert.ok(term.pid > 0);
+        let output = '';
+        term.onData(data => { output += data; });
+        const exitCode = await new Promise<number>(resolve => term.onExit(e => resolve(e.exitCode)));
+        assert.strictEqual(exitCode, 3);
+        assert.ok(output.includes('ready'), output);
+      });
+      it('should report the exit code of a child that exits immediately', async () => {
+        const term = await UnixTerminal.spawnAsync('/bin/sh', ['-c', 'exit 3']);
+        const exitCode = await new Promise<number>(resolve => term.onExit(e => resolve(e.exitCode)));
+        assert.strictEqual(exitCode, 3);
+      });
+      it('should allow many spawns in flight at once', async function(): Promise<void> {
+        this.timeout(10000);
+        const terms = await Promise.all(Array.from(Array(20), (_, i) => UnixTerminal.spawnAsync('/bin/sh', ['-c', `exit ${i}`])));
+        assert.strictEqual(new Set(terms.map(t => t.pid)).size, terms.length);
+        const codes = await Promise.all(terms.map(t => new Promise<number>(resolve => t.onExit(e => resolve(e.exitCode)))));
+        assert.deepStrictEqual(codes, codes.map((_, i) => i));
+      });
+      it('should reject invalid arguments', async () => {
+        await assert.rejects(UnixTerminal.spawnAsync('/bin/sh', 'echo'));
+      });
+    });
+    describe('spawnMany', () => {
+      it('should spawn every spec and route each exit to its terminal', async () => {
+        const results = UnixTerminal.spawnMany(Array.from(Array(10), (_, i) => ({ file: '/bin/sh', args: ['-c', `exit ${i}`] })));
+        const terms = results.map(t => {
+          assert.ok(t instanceof UnixTerminal);
+          return t as UnixTerminalType;
+        });
+        assert.strictEqual(new Set(terms.map(t => t.pid)).size, terms.length);
+        const codes = await Promise.all(terms.map(t => new Promise<number>(resolve => t.onExit(e => resolve(e.exitCode)))));
+        assert.deepStrictEqual(codes, codes.map((_, i) => i));
+      });
+      it('should report per-entry errors', async () => {
+        const results = UnixTerminal.spawnMany([
+          { file: '/bin/sh', args: 'exit 1' },
+          { file: '/bin/sh', args: ['-c', 'exit 2'] }
+        ]);
+        assert.ok(results[0] instanceof Error);
+        const term = results[1] as UnixTerminalType;
+        const exitCode = await new Promise<number>(resolve => term.onExit(e => resolve(e.exitCode)));
+        assert.strictEqual(exitCode, 2);
+      });
+    });
+    describe('configurePool', () => {
+      afterEach(() => configurePool({ size: 0 }));
+
+      it('should spawn from pooled pairs and refill the pool', async () => {
+        configurePool({ size: 2, lowWatermark: 2 });
+        await pollUntil(() => getPoolStats().available === 2, 2000, 10);
+        const before = getPoolStats();
+
+        const term = new UnixTerminal('/bin/sh', ['-c', 'stty size'], { cols: 100, rows: 30 });
+        let output = '';
+        term.onData(data => { output += data; });
+        await new Promise<void>(resolve => term.onExit(() => resolve()));
+        assert.strictEqual(output.trim(), '30 100');
+
+        const after = getPoolStats();
+        assert.strictEqual(after.hits, before.hits + 1);
+        assert.strictEqual(after.misses, before.misses);
+        await pollUntil(() => getPoolStats().available === 2, 2000, 10);
+      });
+      it('should close the pooled pairs when disabled', () => {
+        configurePool({ size: 2 });
+        configurePool({ size: 0 });
+        assert.strictEqual(getPoolStats().available, 0);
+        assert.strictEqual(getPoolStats().size, 0);
+      });
+    });
+    describe('useNativeReader', () => {
+      const readAll = (term: UnixTerminalType): Promise<string> => {
+        return new Promise<string>(resolve => {
+          let output = '';
+          term.onData(data => { output += data; });
+          term.onExit(() => resolve(output));
+        });
+      };
+
+      it('should read the output of the process', async () => {
+        const term = new UnixTerminal('/bin/sh', ['-c', 'echo foo; echo bar'], { useNativeReader: true });
+        assert.strictEqual(await readAll(term), 'foo\r\nbar\r\n');
+      });
+      it('should not lose output when the reader is throttled', async () => {
+        const size = 4 * 1024 * 1024;
+        const term = new UnixTerminal('/bin/sh', ['-c', `head -c ${size} /dev/zero | tr '\\0' a`], { useNativeReader: true });
+        assert.strictEqual((await readAll(term)).length, size);
+      });
+      it('should resume reading after a pause', async () => {
+        const term = new UnixTerminal('/bin/sh', ['-c', 'read line; echo "$line"'], { useNativeReader: true });
+        const output = readAll(term);
+        term.pause();
+        term.write('foo\n');
+        await new Promise<void>(resolve => setTimeout(resolve, 100));
+        term.resume();
+        assert.ok((await output).indexOf('foo\r\nfoo\r\n') !== -1);
+      });
+      it('should stop reading once destroyed', async () => {
+        const term = new UnixTerminal('/bin/sh', ['-c', 'sleep 10'], { useNativeReader: true });
+        const exited = new Promise<void>(resolve => term.onExit(() => resolve()));
+        term.destroy();
+        await exited;
+      });
+    });
+    describe('ackFlowControl', () => {
+      it('should stop reading until the output is acknowledged', async () => {
+        const term = new UnixTerminal('/bin/sh', ['-c', 'yes é'], { ackFlowControl: { highWatermark: 10000, lowWatermark: 1000 } });
+        let received = 0;
+        term.onData(data => { received += Buffer.byteLength(data); });
+        await new Promise<void>(resolve => setTimeout(resolve, 200));
+        // At most one more read than the high watermark.
+        assert.ok(received > 10000 && received <= 10000 + 65536);
+        const paused = received;
+        await new Promise<void>(resolve => setTimeout(resolve, 100));
+        assert.strictEqual(received, paused);
+        term.ack(received);
+        await new Promise<void>(resolve => setTimeout(resolve, 100));
+        assert.ok(received > paused);
+        term.kill();
+      });
+    });
+    describe('outputRing', () => {
+      const readRing = (term: UnixTerminalType, consume: (views: Buffer[]) => number): Promise<string> => {
+        return new Promise<string>(resolve => {
+          const ring = term.outputRing!;
+          let output = '';
+          const drain = (): void => {
+            const views = ring.peek();
+            const bytes = consume(views);
+            output += Buffer.concat(views).toString('utf8', 0, bytes);
+            ring.consume(bytes);
+          };
+          ring.onWrite(drain);
+          term.onExit(() => {
+            drain();
+            resolve(output);
+          });
+        });
+      };
+
+      it('should write the output of the process into the ring', async () => {
+        const term = new UnixTerminal('/bin/sh', ['-c', 'echo foo; echo bar'], { outputRing: 4096 });
+        assert.strictEqual(term.outputRing!.size, 4096);
+        assert.strictEqual(await readRing(term, views => views.reduce((n, v) => n + v.length, 0)), 'foo\r\nbar\r\n');
+      });
+      it('should wait for the consumer when the ring is full', async () => {
+        const size = 1024 * 1024;
+        const term = new UnixTerminal('/bin/sh', ['-c', `head -c ${size} /dev/zero | tr '\\0' a`], { outputRing: 4096 });
+        // Consume a little at a time so the ring keeps filling up and wrapping around.
+        const output = await readRing(term, views => Math.min(1000, views.reduce((n, v) => n + v.length, 0)));
+        assert.strictEqual(output.length + term.outputRing!.available, size);
+      });
+      it('should reject sizes that are not a power of two', () => {
+        assert.throws(() => new UnixTerminal('/bin/sh', [], { outputRing: 1000 }));
+      });
+    });
+    describe('scrollback', () => {
+      const exited = (term: UnixTerminalType): Promise<void> => new Promise<void>(resolve => term.onExit(() => resolve()));
+
+      it('should replay the output from a sequence number', async () => {
+        const term = new UnixTerminal('/bin/sh', ['-c', 'echo foo; echo bar'], { scrollback: { limit: 1024 } });
+        let output = '';
+        term.onData(data => { output += data; });
+        await exited(term);
+        assert.strictEqual(term.outputSequence, 10);
+        assert.deepStrictEqual(term.replayFrom(0), { seq: 0, truncated: false, data: output });
+        assert.deepStrictEqual(term.replayFrom(5), { seq: 5, truncated: false, data: 'bar\r\n' });
+        assert.deepStrictEqual(term.replayFrom(10), { seq: 10, truncated: false, data: '' });
+      });
+      it('should not replay output that is still paused', async () => {
+        const term = new UnixTerminal('/bin/sh', ['-c', 'echo foo; echo bar'], { scrollback: { limit: 1024 } });
+        let output = '';
+        term.onData(data => { output += data; });
+        term.pause();
+        // The output is read while paused, but the exit waits for it to be
+        // consumed.
+        await new Promise<void>(resolve => setTimeout(resolve, 300));
+        assert.strictEqual(output, '');
+        assert.strictEqual(term.outputSequence, 0);
+        assert.deepStrictEqual(term.replayFrom(0), { seq: 0, truncated: false, data: '' });
+        term.resume();
+        await exited(term);
+        assert.strictEqual(output, 'foo\r\nbar\r\n');
+        assert.strictEqual(term.outputSequence, 10);
+        assert.strictEqual(term.replayFrom(0).data, output);
+      });
+      it('should only keep the most recent output', async () => {
+        const term = new UnixTerminal('/bin/sh', ['-c', `head -c 100000 /dev/zero | tr '\\0' a; printf b`], { scrollback: { limit: 1000 } });
+        term.onData(() => {});
+        await exited(term);
+        const replay = term.replayFrom(0);
+        assert.strictEqual(replay.truncated, true);
+        assert.strictEqual(replay.seq, term.outputSequence - 1000);
+        assert.strictEqual(replay.data.length, 1000);
+        assert.strictEqual(replay.data[999], 'b');
+      });
+      it('should spill to segment files and read ranges', async () => {
+        const dir = fs.mkdtempSync(path.join(tmpdir(), 'node-pty-test-'));
+        try {
+          const term = new UnixTerminal('/bin/sh', ['-c', 'i=0; while [ $i -lt 2000 ]; do echo "line $i"; i=$((i+1)); done'], {
+            scrollback: { limit: 16384, spill: { directory: dir, segmentSize: 4096 } }
+          });
+          let output = '';
+          term.onData(data => { output += data; });
+          await exited(term);
+          assert.strictEqual(term.outputSequence, output.length);
+          // Only whole segments are dropped.
+          const replay = term.replayFrom(0);
+          assert.strictEqual(replay.truncated, true);
+          assert.ok(replay.data.length > 16384 - 4096 && replay.data.length <= 16384);
+          assert.strictEqual(replay.data, output.slice(replay.seq));
+          const seq = term.outputSequence - 100;
+          assert.strictEqual(term.replayFrom(seq, seq + 10).data, output.slice(seq, seq + 10));
+          // The segments are unlinked right away.
+          assert.deepStrictEqual(fs.readdirSync(dir), []);
+        } finally {
+          fs.rmdirSync(dir);
+        }
+      });
+      it('should report when a segment could not be created', async () => {
+        const dir = fs.mkdtempSync(path.join(tmpdir(), 'node-pty-test-'));
+        const term = new UnixTerminal('/bin/sh', ['-c', 'sleep 0.1; head -c 10000 /dev/zero'], {
+          scrollback: { limit: 16384, spill: { directory: dir, segmentSize: 4096 } }
+        });
+        // The first segment is already created and unlinked.
+        fs.rmdirSync(dir);
+        term.onData(() => {});
+        await exited(term);
+        const replay = term.replayFrom(0);
+        assert.strictEqual(replay.data, '');
+        assert.ok(/^mkstemp/.test(replay.error!), replay.error);
+      });
+      it('should throw without the option', () => {
+        const term = new UnixTerminal('/bin/sh', ['-c', 'true']);
+        assert.throws(() => term.replayFrom(0));
+        term.kill();
+      });
+    });
+    describe('recording', () => {
+      it('should record output, input and resizes as asciicast', async () => {
+        const dir = fs.mkdtempSync(path.join(tmpdir(), 'node-pty-test-'));
+        const file = path.join(dir, 'session.cast');
+        try {
+          const term = new UnixTerminal('/bin/sh', ['-c', 'read line; echo "got $line"'], { useNativeReader: true, cols: 50, rows: 20 });
+          term.startRecording(file, { title: 'test' });
+          term.resize(60, 25);
+          term.write('hi\r');
+          await new Promise<void>(resolve => term.onExit(() => resolve()));
+          // Written by the background thread once the pty closed.
+          const read = (): any[] => fs.readFileSync(file, 'utf8').split('\n').filter(line => line).map(line => JSON.parse(line));
+          await pollUntil(() => read().some(e => e[1] === 'o' && e[2].indexOf('got hi') !== -1), 2000, 20);
+          const [header, ...events] = read();
+          assert.strictEqual(header.version, 2);
+          assert.strictEqual(header.width, 50);
+          assert.strictEqual(header.height, 20);
+          assert.strictEqual(header.title, 'test');
+          assert.deepStrictEqual(events.filter(e => e[1] !== 'o').map(e => [e[1], e[2]]), [['r', '60x25'], ['i', 'hi\r']]);
+          for (let i = 1; i < events.length; i++) {
+            assert.ok(events[i][0] >= events[i - 1][0]);
+          }
+        } finally {
+          if (fs.existsSync(file)) {
+            fs.unlinkSync(file);
+          }
+          fs.rmdirSync(dir);
+        }
+      });
+      it('should throw without the native reader', () => {
+        const term = new UnixTerminal('/bin/sh', ['-c', 'true']);
+        assert.throws(() => term.startRecording(path.join(tmpdir(), 'unused.cast')));
+        term.kill();
+      });
+    });
+    describe('shellIntegration', () => {
+      it('should track the cwd and commands', async () => {
+        const script = `printf '\\033]7;file://host/tmp/a%%20b\\007\\033]133;A\\007$ \\033]133;B\\007'; sleep 0.1; printf '\\033]133;C\\007out\\n\\033]133;D;3\\033\\\\\\033]133;A\\007$ '`;
+        const term = new UnixTerminal('/bin/sh', ['-c', script], { shellIntegration: { history: 10 } });
+        const events: string[] = [];
+        term.onShellIntegration(e => events.push(e.type));
+        term.onData(() => {});
+        await new Promise<void>(resolve => term.onExit(() => resolve()));
+        await pollUntil(() => events.length === 5, 1000, 10);
+        assert.deepStrictEqual(events, ['cwd', 'prompt', 'commandStart', 'commandFinish', 'prompt']);
+        const state = term.getShellIntegration()!;
+        assert.strictEqual(state.cwd, '/tmp/a b');
+        assert.strictEqual(state.commands.length, 1);
+        const command = state.commands[0];
+        assert.strictEqual(command.exitCode, 3);
+        assert.strictEqual(command.cwd, '/tmp/a b');
+        assert.ok(command.promptOffset! < command.inputOffset! && command.inputOffset! < command.outputOffset! && command.outputOffset! < command.endOffset!);
+        assert.ok(command.duration! >= 0);
+        assert.strictEqual(state.current!.endOffset, undefined);
+      });
+      it('should be undefined without the option', () => {
+        const term = new UnixTerminal('/bin/sh', ['-c', 'true']);
+        assert.strictEqual(term.getShellIntegration(), undefined);
+        term.kill();
+      });
+    });
+    describe('boundarySafeChunks', () => {
+      it('should not split escape sequences or code points', async () => {
+        const script = `printf 'a\\033[3'; sleep 0.02; printf '1m\\303'; sleep 0.02; printf '\\246\\033]0;ti'; sleep 0.02; printf 'tle\\007b'`;
+        const term = new UnixTerminal('/bin/sh', ['-c', script], { boundarySafeChunks: true, encoding: null });
+        const chunks: Buffer[] = [];
+        term.onData(data => chunks.push(data as unknown as Buffer));
+        await new Promise<void>(resolve => term.onExit(() => resolve()));
+        await pollUntil(() => Buffer.concat(chunks).toString() === 'a\x1b[31mæ\x1b]0;title\x07b', 1000, 10);
+        for (const chunk of chunks) {
+          const text = chunk.toString('latin1');
+          assert.ok(!/\x1b(\[[0-9;]*|\][^\x07]*)?$/.test(text), JSON.stringify(text));
+          assert.ok(!/[\xc0-\xff]$/.test(text), JSON.stringify(text));
+        }
+      });
+      it('should not split a string between the two bytes of its ST', async () => {
+        const script = `printf 'a\\033]0;title\\033'; sleep 0.02; printf '\\\\b'`;
+        const term = new UnixTerminal('/bin/sh', ['-c', script], { boundarySafeChunks: true, encoding: null });
+        const chunks: Buffer[] = [];
+        term.onData(data => chunks.push(data as unknown as Buffer));
+        await new Promise<void>(resolve => term.onExit(() => resolve()));
+        await pollUntil(() => Buffer.concat(chunks).toString() === 'a\x1b]0;title\x1b\\b', 1000, 10);
+        for (const chunk of chunks) {
+          const text = chunk.toString('latin1');
+          assert.ok(!/\x1b\][^\x07\x1b]*\x1b?$/.test(text), JSON.stringify(text));
+        }
+      });
+      it('should give up on a sequence whose rest does not arrive', async () => {
+        const term = new UnixTerminal('/bin/sh', ['-c', `printf 'a\\033['; sleep 0.5`], { boundarySafeChunks: true });
+        let output = '';
+        term.onData(data => { output += data; });
+        await pollUntil(() => output === 'a\x1b[', 400, 10);
+        term.kill();
+      });
+    });
+    describe('plainText', () => {
+      it('should strip escape sequences and normalize line endings', async () => {
+        const script = `printf '\\033[1;31mred\\033[0m\\033]0;title\\007 \\303'; sleep 0.02; printf '\\246\\r\\nnext\\r\\r\\n\\ttab\\010\\n'`;
+        const term = new UnixTerminal('/bin/sh', ['-c', script], { plainText: true });
+        let output = '';
+        let plain = '';
+        term.onData(data => { output += data; });
+        term.onPlainText(text => { plain += text; });
+        await new Promise<void>(resolve => term.onExit(() => resolve()));
+        await pollUntil(() => plain === 'red æ\nnext\n\ttab\n', 1000, 10);
+        assert.ok(output.startsWith('\x1b[1;31mred'));
+      });
+    });
+    describe('write', () => {
+      it('should queue input the child is slow to read and fire onDrain once written', async function(): Promise<void> {
+        this.timeout(10000);
+        const size = 256 * 1024;
+        const term = new UnixTerminal('/bin/sh', ['-c', `stty raw -echo; echo ready; sleep 0.2; head -c ${size} | wc -c`]);
+        let output = '';
+        let drains = 0;
+        term.onData(data => { output += data; });
+        term.onDrain(() => drains++);
+        await pollUntil(() => output.includes('ready'), 2000, 10);
+        for (let i = 0; i < 64; i++) {
+          term.write('x'.repeat(size / 64));
+        }
+        const queued = term.getStats()!;
+        assert.ok(queued.writeQueueBytes > 0 && queued.writeQueueBytes < size);
+        await pollUntil(() => output.includes(`${size}`), 5000, 10);
+        assert.strictEqual(drains, 1);
+        const stats = term.getStats()!;
+        assert.strictEqual(stats.bytesWritten, size);
+        assert.strictEqual(stats.writeQueueBytes, 0);
+        // Queued writes are coalesced, and only retried once the pty is writable.
+        assert.ok(stats.writes < 64 + stats.writeRetries);
+        assert.ok(stats.backpressuredTime >= 50);
+        term.kill();
+      });
+      it('should return false once writeHighWaterMark bytes are queued', async function(): Promise<void> {
+        this.timeout(10000);
+        const size = 256 * 1024;
+        const term = new UnixTerminal('/bin/sh', ['-c', `stty raw -echo; echo ready; sleep 0.2; head -c ${size} | tr -cd y | wc -c`], { writeHighWaterMark: 64 * 1024 });
+        let output = '';
+        term.onData(data => { output += data; });
+        await pollUntil(() => output.includes('ready'), 2000, 10);
+        const chunk = Buffer.alloc(32 * 1024, 'y');
+        const results: boolean[] = [];
+        for (let written = 0; written < size; written += chunk.length) {
+          results.push(term.write(chunk));
+        }
+        // The same Buffer is queued up to 8 times, the kernel takes far less
+        // than the rest.
+        assert.strictEqual(results[0], true);
+        assert.strictEqual(results[results.length - 1], false);
+        assert.strictEqual(results.indexOf(true, results.indexOf(false)), -1);
+        await new Promise<void>(resolve => term.onDrain(() => resolve()));
+        assert.strictEqual(term.write('y'), true);
+        await pollUntil(() => output.includes(`${size}`), 5000, 10);
+        term.kill();
+      });
+      it('should hand long lines to a canonical reader whole with pacedInput', async function(): Promise<void> {
+        this.timeout(10000);
+        // Each line is longer than the line buffer of the kernel.
+        const line = 'a'.repeat(10000) + '\n';
+        const size = line.length * 3;
+        const term = new UnixTerminal('/bin/sh', ['-c', `stty -echo; echo ready; head -c ${size} | tr -cd a | wc -c`], { pacedInput: true });
+        let output = '';
+        term.onData(data => { output += data; });
+        await pollUntil(() => output.includes('ready'), 2000, 10);
+        term.write(line.repeat(3));
+        await pollUntil(() => output.includes('30000'), 5000, 10);
+        assert.strictEqual(term.getStats()!.writeQueueBytes, 0);
+        term.kill();
+      });
+      it('should reject a negative writeHighWaterMark', () => {
+        assert.throws(() => new UnixTerminal('/bin/sh', [], { writeHighWaterMark: -1 }), /writeHighWaterMark/);
+      });
+      it('should write ^C ahead of queued input', async function(): Promise<void> {
+        this.timeout(10000);
+        // Reads 4096 bytes every 10ms, it would take seconds to get to the ^C.
+        const term = new UnixTerminal('/bin/sh', ['-c', 'trap "echo INT" INT; stty -icanon -echo; echo ready; while :; do head -c 4096 >/dev/null; sleep 0.01; done']);
+        let output = '';
+        term.onData(data => { output += data; });
+        await pollUntil(() => output.includes('ready'), 2000, 10);
+        for (let i = 0; i < 64; i++) {
+          term.write('x'.repeat(64 * 1024));
+        }
+        const start = Date.now();
+        term.write('\x03');
+        await pollUntil(() => output.includes('INT'), 2000, 5);
+        const latency = Date.now() - start;
+        assert.ok(latency < 1000, `took ${latency}ms`);
+        assert.ok(term.getStats()!.writeQueueBytes > 0);
+        term.destroy();
+      });
+      it('should drop queued input on ^C with discardInputOnInterrupt', async function(): Promise<void> {
+        this.timeout(10000);
+        // Never reads, the kernel buffer is full before the ^C.
+        const term = new UnixTerminal('/bin/sh', ['-c', 'trap "echo INT; exit 0" INT; stty -echo; echo ready; sleep 10'], { discardInputOnInterrupt: true });
+        let output = '';
+        term.onData(data => { output += data; });
+        await pollUntil(() => output.includes('ready'), 2000, 10);
+        const line = 'x'.repeat(79) + '\n';
+        for (let i = 0; i < 128; i++) {
+          term.write(line.repeat(800));
+        }
+        assert.ok(term.getStats()!.writeQueueBytes > 0);
+        const start = Date.now();
+        term.write('\x03');
+        assert.strictEqual(term.getStats()!.writeQueueBytes, 0);
+        await pollUntil(() => output.includes('INT'), 2000, 5);
+        const latency = Date.now() - start;
+        assert.ok(latency < 1000, `took ${latency}ms`);
+        await new Promise<void>(resolve => term.onExit(() => resolve()));
+      });
+    });
+    describe('getStats', () => {
+      for (const useNativeReader of [false, true]) {
+        it(`should count the I/O of the pty (useNativeReader: ${useNativeReader})`, async () => {
+          const term = new UnixTerminal('/bin/sh', ['-c', 'read line; printf "<%s>" "$line"'], { useNativeReader, encoding: null });
+          let bytes = 0;
+          term.onData(data => { bytes += data.length; });
+          const before = getIoStats().total.bytesWritten;
+          assert.ok(getIoStats().terminals.some(t => t.pid === term.pid));
+          term.write('hello\n');
+          await new Promise<void>(resolve => term.onExit(() => resolve()));
+          await pollUntil(() => bytes >= 7 && getIoStats().terminals.every(t => t.pid !== term.pid), 1000, 10);
+          const stats = term.getStats()!;
+          assert.strictEqual(stats.bytesWritten, 6);
+          assert.strictEqual(stats.writeQueue, 0);
+          assert.strictEqual(stats.writeQueueBytes, 0);
+          assert.ok(stats.writes >= 1);
+          assert.strictEqual(stats.bytesRead, bytes);
+          assert.ok(stats.reads >= 1);
+          assert.strictEqual(stats.readSizes.reduce((a, b) => a + b, 0), stats.reads);
+          assert.strictEqual(stats.readSizes.length, stats.readSizeBounds.length);
+          assert.ok(getIoStats().total.bytesWritten >= before + 6);
+        });
+      }
+    });
+    describe('getProcessInfo', () => {
+      it('should describe the foreground process of each terminal', async () => {
+        const cwd = fs.realpathSync(tmpdir());
+        const sleep = new UnixTerminal('/bin/sleep', ['5'], { cwd });
+        const shell = new UnixTerminal('/bin/sh', ['-c', 'sleep 5; true']);
+        const closed = new UnixTerminal('/bin/sh', ['-c', 'sleep 5']);
+        closed.destroy();
+        const terminals = [sleep, shell, closed];
+        let infos = await getProcessInfo(terminals);
+        // Until they exec'd.
+        for (let i = 0; i < 100 && !(infos[0]?.name === 'sleep' && infos[1]?.name === 'sh'); i++) {
+          await new Promise(r => setTimeout(r, 20));
+          infos = await getProcessInfo(terminals);
+        }
+        assert.deepStrictEqual(infos[0], { pid: sleep.pid, name: 'sleep', argv: ['/bin/sleep', '5'], cwd });
+        // Without job control the shell stays the leader of the foreground
+        // process group.
+        assert.strictEqual(infos[1]!.pid, shell.pid);
+        assert.deepStrictEqual(infos[1]!.argv, ['/bin/sh', '-c', 'sleep 5; true']);
+        assert.strictEqual(infos[2], undefined);
+        sleep.kill();
+        shell.kill();
+      });
+    });
+    describe('waitFor', () => {
+      it('should resolve with the pattern that ends first and its offset', async () => {
+        const term = new UnixTerminal('/bin/sh', ['-c', 'printf "foo "; sleep 0.1; printf "ba"; sleep 0.1; printf "r baz"; sleep 1'], { useNativeReader: true });
+        term.onData(() => {});
+        // "bar" is split across chunks.
+        assert.deepStrictEqual(await term.waitFor(['baz', Buffer.from('bar')], 2000), { index: 1, offset: 4 });
+        term.kill();
+      });
+      it('should reject on timeout and when the pty closes', async () => {
+        const term = new UnixTerminal('/bin/sh', ['-c', 'echo foo; sleep 0.5'], { useNativeReader: true });
+        term.onData(() => {});
+        await assert.rejects(term.waitFor('nope', 100), /timed out/);
+        await assert.rejects(term.waitFor('nope'), /closed/);
+      });
+      it('should reject without the native reader', async () => {
+        const term = new UnixTerminal('/bin/sh', ['-c', 'true']);
+        await assert.rejects(term.waitFor('foo'));
+        term.kill();
+      });
+    });
+    describe('onExit', () => {
+      it('should report the resource usage of the process', async () => {
+        const term = new UnixTerminal('/bin/sh', ['-c', 'i=0; while [ $i -lt 20000 ]; do i=$((i+1)); done']);
+        const e = await new Promise<IExitEvent>(resolve => term.onExit(resolve));
+        assert.strictEqual(e.exitCode, 0);
+        const usage = e.resourceUsage!;
+        assert.ok(usage.userTime + usage.systemTime > 0);
+        assert.ok(usage.maxRss > 0);
+        assert.ok(usage.voluntaryContextSwitches + usage.involuntaryContextSwitches >= 0);
+        assert.ok(usage.lifetime > 0);
+      });
+      it('should report the resource usage of a process that exits immediately', async () => {
+        const term = await UnixTerminal.spawnAsync('/bin/sh', ['-c', 'exit 3']);
+        const e = await new Promise<IExitEvent>(resolve => term.onExit(resolve));
+        assert.strictEqual(e.exitCode, 3);
+        assert.ok(e.resourceUsage);
+        assert.ok(e.resourceUsage.maxRss > 0);
+      });
+    });
+    describe('spawnTimings', () => {
+      it('should time each phase once the process has written output', async () => {
+        const before = getSpawnLatencyHistogram().phases.firstOutput?.count || 0;
+        const term = new UnixTerminal('/bin/echo', ['hello']);
+        assert.strictEqual(term.spawnTimings, undefined);
+        await new Promise<void>(resolve => term.onData(() => resolve()));
+        const timings = term.spawnTimings!;
+        assert.ok(timings.marshal >= 0);
+        assert.ok(timings.openpty >= 0);
+        assert.ok(timings.spawn >= 0);
+        assert.ok(timings.firstOutput! >= timings.marshal + timings.openpty);
+        if (process.platform === 'linux' || process.platform === 'darwin') {
+          for (const phase of ['helper', 'ctty', 'chdir', 'setuid', 'closeFds', 'exec'] as const) {
+            assert.ok(timings[phase]! >= 0, phase);
+          }
+        }
+        assert.strictEqual(getSpawnLatencyHistogram().phases.firstOutput!.count, before + 1);
+        await new Promise<void>(resolve => term.onExit(() => resolve()));
+      });
+      it('should time a process that exits without output', async () => {
+        const term = new UnixTerminal('/bin/sh', ['-c', 'exit 0']);
+        await new Promise<void>(resolve => term.onExit(() => resolve()));
+        assert.notStrictEqual(term.spawnTimings, undefined);
+        assert.strictEqual(term.spawnTimings!.firstOutput, undefined);
+      });
+    });
+    describe('createSpawnTemplate', () => {
+      const readAll = (term: UnixTerminalType): Promise<string> => {
+        return new Promise<string>(resolve => {
+          let output = '';
+          term.onData(data => { output += data; });
+          term.onExit(() => resolve(output));
+        });
+      };
+
+      it('should apply per-session overrides on top of the template', async () => {
+        const template = UnixTerminal.createSpawnTemplate('sh', ['-c'], {
+          env: { PATH: process.env.PATH, FOO: 'template', BAR: 'shared' }
+        });
+        const outputs = await Promise.all([
+          readAll(template.spawn(['echo "$FOO $BAR $PWD"'])),
+          readAll(template.spawn(['echo "$FOO $BAR $PWD"'], { cwd: '/', env: { FOO: 'session' } }))
+        ]);
+        assert.strictEqual(outputs[0].trim(), `template shared ${process.cwd()}`);
+        assert.strictEqual(outputs[1].trim(), 'session shared /');
+      });
+      it('should apply the size overrides', async () => {
+        const template = UnixTerminal.createSpawnTemplate('/bin/sh', ['-c', 'stty size'], { cols: 80, rows: 24 });
+        const term = await template.spawnAsync([], { cols: 100, rows: 30 });
+        assert.strictEqual((await readAll(term)).trim(), '30 100');
+      });
+      it('should search a PATH override again', async () => {
+        const template = UnixTerminal.createSpawnTemplate('sh', ['-c', 'exit 5'], { env: { PATH: '/usr/bin:/bin' } });
+        const term = template.spawn([], { env: { PATH: '/nonexistent' } });
+        const exitCode = await new Promise<number>(resolve => term.onExit(e => resolve(e.exitCode)));
+        assert.strictEqual(exitCode, 1);
+      });
+    });
   });
 }
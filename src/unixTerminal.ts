@@ -7,10 +7,17 @@ import * as fs from 'fs';
 import * as net from 'net';
 import * as path from 'path';
 import * as tty from 'tty';
+import { StringDecoder } from 'string_decoder';
+import { getSystemErrorName } from 'util';
 import { Terminal, DEFAULT_COLS, DEFAULT_ROWS } from './terminal';
-import { IProcessEnv, IPtyForkOptions, IPtyOpenOptions } from './interfaces';
-import { ArgvOrCommandLine, IDisposable } from './types';
+import { IProcessEnv, IPtyForkOptions, IPtyIoStats, IPtyOpenOptions, IProcessInfo, IRecordingOptions, IScrollbackOptions, ISpawnManySpec, ISpawnTemplate, ISpawnTemplateOptions, IShellIntegrationState, IWaitForMatch } from './interfaces';
+import { ArgvOrCommandLine, IDisposable, IResourceUsage } from './types';
 import { assign, loadNativeModule } from './utils';
+import { computeSpawnTimings, hrtimeNs, spawnLatencyHistogram } from './spawnTimings';
+import { NativeReadStream } from './nativeReadStream';
+import { IWriteStats, SocketReadStats, createIoStats, ioStatsRegistry } from './ioStats';
+import { OutputRing, checkRingSize } from './outputRing';
+import { Scrollback } from './scrollback';
 
 const native = loadNativeModule('pty');
 const pty: IUnixNative = native.module;
@@ -22,21 +29,62 @@ helperPath = helperPath.replace('node_modules.asar', 'node_modules.asar.unpacked
 const DEFAULT_FILE = 'sh';
 const DEFAULT_NAME = 'xterm';
 const DESTROY_SOCKET_TIMEOUT_MS = 200;
+const DEFAULT_SCROLLBACK_SEGMENT_SIZE = 64 * 1024 * 1024;
+const DEFAULT_SHELL_HISTORY = 100;
+const DEFAULT_WRITE_HIGH_WATER_MARK = 16 * 1024;
+
+/**
+ * Internal, starts the process of a `UnixTerminal` in place of `pty.fork`.
+ */
+type UnixForkHook = (terminal: UnixTerminal, onexit: UnixExitCallback) => void;
+
+type UnixExitCallback = (code: number, signal: number, usage: IResourceUsage | undefined) => void;
+
+/**
+ * The arguments of `pty.fork` derived from the spawn options.
+ */
+interface IUnixForkSpec {
+  file: string;
+  args: string[];
+  env: string[];
+  cwd: string;
+  uid: number;
+  gid: number;
+  name: string;
+  encoding: string | null;
+  useNativeReader: boolean;
+  outputRing: number | undefined;
+  scrollback: IScrollbackOptions | undefined;
+  shellHistory: number | undefined;
+  boundarySafeChunks: boolean;
+  plainText: boolean;
+  discardInputOnInterrupt: boolean;
+  writeHighWaterMark: number;
+  pacedInput: boolean;
+}
 
 export class UnixTerminal extends Terminal {
-  protected _fd: number;
-  protected _pty: string;
+  protected _fd!: number;
+  protected _pty!: string;
 
-  protected _file: string;
-  protected _name: string;
+  protected _file!: string;
+  protected _name!: string;
 
-  protected _readable: boolean;
-  protected _writable: boolean;
+  protected _readable!: boolean;
+  protected _writable!: boolean;
 
   private _boundClose: boolean = false;
   private _emittedClose: boolean = false;
 
-  private _writeStream: CustomWriteStream;
+  private _writeStream!: CustomWriteStream;
+  private _socketReadStats: SocketReadStats | undefined;
+
+  private _spawnTimestamps: number[] | undefined;
+
+  private _shellTracker: IUnixShellTracker | undefined;
+
+  private _recording: IUnixRecording | undefined;
+  private _timingFd: number = -1;
 
   private _master: net.Socket | undefined;
   private _slave: net.Socket | undefined;
@@ -44,38 +92,23 @@ export class UnixTerminal extends Terminal {
   public get master(): net.Socket | undefined { return this._master; }
   public get slave(): net.Socket | undefined { return this._slave; }
 
-  constructor(file?: string, args?: ArgvOrCommandLine, opt?: IPtyForkOptions) {
+  /**
+   * @param fork Internal, replaces forking `file` with `args` and `opt.env`.
+   * It must call `_setupFork` once the process exists, which may happen
+   * asynchronously, see `spawnAsync` and `createSpawnTemplate`.
+   */
+  constructor(file?: string, args?: ArgvOrCommandLine, opt?: IPtyForkOptions, fork?: UnixForkHook) {
     super(opt);
 
     if (typeof args === 'string') {
       throw new Error('args as a string is not supported on unix.');
     }
 
-    // Initialize arguments
-    args = args || [];
-    file = file || DEFAULT_FILE;
     opt = opt || {};
-    opt.env = opt.env || process.env;
-
     this._cols = opt.cols || DEFAULT_COLS;
     this._rows = opt.rows || DEFAULT_ROWS;
-    const uid = opt.uid ?? -1;
-    const gid = opt.gid ?? -1;
-    const env: IProcessEnv = assign({}, opt.env);
-
-    if (opt.env === process.env) {
-      this._sanitizeEnv(env);
-    }
-
-    const cwd = opt.cwd || process.cwd();
-    env.PWD = cwd;
-    const name = opt.name || env.TERM || DEFAULT_NAME;
-    env.TERM = name;
-    const parsedEnv = this._parseEnv(env);
-
-    const encoding = (opt.encoding === undefined ? 'utf8' : opt.encoding);
 
-    const onexit = (code: number, signal: number): void => {
+    const onexit = (code: number, signal: number, usage: IResourceUsage | undefined): void => {
       // XXX Sometimes a data event is emitted after exit. Wait til socket is
       // destroyed.
       if (!this._emittedClose) {
@@ -95,21 +128,248 @@ export class UnixTerminal extends Terminal {
           if (timeout !== null) {
             clearTimeout(timeout);
           }
-          this.emit('exit', code, signal);
+          this.emit('exit', code, signal, usage);
         });
         return;
       }
-      this.emit('exit', code, signal);
+      this.emit('exit', code, signal, usage);
     };
 
+    if (fork) {
+      fork(this, onexit);
+      return;
+    }
+
     // fork
-    const term = pty.fork(file, args, parsedEnv, cwd, this._cols, this._rows, uid, gid, (encoding === 'utf8'), helperPath, onexit);
+    const spec = UnixTerminal._prepareFork(file, args, opt);
+    const term = pty.fork(spec.file, spec.args, spec.env, spec.cwd, this._cols, this._rows, spec.uid, spec.gid, (spec.encoding === 'utf8'), helperPath, onexit);
+    this._setupFork(term, spec);
+  }
+
+  /**
+   * Forks a process as a pseudoterminal without blocking the event loop. The
+   * pty is opened and the process started on the libuv threadpool.
+   */
+  public static spawnAsync(file?: string, args?: ArgvOrCommandLine, opt?: IPtyForkOptions): Promise<UnixTerminal> {
+    return new Promise<UnixTerminal>((resolve, reject) => {
+      new UnixTerminal(file, args, opt, (terminal, onexit) => {
+        const spec = UnixTerminal._prepareFork(file, args as string[] | undefined, opt || {});
+        pty.forkAsync(spec.file, spec.args, spec.env, spec.cwd, terminal._cols, terminal._rows, spec.uid, spec.gid, (spec.encoding === 'utf8'), helperPath, onexit).then(term => {
+          terminal._setupFork(term, spec);
+          resolve(terminal);
+        }, reject);
+      });
+    });
+  }
+
+  /**
+   * Describes the foreground process of each terminal with a single native
+   * call, which reads them on the libuv threadpool.
+   */
+  public static getProcessInfo(terminals: UnixTerminal[]): Promise<Array<IProcessInfo | undefined>> {
+    return pty.getProcessInfo(terminals.map(t => t._readable ? t._fd : -1)).then(infos => infos.map(info => {
+      // Seen on macOS while the process is still being exec'd.
+      if (info && (info.name === 'kernel_task' || info.name === 'spawn_helper')) {
+        return undefined;
+      }
+      return info;
+    }));
+  }
+
+  /**
+   * Forks a batch of processes with a single native call that also registers
+   * all of them for exit notifications at once. Each entry of the result is
+   * either the terminal of that spec or the error that prevented it from
+   * starting.
+   */
+  public static spawnMany(specs: ISpawnManySpec[]): Array<UnixTerminal | Error> {
+    const pending: Array<{ index: number, terminal: UnixTerminal, spec: IUnixForkSpec, onexit: UnixExitCallback }> = [];
+    const results = specs.map((s, index): UnixTerminal | Error => {
+      try {
+        return new UnixTerminal(s.file, s.args, s.options, (terminal, onexit) => {
+          const spec = UnixTerminal._prepareFork(s.file, s.args as string[] | undefined, s.options || {});
+          pending.push({ index, terminal, spec, onexit });
+        });
+      } catch (e) {
+        return e as Error;
+      }
+    });
+
+    const exits: { [pid: number]: UnixExitCallback } = {};
+    const forked = pty.forkMany(pending.map(p => {
+      return [p.spec.file, p.spec.args, p.spec.env, p.spec.cwd, p.terminal._cols, p.terminal._rows, p.spec.uid, p.spec.gid, (p.spec.encoding === 'utf8'), helperPath] as UnixForkManySpec;
+    }), (pid, code, signal, usage) => {
+      const onexit = exits[pid];
+      delete exits[pid];
+      onexit(code, signal, usage);
+    });
+    forked.forEach((term, i) => {
+      const p = pending[i];
+      if ('error' in term) {
+        results[p.index] = new Error(term.error);
+        return;
+      }
+      exits[term.pid] = p.onexit;
+      p.terminal._setupFork(term, p.spec);
+    });
+    return results;
+  }
+
+  /**
+   * Resolves the environment, working directory and executable for `file`,
+   * `args` and `opt` once. Sessions spawned from the template only pass their
+   * overrides to the native side, which reuses everything else.
+   */
+  public static createSpawnTemplate(file?: string, args?: ArgvOrCommandLine, opt?: IPtyForkOptions): ISpawnTemplate<UnixTerminal> {
+    if (typeof args === 'string') {
+      throw new Error('args as a string is not supported on unix.');
+    }
+    const templateOpt = opt || {};
+    const spec = UnixTerminal._prepareFork(file, args, templateOpt);
+    const template = new pty.SpawnTemplate(spec.file, spec.args, spec.env, spec.cwd, templateOpt.cols || DEFAULT_COLS, templateOpt.rows || DEFAULT_ROWS, spec.uid, spec.gid, (spec.encoding === 'utf8'), helperPath);
+
+    const sessionOpt = (overrides: ISpawnTemplateOptions): IPtyForkOptions => {
+      const result: IPtyForkOptions = assign({}, templateOpt);
+      if (overrides.cols) {
+        result.cols = overrides.cols;
+      }
+      if (overrides.rows) {
+        result.rows = overrides.rows;
+      }
+      if (overrides.cwd) {
+        result.cwd = overrides.cwd;
+      }
+      return result;
+    };
+    const sessionEnv = (overrides: ISpawnTemplateOptions): string[] => {
+      const env: IProcessEnv = assign({}, overrides.env || {});
+      if (overrides.cwd) {
+        env.PWD = overrides.cwd;
+      }
+      return UnixTerminal._parseEnv(env);
+    };
+
+    return {
+      spawn: (sessionArgs?: string[], overrides: ISpawnTemplateOptions = {}): UnixTerminal => {
+        return new UnixTerminal(spec.file, undefined, sessionOpt(overrides), (terminal, onexit) => {
+          const term = template.fork(sessionArgs || [], sessionEnv(overrides), overrides.cwd || '', terminal._cols, terminal._rows, onexit);
+          terminal._setupFork(term, spec);
+        });
+      },
+      spawnAsync: (sessionArgs?: string[], overrides: ISpawnTemplateOptions = {}): Promise<UnixTerminal> => {
+        return new Promise<UnixTerminal>((resolve, reject) => {
+          new UnixTerminal(spec.file, undefined, sessionOpt(overrides), (terminal, onexit) => {
+            template.forkAsync(sessionArgs || [], sessionEnv(overrides), overrides.cwd || '', terminal._cols, terminal._rows, onexit).then(term => {
+              terminal._setupFork(term, spec);
+              resolve(terminal);
+            }, reject);
+          });
+        });
+      }
+    };
+  }
+
+  private static _prepareFork(file: string | undefined, args: string[] | undefined, opt: IPtyForkOptions): IUnixForkSpec {
+    const optEnv = opt.env || process.env;
+    const env: IProcessEnv = assign({}, optEnv);
+
+    if (optEnv === process.env) {
+      UnixTerminal._sanitizeEnv(env);
+    }
+
+    if (opt.outputRing !== undefined) {
+      checkRingSize(opt.outputRing);
+    }
+    if (opt.boundarySafeChunks && opt.outputRing !== undefined) {
+      throw new Error('boundarySafeChunks is not supported with outputRing.');
+    }
+    if (opt.scrollback && !(opt.scrollback.limit >= 1)) {
+      throw new Error('scrollback.limit must be at least 1.');
+    }
+    const shellHistory = opt.shellIntegration ? opt.shellIntegration.history ?? DEFAULT_SHELL_HISTORY : undefined;
+    if (shellHistory !== undefined && !(shellHistory >= 0)) {
+      throw new Error('shellIntegration.history must not be negative.');
+    }
+    const writeHighWaterMark = opt.writeHighWaterMark ?? DEFAULT_WRITE_HIGH_WATER_MARK;
+    if (!(writeHighWaterMark >= 0)) {
+      throw new Error('writeHighWaterMark must not be negative.');
+    }
+    if (opt.scrollback?.spill) {
+      // Fail before the process is started, the segments are created after.
+      fs.accessSync(opt.scrollback.spill.directory, fs.constants.W_OK);
+    }
+
+    const cwd = opt.cwd || process.cwd();
+    env.PWD = cwd;
+    const name = opt.name || env.TERM || DEFAULT_NAME;
+    env.TERM = name;
+
+    return {
+      file: file || DEFAULT_FILE,
+      args: args || [],
+      env: UnixTerminal._parseEnv(env),
+      cwd,
+      uid: opt.uid ?? -1,
+      gid: opt.gid ?? -1,
+      name,
+      encoding: (opt.encoding === undefined ? 'utf8' : opt.encoding),
+      useNativeReader: !!opt.useNativeReader || opt.outputRing !== undefined || !!opt.scrollback || !!opt.shellIntegration || !!opt.boundarySafeChunks || !!opt.plainText,
+      outputRing: opt.outputRing,
+      scrollback: opt.scrollback,
+      shellHistory,
+      boundarySafeChunks: !!opt.boundarySafeChunks,
+      plainText: !!opt.plainText,
+      discardInputOnInterrupt: !!opt.discardInputOnInterrupt,
+      writeHighWaterMark,
+      pacedInput: !!opt.pacedInput
+    };
+  }
 
-    this._socket = new tty.ReadStream(term.fd);
+  private static _createScrollback(opt: IScrollbackOptions): IUnixScrollback {
+    if (!opt.spill) {
+      return new pty.Scrollback(opt.limit);
+    }
+    const segmentSize = Math.min(opt.spill.segmentSize || DEFAULT_SCROLLBACK_SEGMENT_SIZE, opt.limit);
+    return new pty.Scrollback(opt.limit, opt.spill.directory, segmentSize);
+  }
+
+  private _setupFork(term: IUnixProcess, spec: IUnixForkSpec): void {
+    const encoding = spec.encoding;
+    if (spec.useNativeReader) {
+      const ring = spec.outputRing !== undefined ? new OutputRing(spec.outputRing) : undefined;
+      const log = spec.scrollback ? UnixTerminal._createScrollback(spec.scrollback) : undefined;
+      const tracker = spec.shellHistory !== undefined ? new pty.ShellTracker(spec.shellHistory) : undefined;
+      // The stripper passes UTF-8 through as is, which may be split across
+      // chunks.
+      const decoder = spec.plainText ? new StringDecoder('utf8') : undefined;
+      const plain = decoder ? (data: Buffer) => {
+        const text = decoder.write(data);
+        if (text) {
+          this._onPlainText.fire(text);
+        }
+      } : undefined;
+      const stream = new NativeReadStream(pty, term.fd, { ring, scrollback: log, tracker, holdPartial: spec.boundarySafeChunks, plain });
+      this._outputRing = ring;
+      this._shellTracker = tracker;
+      if (tracker) {
+        stream.on('shellEvent', (e: IUnixShellEvent) => this._onShellIntegration.fire(e));
+      }
+      if (log) {
+        // A ring hands the output over as soon as it is written, the stream
+        // once it is fired by onData.
+        const sequence = ring ? () => stream.bytesRead : () => this._firedSequence;
+        this._scrollback = new Scrollback(log, sequence, encoding as BufferEncoding | null);
+      }
+      // HACK: Only the parts of net.Socket that Terminal uses are implemented.
+      this._socket = stream as unknown as net.Socket;
+    } else {
+      this._socket = new tty.ReadStream(term.fd);
+      this._socketReadStats = new SocketReadStats(this._socket);
+    }
     if (encoding !== null) {
       this._socket.setEncoding(encoding);
     }
-    this._writeStream = new CustomWriteStream(term.fd, (encoding || undefined) as BufferEncoding);
+    this._writeStream = new CustomWriteStream(term.fd, term.pty, spec, (encoding || undefined) as BufferEncoding, () => this._onDrain.fire());
 
     // setup
     this._socket.on('error', (err: any) => {
@@ -147,14 +407,31 @@ export class UnixTerminal extends Terminal {
     this._pid = term.pid;
     this._fd = term.fd;
     this._pty = term.pty;
+    ioStatsRegistry.add(this);
+
+    this._spawnTimestamps = term.timestamps;
+    this._timingFd = term.timingFd;
+    if (this._outputRing) {
+      const listener = this._outputRing.onWrite(() => {
+        listener.dispose();
+        this._finishSpawnTimings(hrtimeNs());
+      });
+    } else {
+      this._socket.once('data', () => this._finishSpawnTimings(hrtimeNs()));
+    }
 
-    this._file = file;
-    this._name = name;
+    this._file = spec.file;
+    this._name = spec.name;
 
     this._readable = true;
     this._writable = true;
 
     this._socket.on('close', () => {
+      this._finishSpawnTimings();
+      this.stopRecording();
+      ioStatsRegistry.retire(this);
+      // Nothing reads the input anymore, and the writer holds a dup of the fd.
+      this._writeStream.dispose();
       if (this._emittedClose) {
         return;
       }
@@ -166,8 +443,130 @@ export class UnixTerminal extends Terminal {
     this._forwardEvents();
   }
 
-  protected _write(data: string | Buffer): void {
-    this._writeStream.write(data);
+  /**
+   * Collects the phases spawn-helper reported, which are complete once the
+   * process produced output or went away, and records the spawn in the
+   * process-wide histogram.
+   */
+  private _finishSpawnTimings(firstOutput?: number): void {
+    if (!this._spawnTimestamps) {
+      return;
+    }
+    const helper = pty.readSpawnTimings(this._timingFd);
+    this._spawnTimings = computeSpawnTimings(this._spawnTimestamps, helper, firstOutput);
+    this._spawnTimestamps = undefined;
+    this._timingFd = -1;
+    spawnLatencyHistogram.record(this._spawnTimings);
+  }
+
+  protected _emittedSequence(): number | undefined {
+    return this._scrollback && this._socket instanceof NativeReadStream ? this._socket.bytesEmitted : undefined;
+  }
+
+  protected _write(data: string | Buffer): boolean {
+    return this._writeStream.write(data);
+  }
+
+  /**
+   * Output is queued to the recording by the native reader as it is read and
+   * input by the native writer as it is written, so both share one clock and
+   * cost nothing on the event loop. Resizes are queued here.
+   */
+  public startRecording(path: string, options?: IRecordingOptions): void {
+    if (!(this._socket instanceof NativeReadStream)) {
+      throw new Error('startRecording requires the useNativeReader option.');
+    }
+    this.stopRecording();
+    const recording = new pty.Recording(path, this._cols, this._rows, options?.title || '', this._name || '');
+    this._recording = recording;
+    this._socket.record(recording);
+    if (options?.input !== false) {
+      this._writeStream.record(recording);
+    }
+  }
+
+  public stopRecording(): void {
+    if (!this._recording) {
+      return;
+    }
+    if (this._socket instanceof NativeReadStream) {
+      this._socket.record(null);
+    }
+    this._writeStream.record(null);
+    this._recording.close();
+    this._recording = undefined;
+  }
+
+  /**
+   * Recognized by the native reader as the output is read, see tracker.h.
+   */
+  public getShellIntegration(): IShellIntegrationState | undefined {
+    return this._shellTracker?.snapshot();
+  }
+
+  /**
+   * The read counters come from the native reader, which keeps them with
+   * relaxed atomics, or from the events of the tty.ReadStream. The write
+   * counters are kept by the write stream on the JS thread.
+   */
+  public getStats(): IPtyIoStats | undefined {
+    if (!this._writeStream) {
+      // Not spawned yet, or opened with `open`.
+      return undefined;
+    }
+    const read = this._socket instanceof NativeReadStream ? this._socket.stats() : this._socketReadStats!.snapshot();
+    return createIoStats(read, this._writeStream.stats());
+  }
+
+  /**
+   * The output is matched as raw bytes by the native reader just before it is
+   * handed to JS, so it is never decoded for matching. Strings are matched as
+   * UTF-8.
+   */
+  public waitFor(patterns: string | Buffer | (string | Buffer)[], timeout?: number): Promise<IWaitForMatch> {
+    return new Promise<IWaitForMatch>((resolve, reject) => {
+      const socket = this._socket;
+      if (!(socket instanceof NativeReadStream)) {
+        throw new Error('waitFor requires the useNativeReader option.');
+      }
+      if (this._outputRing) {
+        throw new Error('waitFor is not supported with outputRing.');
+      }
+      const list = Array.isArray(patterns) ? patterns : [patterns];
+      const buffers = list.map(p => typeof p === 'string' ? Buffer.from(p, 'utf8') : p);
+      let timer: NodeJS.Timeout | undefined;
+      const settle = (): void => {
+        if (timer) {
+          clearTimeout(timer);
+        }
+        socket.removeListener('close', onClose);
+      };
+      const onClose = (): void => {
+        settle();
+        reject(new Error('waitFor: the pty closed before a pattern matched.'));
+      };
+      const wait = socket.waitFor(buffers, (index, offset) => {
+        settle();
+        resolve({ index, offset });
+      });
+      socket.once('close', onClose);
+      if (timeout !== undefined) {
+        timer = setTimeout(() => {
+          settle();
+          socket.cancelWait(wait);
+          reject(new Error(`waitFor timed out after ${timeout}ms.`));
+        }, timeout);
+      }
+    });
+  }
+
+  public end(data: string): void {
+    if (this._socket instanceof NativeReadStream) {
+      // The native reader is read-only, write through the terminal instead.
+      this._write(data);
+      return;
+    }
+    super.end(data);
   }
 
   /* Accessors */
@@ -234,6 +633,9 @@ export class UnixTerminal extends Terminal {
   }
 
   public destroy(): void {
+    this._finishSpawnTimings();
+    this.stopRecording();
+    ioStatsRegistry.retire(this);
     this._close();
 
     // Need to close the read stream so node stops reading a dead file
@@ -275,6 +677,7 @@ export class UnixTerminal extends Terminal {
     const pixelWidth = pixelSize?.width ?? 0;
     const pixelHeight = pixelSize?.height ?? 0;
     pty.resize(this._fd, cols, rows, pixelWidth, pixelHeight);
+    this._recording?.resize(cols, rows);
     this._cols = cols;
     this._rows = rows;
   }
@@ -283,7 +686,7 @@ export class UnixTerminal extends Terminal {
 
   }
 
-  private _sanitizeEnv(env: IProcessEnv): void {
+  private static _sanitizeEnv(env: IProcessEnv): void {
     // Make sure we didn't start our server from inside tmux.
     delete env['TMUX'];
     delete env['TMUX_PANE'];
@@ -301,90 +704,67 @@ export class UnixTerminal extends Terminal {
   }
 }
 
-interface IWriteTask {
-  /** The buffer being written. */
-  buffer: Buffer;
-  /** The current offset of not yet written data. */
-  offset: number;
-}
-
 /**
- * A custom write stream that writes directly to a file descriptor with proper
- * handling of backpressure and errors. This avoids some event loop exhaustion
- * issues that can occur when using the standard APIs in Node.
+ * Writes to the pty through the native writer, see writer.h. Input the kernel
+ * buffer has no room for is queued natively and flushed with writev(2) once
+ * the master polls writable, so a slow child neither spins the event loop
+ * with retries nor ties up the threadpool. Signal characters, as set in the
+ * termios of the slave, jump that queue. Nothing queued is copied, Buffers are
+ * referenced until written. With `pacedInput`, a slave in canonical mode is
+ * given its input a few lines at a time.
  */
 class CustomWriteStream implements IDisposable {
-
-  private readonly _writeQueue: IWriteTask[] = [];
-  private _writeImmediate: NodeJS.Immediate | undefined;
+  private readonly _writer: IUnixWriter;
+  private readonly _highWaterMark: number;
 
   constructor(
-    private readonly _fd: number,
-    private readonly _encoding: BufferEncoding
+    fd: number,
+    ptsName: string,
+    spec: IUnixForkSpec,
+    private readonly _encoding: BufferEncoding | undefined,
+    onDrain: () => void
   ) {
+    this._highWaterMark = spec.writeHighWaterMark;
+    this._writer = new pty.Writer(fd, ptsName, spec.discardInputOnInterrupt, spec.pacedInput, errno => {
+      if (errno === 0) {
+        onDrain();
+        return;
+      }
+      // Shaped like the errors of fs.write, the queue was dropped.
+      const code = getSystemErrorName(-errno);
+      const err: NodeJS.ErrnoException = new Error(`write ${code}`);
+      err.code = code;
+      err.errno = -errno;
+      err.syscall = 'write';
+      console.error('Unhandled pty write error', err);
+    });
   }
 
   dispose(): void {
-    clearImmediate(this._writeImmediate);
-    this._writeImmediate = undefined;
+    this._writer.close();
   }
 
-  write(data: string | Buffer): void {
-    // Writes are put in a queue and processed asynchronously in order to handle
-    // backpressure from the kernel buffer.
-    const buffer = typeof data === 'string'
-      ? Buffer.from(data, this._encoding)
-      : Buffer.from(data);
-
-    if (buffer.byteLength !== 0) {
-      this._writeQueue.push({ buffer, offset: 0 });
-      if (this._writeQueue.length === 1) {
-        this._processWriteQueue();
-      }
-    }
+  /**
+   * Starts or, given null, stops queueing the input to a recording as it is
+   * written.
+   */
+  record(recording: IUnixRecording | null): void {
+    this._writer.record(recording);
   }
 
-  private _processWriteQueue(): void {
-    this._writeImmediate = undefined;
-
-    if (this._writeQueue.length === 0) {
-      return;
+  /**
+   * Returns false once the queue reached the high water mark, like
+   * `stream.Writable.write`.
+   */
+  write(data: string | Buffer): boolean {
+    // Strings are converted natively when they are UTF-8.
+    if (typeof data === 'string' && this._encoding && this._encoding !== 'utf8') {
+      data = Buffer.from(data, this._encoding);
     }
+    return this._writer.write(data) < this._highWaterMark;
+  }
 
-    const task = this._writeQueue[0];
-
-    // Write to the underlying file descriptor and handle it directly, rather
-    // than using the `net.Socket`/`tty.WriteStream` wrappers which swallow and
-    // mask errors like EAGAIN and can cause the thread to block indefinitely.
-    fs.write(this._fd, task.buffer, task.offset, (err, written) => {
-      if (err) {
-        if ('code' in err && err.code === 'EAGAIN') {
-          // `setImmediate` is used to yield to the event loop and re-attempt
-          // the write later.
-          this._writeImmediate = setImmediate(() => this._processWriteQueue());
-        } else {
-          // Stop processing immediately on unexpected error and log
-          this._writeQueue.length = 0;
-          console.error('Unhandled pty write error', err);
-        }
-        return;
-      }
-
-      task.offset += written;
-      if (task.offset >= task.buffer.byteLength) {
-        this._writeQueue.shift();
-      }
-
-      // Since there is more room in the kernel buffer, we can continue to write
-      // until we hit EAGAIN or exhaust the queue.
-      //
-      // Note that old versions of bash, like v3.2 which ships in macOS, appears
-      // to have a bug in its readline implementation that causes data
-      // corruption when writes to the pty happens too quickly. Instead of
-      // trying to workaround that we just accept it so that large pastes are as
-      // fast as possible.
-      // Context: https://github.com/microsoft/node-pty/issues/833
-      this._processWriteQueue();
-    });
+  public stats(): IWriteStats {
+    return this._writer.stats();
   }
 }
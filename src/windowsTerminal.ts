@@ -39,7 +39,7 @@ export class WindowsTerminal extends Terminal {
     this._rows = opt.rows || DEFAULT_ROWS;
     const cwd = opt.cwd || process.cwd();
     const name = opt.name || env.TERM || DEFAULT_NAME;
-    const parsedEnv = this._parseEnv(env);
+    const parsedEnv = WindowsTerminal._parseEnv(env);
 
     // If the terminal is ready
     this._isReady = false;
@@ -126,8 +126,9 @@ export class WindowsTerminal extends Terminal {
     this._forwardEvents();
   }
 
-  protected _write(data: string | Buffer): void {
+  protected _write(data: string | Buffer): boolean {
     this._defer(this._doWrite, data);
+    return true;
   }
 
   private _doWrite(data: string | Buffer): void {
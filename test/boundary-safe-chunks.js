@@ -0,0 +1,56 @@
+// This test measures the cost of boundarySafeChunks on output that is heavy on escape sequences
+// and multi-byte characters, like that of a colorized build or a TUI. It reports the throughput
+// with and without the option and how many chunks ended in the middle of a sequence.
+
+var pty = require('..');
+
+var BYTES = 64 * 1024 * 1024;
+
+// Prints lines of SGR colored text with cursor movement, an OSC title and non-ASCII characters.
+var PRINTER = `
+var line = '';
+for (var i = 0; i < 40; i++) {
+  line += '\\x1b[38;5;' + (i * 7 % 256) + 'm' + 'wörd→' + i + '\\x1b[0m ';
+}
+line += '\\x1b]0;title ✓\\x07\\x1b[2K\\x1b[1G\\r\\n';
+var chunk = line.repeat(64);
+var written = 0;
+function write() {
+  while (written < ${BYTES}) {
+    written += Buffer.byteLength(chunk);
+    if (!process.stdout.write(chunk)) {
+      process.stdout.once('drain', write);
+      return;
+    }
+  }
+}
+write();
+`;
+
+function incomplete(buffer) {
+  var text = buffer.toString('latin1');
+  return /\x1b(\[[0-9;]*|\][^\x07]*)?$/.test(text) || /[\xc0-\xff][\x80-\xbf]{0,2}$/.test(text);
+}
+
+function run(boundarySafeChunks) {
+  var bytes = 0;
+  var chunks = 0;
+  var split = 0;
+  var options = { name: 'xterm-256color', cols: 200, rows: 50, env: process.env, encoding: null, useNativeReader: true, boundarySafeChunks };
+  var term = pty.spawn(process.execPath, ['-e', PRINTER], options);
+  term.onData(data => {
+    bytes += data.length;
+    chunks++;
+    if (incomplete(data)) {
+      split++;
+    }
+  });
+  var start = process.hrtime.bigint();
+  return new Promise(resolve => term.onExit(resolve)).then(() => {
+    var ms = Number(process.hrtime.bigint() - start) / 1e6;
+    console.log(`boundarySafeChunks ${boundarySafeChunks}: ` +
+      `${(bytes / 1024 / 1024 / (ms / 1000)).toFixed(1)}MB/s, ${chunks} chunks, ${split} split a sequence`);
+  });
+}
+
+run(false).then(() => run(true));
@@ -0,0 +1,56 @@
+// This test pastes a large amount of input into a child that reads it slowly, like a shell that
+// is busy while the user pastes, and reports how long the paste took, how many write syscalls and
+// retries it needed and how busy the event loop was meanwhile. The input waits in the native
+// writer while the kernel buffer is full, so the event loop should stay close to idle.
+//
+// Pass --paced to turn on pacedInput, which should not slow down a child in raw mode like this one.
+
+var pty = require('..');
+var perf_hooks = require('perf_hooks');
+
+var BYTES = 16 * 1024 * 1024;
+var CHUNK = 4096;
+
+// Reads the input in small pieces with a pause in between.
+var READER = `
+process.stdin.setRawMode(true);
+var total = 0;
+process.stdin.on('data', data => {
+  total += data.length;
+  process.stdin.pause();
+  setTimeout(() => process.stdin.resume(), 1);
+  if (total >= ${BYTES}) {
+    process.stdout.write('done ' + total + '\\n');
+    process.exit(0);
+  }
+});
+process.stdout.write('ready\\n');
+`;
+
+var paced = process.argv.indexOf('--paced') !== -1;
+var term = pty.spawn(process.execPath, ['-e', READER], { name: 'xterm-256color', cols: 80, rows: 26, env: process.env, pacedInput: paced });
+var output = '';
+var started = false;
+var start;
+var elu;
+term.onData(data => {
+  output += data;
+  if (!started && output.includes('ready')) {
+    started = true;
+    start = process.hrtime.bigint();
+    elu = perf_hooks.performance.eventLoopUtilization();
+    var chunk = 'x'.repeat(CHUNK);
+    for (var i = 0; i < BYTES / CHUNK; i++) {
+      term.write(chunk);
+    }
+  }
+});
+term.onDrain(() => console.log('drained'));
+term.onExit(() => {
+  var ms = Number(process.hrtime.bigint() - start) / 1e6;
+  var stats = term.getStats();
+  elu = perf_hooks.performance.eventLoopUtilization(elu);
+  console.log(`${(BYTES / 1024 / 1024 / (ms / 1000)).toFixed(1)}MB/s, ${stats.writes} writes, ` +
+    `${stats.writeRetries} retries, ${stats.backpressuredTime.toFixed(0)}ms backpressured, ` +
+    `event loop utilization ${(elu.utilization * 100).toFixed(1)}%`);
+});
@@ -0,0 +1,48 @@
+// This test compares reading ptys through a tty.ReadStream per terminal with the shared native
+// reader (useNativeReader). It runs a number of mostly idle terminals that print a line every
+// 100ms, plus a few that print as fast as they can, and reports the throughput of the busy ones,
+// the event loop delay and the memory used. Running 1000 terminals needs more than the common
+// default of 1024 open files, raise it with `ulimit -n` first.
+
+var pty = require('..');
+var perf_hooks = require('perf_hooks');
+
+var IDLE = parseInt(process.argv[2] || '500', 10);
+var BUSY = 4;
+var BUSY_BYTES = 16 * 1024 * 1024;
+var DURATION_MS = 3000;
+
+function run(useNativeReader) {
+  var terms = [];
+  var busyBytes = 0;
+  var options = { name: 'xterm-256color', cols: 80, rows: 26, env: process.env, useNativeReader };
+  for (var i = 0; i < IDLE; i++) {
+    terms.push(pty.spawn('sh', ['-c', 'while true; do echo idle; sleep 0.1; done'], options));
+  }
+  var busy = [];
+  for (var i = 0; i < BUSY; i++) {
+    var term = pty.spawn('sh', ['-c', `head -c ${BUSY_BYTES} /dev/zero`], options);
+    term.onData(data => { busyBytes += data.length; });
+    busy.push(new Promise(resolve => term.onExit(resolve)));
+  }
+  terms.forEach(t => t.onData(() => {}));
+
+  var delay = perf_hooks.monitorEventLoopDelay({ resolution: 10 });
+  delay.enable();
+  var start = process.hrtime.bigint();
+  return Promise.all(busy).then(() => {
+    var busyMs = Number(process.hrtime.bigint() - start) / 1e6;
+    return new Promise(resolve => setTimeout(resolve, Math.max(0, DURATION_MS - busyMs))).then(() => {
+      delay.disable();
+      var mb = busyBytes / 1024 / 1024;
+      console.log(`${useNativeReader ? 'native reader' : 'tty.ReadStream'} x${IDLE}: ` +
+        `${(mb / (busyMs / 1000)).toFixed(1)}MB/s busy, ` +
+        `event loop delay p99 ${(delay.percentile(99) / 1e6).toFixed(1)}ms, ` +
+        `rss ${(process.memoryUsage().rss / 1024 / 1024).toFixed(0)}MB`);
+      terms.forEach(t => t.kill('SIGKILL'));
+      return Promise.all(terms.map(t => new Promise(resolve => t.onExit(resolve))));
+    });
+  });
+}
+
+run(false).then(() => run(true));
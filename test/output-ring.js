@@ -0,0 +1,48 @@
+// This test compares reading a pty that prints as fast as it can through a tty.ReadStream with
+// the native reader writing into a shared memory ring (outputRing). It reports the throughput and
+// the time spent in garbage collection while reading.
+
+var pty = require('..');
+var perf_hooks = require('perf_hooks');
+
+var BYTES = parseInt(process.argv[2] || '268435456', 10);
+var RING_SIZE = 1024 * 1024;
+
+function run(useRing) {
+  var gcMs = 0;
+  var gcCount = 0;
+  var obs = new perf_hooks.PerformanceObserver(list => {
+    list.getEntries().forEach(entry => {
+      gcMs += entry.duration;
+      gcCount++;
+    });
+  });
+  obs.observe({ entryTypes: ['gc'] });
+
+  var bytes = 0;
+  var options = { name: 'xterm-256color', cols: 80, rows: 26, env: process.env, encoding: null };
+  if (useRing) {
+    options.outputRing = RING_SIZE;
+  }
+  var start = process.hrtime.bigint();
+  var term = pty.spawn('sh', ['-c', `head -c ${BYTES} /dev/zero`], options);
+  if (useRing) {
+    var ring = term.outputRing;
+    ring.onWrite(() => {
+      bytes += ring.available;
+      ring.consume();
+    });
+  } else {
+    term.onData(data => { bytes += data.length; });
+  }
+  return new Promise(resolve => term.onExit(resolve)).then(() => {
+    var ms = Number(process.hrtime.bigint() - start) / 1e6;
+    obs.disconnect();
+    var mb = bytes / 1024 / 1024;
+    console.log(`${useRing ? 'output ring' : 'tty.ReadStream'}: ` +
+      `${(mb / (ms / 1000)).toFixed(1)}MB/s, ` +
+      `${gcCount} gc pauses taking ${gcMs.toFixed(1)}ms`);
+  });
+}
+
+run(false).then(() => run(true));
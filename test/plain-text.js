@@ -0,0 +1,55 @@
+// This test measures the cost of getting the output as plain text, comparing the native plainText
+// tap against stripping escape sequences from onData with a regular expression in JS, on colorized
+// output. It reports the throughput and the main thread time of each.
+
+var pty = require('..');
+
+var BYTES = 64 * 1024 * 1024;
+
+// Prints lines of SGR colored text with an OSC title and non-ASCII characters.
+var PRINTER = `
+var line = '';
+for (var i = 0; i < 40; i++) {
+  line += '\\x1b[38;5;' + (i * 7 % 256) + 'm' + 'wörd→' + i + '\\x1b[0m ';
+}
+line += '\\x1b]0;title ✓\\x07\\x1b[2K\\r\\n';
+var chunk = line.repeat(64);
+var written = 0;
+function write() {
+  while (written < ${BYTES}) {
+    written += Buffer.byteLength(chunk);
+    if (!process.stdout.write(chunk)) {
+      process.stdout.once('drain', write);
+      return;
+    }
+  }
+}
+write();
+`;
+
+var ANSI = /\x1b(?:\[[0-?]*[ -\/]*[@-~]|\][^\x07\x1b]*(?:\x07|\x1b\\)|[@-Z\\-_])|[\x00-\x08\x0b-\x1f\x7f]|\r\n?/g;
+
+function run(native) {
+  var bytes = 0;
+  var plain = 0;
+  var options = { name: 'xterm-256color', cols: 200, rows: 50, env: process.env, useNativeReader: true, plainText: native };
+  var term = pty.spawn(process.execPath, ['-e', PRINTER], options);
+  term.onData(data => {
+    bytes += Buffer.byteLength(data);
+    if (!native) {
+      plain += data.replace(ANSI, m => m[0] === '\r' ? '\n' : '').length;
+    }
+  });
+  term.onPlainText(text => { plain += text.length; });
+  var start = process.hrtime.bigint();
+  var cpu = process.cpuUsage();
+  return new Promise(resolve => term.onExit(resolve)).then(() => {
+    var ms = Number(process.hrtime.bigint() - start) / 1e6;
+    cpu = process.cpuUsage(cpu);
+    console.log(`${native ? 'native plainText' : 'JS regex'}: ` +
+      `${(bytes / 1024 / 1024 / (ms / 1000)).toFixed(1)}MB/s, ${plain} characters of text, ` +
+      `${((cpu.user + cpu.system) / 1000).toFixed(0)}ms CPU on the main thread`);
+  });
+}
+
+run(false).then(() => run(true));
@@ -0,0 +1,41 @@
+// This test measures how long polling the foreground process of many terminals blocks the main
+// thread, reading the `process` getter of each against a single getProcessInfo call, which reads
+// them on the libuv threadpool.
+
+var pty = require('..');
+
+var COUNT = 200;
+var ROUNDS = 20;
+
+var terms = [];
+for (var i = 0; i < COUNT; i++) {
+  terms.push(pty.spawn('/bin/sh', ['-c', 'sleep 60'], { name: 'xterm-256color', cols: 80, rows: 26, env: process.env }));
+}
+
+function getter() {
+  var start = process.hrtime.bigint();
+  for (var r = 0; r < ROUNDS; r++) {
+    terms.forEach(t => t.process);
+  }
+  return Number(process.hrtime.bigint() - start) / 1e6 / ROUNDS;
+}
+
+async function batched() {
+  var blocked = 0;
+  var total = 0;
+  for (var r = 0; r < ROUNDS; r++) {
+    var start = process.hrtime.bigint();
+    var promise = pty.getProcessInfo(terms);
+    blocked += Number(process.hrtime.bigint() - start) / 1e6;
+    await promise;
+    total += Number(process.hrtime.bigint() - start) / 1e6;
+  }
+  return { blocked: blocked / ROUNDS, total: total / ROUNDS };
+}
+
+setTimeout(async () => {
+  console.log(`process getter: ${getter().toFixed(2)}ms blocked per round of ${COUNT} terminals`);
+  var b = await batched();
+  console.log(`getProcessInfo: ${b.blocked.toFixed(2)}ms blocked, ${b.total.toFixed(2)}ms until resolved per round`);
+  terms.forEach(t => t.kill());
+}, 1000);
@@ -0,0 +1,49 @@
+// This test measures the cost of recording sessions with startRecording. It runs a few terminals
+// that print as fast as they can through the native reader, once without and once with a
+// recording of each, and reports the throughput, the event loop delay and the size of the
+// recordings.
+
+var pty = require('..');
+var fs = require('fs');
+var os = require('os');
+var path = require('path');
+var perf_hooks = require('perf_hooks');
+
+var TERMINALS = parseInt(process.argv[2] || '4', 10);
+var BYTES = 32 * 1024 * 1024;
+
+function run(record) {
+  var dir = fs.mkdtempSync(path.join(os.tmpdir(), 'node-pty-recorder-'));
+  var bytes = 0;
+  var options = { name: 'xterm-256color', cols: 80, rows: 26, env: process.env, useNativeReader: true };
+  var done = [];
+  for (var i = 0; i < TERMINALS; i++) {
+    // Printable output, so the recordings are not dominated by escaping.
+    var term = pty.spawn('sh', ['-c', `sleep 0.1; head -c ${BYTES} /dev/zero | tr '\\0' a`], options);
+    if (record) {
+      term.startRecording(path.join(dir, `${i}.cast`));
+    }
+    term.onData(data => { bytes += data.length; });
+    done.push(new Promise(resolve => term.onExit(resolve)));
+  }
+
+  var delay = perf_hooks.monitorEventLoopDelay({ resolution: 10 });
+  delay.enable();
+  var start = process.hrtime.bigint();
+  return Promise.all(done).then(() => {
+    var ms = Number(process.hrtime.bigint() - start) / 1e6;
+    delay.disable();
+    // Give the writer thread time to finish the files.
+    return new Promise(resolve => setTimeout(resolve, 500)).then(() => {
+      var recorded = fs.readdirSync(dir).reduce((sum, f) => sum + fs.statSync(path.join(dir, f)).size, 0);
+      console.log(`${record ? 'recording' : 'not recording'} x${TERMINALS}: ` +
+        `${(bytes / 1024 / 1024 / (ms / 1000)).toFixed(1)}MB/s, ` +
+        `event loop delay p99 ${(delay.percentile(99) / 1e6).toFixed(1)}ms, ` +
+        `recorded ${(recorded / 1024 / 1024).toFixed(1)}MB`);
+      fs.readdirSync(dir).forEach(f => fs.unlinkSync(path.join(dir, f)));
+      fs.rmdirSync(dir);
+    });
+  });
+}
+
+run(false).then(() => run(true));
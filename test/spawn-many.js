@@ -0,0 +1,45 @@
+// This test compares restoring a workspace with pty.spawn in a loop and with a single
+// pty.spawnMany call at 10, 100 and 1000 sessions. Spawning 1000 ptys needs more than the common
+// default of 1024 open files, raise it with `ulimit -n` first.
+
+var os = require('os');
+var pty = require('..');
+
+var isWindows = os.platform() === 'win32';
+var shell = isWindows ? 'cmd.exe' : 'sh';
+var args = isWindows ? ['/c', 'exit'] : ['-c', 'exit'];
+var options = {
+  name: 'xterm-256color',
+  cols: 80,
+  rows: 26,
+  cwd: isWindows ? process.env.USERPROFILE : process.env.HOME,
+  env: process.env
+};
+
+function run(name, count, spawn) {
+  var start = process.hrtime.bigint();
+  var terms = spawn(count);
+  var ms = Number(process.hrtime.bigint() - start) / 1e6;
+  console.log(`${name} x${count}: ${ms.toFixed(1)}ms`);
+  return Promise.all(terms.map(t => new Promise(resolve => t.onExit(resolve))));
+}
+
+function loop(count) {
+  var terms = [];
+  for (var i = 0; i < count; i++) {
+    terms.push(pty.spawn(shell, args, options));
+  }
+  return terms;
+}
+
+function batch(count) {
+  var specs = [];
+  for (var i = 0; i < count; i++) {
+    specs.push({ file: shell, args, options });
+  }
+  return pty.spawnMany(specs);
+}
+
+[10, 100, 1000].reduce((p, count) => {
+  return p.then(() => run('loop', count, loop)).then(() => run('spawnMany', count, batch));
+}, Promise.resolve());
@@ -0,0 +1,46 @@
+// This test compares how many ptys per second can be spawned with pty.spawn and with a spawn
+// template when the environment has a couple of hundred variables, which is typical for shells
+// started from an IDE or a CI job.
+
+var os = require('os');
+var pty = require('..');
+
+var isWindows = os.platform() === 'win32';
+var shell = isWindows ? 'cmd.exe' : 'sh';
+var args = isWindows ? ['/c', 'exit'] : ['-c', 'exit'];
+var count = 200;
+
+var env = Object.assign({}, process.env);
+for (var i = 0; Object.keys(env).length < 200; i++) {
+  env[`NODE_PTY_BENCH_${i}`] = 'x'.repeat(64);
+}
+var options = {
+  name: 'xterm-256color',
+  cols: 80,
+  rows: 26,
+  cwd: isWindows ? process.env.USERPROFILE : process.env.HOME,
+  env
+};
+
+function run(name, spawn) {
+  return new Promise(resolve => {
+    var exited = 0;
+    var onExit = () => {
+      if (++exited === count) {
+        resolve();
+      }
+    };
+    var start = process.hrtime.bigint();
+    for (var i = 0; i < count; i++) {
+      spawn().onExit(onExit);
+    }
+    var ms = Number(process.hrtime.bigint() - start) / 1e6;
+    console.log(`${name}: ${count} spawns in ${ms.toFixed(0)}ms, ${(count / ms * 1000).toFixed(0)} spawns/s`);
+  });
+}
+
+var template = pty.createSpawnTemplate(shell, args, options);
+run('spawn', () => pty.spawn(shell, args, options))
+  .then(() => run('template', () => template.spawn()))
+  .then(() => run('spawn', () => pty.spawn(shell, args, options)))
+  .then(() => run('template', () => template.spawn()));
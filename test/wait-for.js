@@ -0,0 +1,53 @@
+// This test compares waiting for a prompt by matching every onData string against a regex with
+// waitFor, which matches the raw output in the native reader. It runs a number of shells that
+// print a lot of output followed by a prompt-like marker, waits for the marker in each and reports
+// the wall time and the CPU time the process used.
+
+var pty = require('..');
+
+var TERMINALS = parseInt(process.argv[2] || '50', 10);
+var LINES = 20000;
+var MARKER = 'READY-$';
+
+var SCRIPT = `i=0; while [ $i -lt ${LINES} ]; do echo "line $i of some typical build output"; i=$((i+1)); done; printf 'READY-$ '; sleep 1`;
+
+function run(native) {
+  var options = { name: 'xterm-256color', cols: 80, rows: 26, env: process.env, useNativeReader: native };
+  var cpu = process.cpuUsage();
+  var start = process.hrtime.bigint();
+  var waits = [];
+  var terms = [];
+  for (var i = 0; i < TERMINALS; i++) {
+    var term = pty.spawn('sh', ['-c', SCRIPT], options);
+    terms.push(term);
+    if (native) {
+      term.onData(() => {});
+      waits.push(term.waitFor(MARKER, 60000));
+    } else {
+      waits.push(new Promise(resolve => {
+        // Keeps a tail so a marker split across chunks is still found.
+        var tail = '';
+        var regex = /READY-\$/;
+        var listener = term.onData(data => {
+          var text = tail + data;
+          if (regex.test(text)) {
+            listener.dispose();
+            resolve();
+            return;
+          }
+          tail = text.slice(-MARKER.length);
+        });
+      }));
+    }
+  }
+  return Promise.all(waits).then(() => {
+    var ms = Number(process.hrtime.bigint() - start) / 1e6;
+    var used = process.cpuUsage(cpu);
+    console.log(`${native ? 'waitFor' : 'regex on onData'} x${TERMINALS}: ` +
+      `${ms.toFixed(0)}ms, cpu user ${(used.user / 1000).toFixed(0)}ms system ${(used.system / 1000).toFixed(0)}ms`);
+    terms.forEach(t => t.kill('SIGKILL'));
+    return Promise.all(terms.map(t => new Promise(resolve => t.onExit(resolve))));
+  });
+}
+
+run(false).then(() => run(true));
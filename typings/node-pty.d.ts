@@ -17,6 +17,313 @@ declare module 'node-pty' {
    */
   export function spawn(file: string, args: string[] | string, options: IPtyForkOptions | IWindowsPtyForkOptions): IPty;
 
+  /**
+   * Forks a process as a pseudoterminal without blocking the event loop. On Unix the pty is opened
+   * and the process started on the libuv threadpool, so many spawns can be in flight at once. On
+   * Windows this is equivalent to `spawn`.
+   * @param file The file to launch.
+   * @param args The file's arguments as argv (string[]) or in a pre-escaped CommandLine format
+   * (string). Note that the CommandLine option is only available on Windows and is expected to be
+   * escaped properly.
+   * @param options The options of the terminal.
+   * @returns A promise that resolves to the pty, or rejects when the process could not be started.
+   */
+  export function spawnAsync(file: string, args: string[] | string, options: IPtyForkOptions | IWindowsPtyForkOptions): Promise<IPty>;
+
+  /**
+   * Forks a batch of processes as pseudoterminals. On Unix all of them are started by a single
+   * native call, which is considerably cheaper than calling `spawn` in a loop when restoring many
+   * sessions at once.
+   * @param specs The file, arguments and options of each process.
+   * @returns The pty of each spec, or the error that prevented it from starting.
+   */
+  export function spawnMany(specs: ISpawnManySpec[]): Array<IPty | Error>;
+
+  export interface ISpawnManySpec {
+    /**
+     * The file to launch.
+     */
+    file: string;
+
+    /**
+     * The file's arguments as argv (string[]) or in a pre-escaped CommandLine format (string), see
+     * `spawn`.
+     */
+    args: string[] | string;
+
+    /**
+     * The options of the terminal.
+     */
+    options: IPtyForkOptions | IWindowsPtyForkOptions;
+  }
+
+  /**
+   * Creates a template for spawning many similar sessions. On Unix the environment, the path of
+   * the executable and the terminal settings are resolved once, each spawn from the template then
+   * only applies its own overrides.
+   * @param file The file to launch.
+   * @param args The arguments shared by all sessions.
+   * @param options The options shared by all sessions.
+   */
+  export function createSpawnTemplate(file: string, args: string[] | string, options: IPtyForkOptions | IWindowsPtyForkOptions): ISpawnTemplate;
+
+  /**
+   * Keeps pty pairs opened ahead of time so spawns skip allocating the device. A background thread
+   * refills the pool once fewer than `lowWatermark` pairs are left. The pool is shared by the whole
+   * process and disabled by default. This is a no-op on Windows.
+   */
+  export function configurePool(options: IPtyPoolOptions): void;
+
+  /**
+   * Gets the state and hit rate of the pool set up by `configurePool`.
+   */
+  export function getPoolStats(): IPtyPoolStats;
+
+  /**
+   * Gets the distribution of `IPty.spawnTimings` over every pty spawned by this process so far, per
+   * phase. Always empty on Windows.
+   */
+  export function getSpawnLatencyHistogram(): ISpawnLatencyHistogram;
+
+  /**
+   * Gets `IPty.getStats` of every pty spawned by this process that is still open, and the total
+   * over all of them including those that closed. Always empty on Windows.
+   */
+  export function getIoStats(): IPtyIoStatsSummary;
+
+  /**
+   * Describes the foreground process of many ptys at once, like reading `IPty.process` of each of
+   * them but off the main thread, with a single native call. Resolves with undefined for a pty
+   * that has none or closed. Always undefined on Windows.
+   */
+  export function getProcessInfo(ptys: IPty[]): Promise<Array<IProcessInfo | undefined>>;
+
+  export interface IProcessInfo {
+    /**
+     * The foreground process group of the pty, the process described is its leader.
+     */
+    pid: number;
+
+    /**
+     * The short name the kernel keeps for the process, at most 15 characters on Linux.
+     */
+    name: string;
+
+    /**
+     * The arguments of the process, cut short when very long. Empty when they can't be read, like
+     * for processes of other users on macOS.
+     */
+    argv: string[];
+
+    /**
+     * The working directory of the process, undefined when it can't be read.
+     */
+    cwd: string | undefined;
+  }
+
+  export interface IPtyPoolOptions {
+    /**
+     * The number of pty pairs to keep opened, 0 disables the pool.
+     */
+    size: number;
+
+    /**
+     * Refill the pool once fewer pairs than this are left, defaults to half of `size`.
+     */
+    lowWatermark?: number;
+  }
+
+  export interface IPtyPoolStats {
+    size: number;
+    lowWatermark: number;
+
+    /**
+     * The number of pairs currently in the pool.
+     */
+    available: number;
+
+    /**
+     * The number of spawns that took a pair from the pool.
+     */
+    hits: number;
+
+    /**
+     * The number of spawns that found the pool empty and opened their own pair.
+     */
+    misses: number;
+  }
+
+  /**
+   * The resources a process used over its lifetime, as reported by wait4(2). This includes the
+   * descendants it waited for.
+   */
+  export interface IResourceUsage {
+    /**
+     * CPU time spent in user mode in milliseconds.
+     */
+    userTime: number;
+
+    /**
+     * CPU time spent in the kernel in milliseconds.
+     */
+    systemTime: number;
+
+    /**
+     * The peak resident set size in bytes.
+     */
+    maxRss: number;
+
+    voluntaryContextSwitches: number;
+    involuntaryContextSwitches: number;
+
+    /**
+     * Wall-clock time from the spawn until the process was reaped in milliseconds.
+     */
+    lifetime: number;
+  }
+
+  /**
+   * How long each phase of starting a process took in milliseconds. Phases the platform does not go
+   * through, or that have not happened, are undefined.
+   */
+  export interface ISpawnTimings {
+    /**
+     * Copying the arguments out of JS.
+     */
+    marshal: number;
+
+    /**
+     * Opening the pty, or taking it from the pool.
+     */
+    openpty: number;
+
+    /**
+     * The posix_spawn or fork call itself.
+     */
+    spawn: number;
+
+    /**
+     * From starting the spawn until the helper that execs the process ran.
+     */
+    helper?: number;
+
+    /**
+     * Acquiring the pty as the controlling terminal.
+     */
+    ctty?: number;
+
+    /**
+     * Changing to the working directory.
+     */
+    chdir?: number;
+
+    /**
+     * Changing to `uid` and `gid`.
+     */
+    setuid?: number;
+
+    /**
+     * Closing the file descriptors inherited from this process.
+     */
+    closeFds?: number;
+
+    /**
+     * From exec until the first output of the process.
+     */
+    exec?: number;
+
+    /**
+     * From starting the spawn until the first output of the process.
+     */
+    firstOutput?: number;
+  }
+
+  export interface ISpawnPhaseHistogram {
+    count: number;
+    sum: number;
+    max: number;
+
+    /**
+     * The number of samples in each bucket of `ISpawnLatencyHistogram.bounds`.
+     */
+    counts: number[];
+  }
+
+  export interface ISpawnLatencyHistogram {
+    /**
+     * Inclusive upper bounds of the buckets in milliseconds, the last one is `Infinity`.
+     */
+    bounds: number[];
+    phases: { [phase in keyof ISpawnTimings]?: ISpawnPhaseHistogram };
+  }
+
+  /**
+   * Times are in milliseconds, queues are what is waiting right now.
+   */
+  export interface IPtyIoStats {
+    bytesRead: number;
+    bytesWritten: number;
+
+    /**
+     * The number of read(2) calls that returned output.
+     */
+    reads: number;
+
+    /**
+     * The number of write(2) calls, including those that hit EAGAIN.
+     */
+    writes: number;
+
+    /**
+     * The number of reads in each bucket of `readSizeBounds`.
+     */
+    readSizes: number[];
+
+    /**
+     * Inclusive upper bounds of the read size buckets in bytes, the last one is `Infinity`.
+     */
+    readSizeBounds: number[];
+
+    /**
+     * Writes that found the kernel buffer full, by hitting EAGAIN or writing less than asked, so the
+     * rest had to wait.
+     */
+    writeRetries: number;
+
+    /**
+     * How long reading stopped because of `pause`, flow control or a consumer that fell behind.
+     */
+    pausedTime: number;
+
+    /**
+     * How long writes waited for room in the kernel buffer.
+     */
+    backpressuredTime: number;
+
+    /**
+     * Bytes read but not yet delivered.
+     */
+    readQueue: number;
+
+    /**
+     * Writes, and their bytes, not yet written.
+     */
+    writeQueue: number;
+    writeQueueBytes: number;
+  }
+
+  export interface IPtyIoStatsSummary {
+    /**
+     * Summed over every pty spawned by this process, including those that closed.
+     */
+    total: IPtyIoStats;
+
+    /**
+     * The ptys that are still open.
+     */
+    terminals: Array<{ pid: number, stats: IPtyIoStats }>;
+  }
+
   export interface IBasePtyForkOptions {
 
     /**
@@ -74,6 +381,126 @@ declare module 'node-pty' {
      * The string that should resume the pty when `handleFlowControl` is true. Default is XON ('\x11').
      */
     flowControlResume?: string;
+
+    /**
+     * Merges the chunks read from the pty into fewer, larger `onData` events. Listeners added with
+     * `on('data')` still get every chunk. By default every chunk is its own event.
+     */
+    dataCoalescing?: IDataCoalescingOptions;
+
+    /**
+     * (EXPERIMENTAL)
+     * Byte-counted flow control, a replacement for `handleFlowControl` that does not take over
+     * any input. The output fired by `onData` counts as unacknowledged until it is passed to
+     * `IPty.ack`. Reading the pty is paused while too much is unacknowledged, which leaves the
+     * output in the kernel and eventually blocks the process. By default output is never paused.
+     */
+    ackFlowControl?: IAckFlowControlOptions;
+  }
+
+  export interface IAckFlowControlOptions {
+    /**
+     * Pause reading once more than this many bytes are unacknowledged. Output fired as a string
+     * counts as its length in `encoding`. Default is 1048576.
+     */
+    highWatermark?: number;
+
+    /**
+     * Resume reading once no more than this many bytes are unacknowledged. Must be below
+     * `highWatermark`. Default is 262144, or half of `highWatermark` when that is lower.
+     */
+    lowWatermark?: number;
+  }
+
+  export interface IDataCoalescingOptions {
+    /**
+     * How long a chunk may wait for more output in milliseconds. Default is 5.
+     */
+    maxDelay?: number;
+
+    /**
+     * Flush once this many characters, or bytes when `encoding` is null, are pending. Default is
+     * 65536.
+     */
+    maxBatchSize?: number;
+
+    /**
+     * Pass output through right away while the user typed within `inputWindow`, so echo is never
+     * delayed, and after the output was idle for `maxDelay`. Only output that keeps coming is
+     * batched. Default is false.
+     */
+    adaptive?: boolean;
+
+    /**
+     * How long a write counts as recent input for `adaptive` in milliseconds. Default is 100.
+     */
+    inputWindow?: number;
+  }
+
+  export interface IDataCoalescingStats {
+    /**
+     * The number of chunks read from the pty.
+     */
+    chunks: number;
+
+    /**
+     * The number of `onData` events fired.
+     */
+    events: number;
+
+    /**
+     * The number of events saved by merging chunks.
+     */
+    saved: number;
+  }
+
+  /**
+   * A ring in shared memory holding the output of a pty. It starts with a 64 byte header holding
+   * the head and tail byte counters as uint32 at offsets 0 and 4, followed by `size` bytes of
+   * data. The counters only grow, wrapping at 2^32, the bytes between them are unread. While the
+   * ring is full the output waits in the kernel.
+   */
+  export interface IOutputRing {
+    /**
+     * The shared memory, which may be handed to a worker.
+     */
+    readonly buffer: SharedArrayBuffer;
+
+    /**
+     * The number of bytes of data.
+     */
+    readonly size: number;
+
+    /**
+     * The byte counter advanced as output is written.
+     */
+    readonly head: number;
+
+    /**
+     * The byte counter advanced by `consume`.
+     */
+    readonly tail: number;
+
+    /**
+     * The number of unread bytes.
+     */
+    readonly available: number;
+
+    /**
+     * Fires with the new head after output was written.
+     */
+    readonly onWrite: IEvent<number>;
+
+    /**
+     * Returns views of the unread output without copying it, two when it wraps around. They are
+     * only valid until `consume` is called.
+     */
+    peek(): Buffer[];
+
+    /**
+     * Marks `bytes`, by default all, of the unread output as read.
+     */
+    consume(bytes?: number): void;
   }
 
   export interface IPtyForkOptions extends IBasePtyForkOptions {
@@ -83,6 +510,245 @@ declare module 'node-pty' {
      */
     uid?: number;
     gid?: number;
+
+    /**
+     * (EXPERIMENTAL)
+     * Read the output of the pty on a native thread shared by every terminal that sets this,
+     * instead of a `tty.ReadStream` per terminal. This is cheaper with many mostly idle terminals.
+     * Default is false.
+     */
+    useNativeReader?: boolean;
+
+    /**
+     * (EXPERIMENTAL)
+     * Have the native reader write the output straight into a ring of this many bytes in shared
+     * memory, see `IPty.outputRing`, instead of firing `onData`. Must be a power of two, implies
+     * `useNativeReader`.
+     */
+    outputRing?: number;
+
+    /**
+     * (EXPERIMENTAL)
+     * Keep the most recent raw output in native memory, so clients that reconnect can be sent
+     * what they missed with `IPty.replayFrom`. Implies `useNativeReader`.
+     */
+    scrollback?: IScrollbackOptions;
+
+    /**
+     * (EXPERIMENTAL)
+     * Follow the shell integration sequences in the output, OSC 133 prompt and command markers and
+     * OSC 7 working directory reports, in native code as the output is read. See
+     * `IPty.onShellIntegration` and `IPty.getShellIntegration`. The shell has to be configured to
+     * send them. Implies `useNativeReader`.
+     */
+    shellIntegration?: IShellIntegrationOptions;
+
+    /**
+     * (EXPERIMENTAL)
+     * Never split a UTF-8 code point or an escape sequence (CSI, OSC, DCS and the like) across
+     * `onData` events: an incomplete one at the end of what was read is held back until the rest
+     * arrives. Sequences longer than 64KB, or whose rest doesn't arrive within 50ms, are delivered
+     * as they are. Implies `useNativeReader`, not supported with `outputRing`.
+     */
+    boundarySafeChunks?: boolean;
+
+    /**
+     * (EXPERIMENTAL)
+     * Also produce the output as plain text for logs and search, see `IPty.onPlainText`. Escape
+     * sequences and control characters other than tab are removed in native code as the output is
+     * read, and CR, LF and CRLF all become LF. Implies `useNativeReader`.
+     */
+    plainText?: boolean;
+
+    /**
+     * (EXPERIMENTAL)
+     * Signal characters (^C, ^\ and ^Z unless the process changed them with `stty`) written
+     * while earlier input is still queued, because the process isn't reading it, jump the queue
+     * as long as the process has `isig` set. With this option they also drop everything queued
+     * and the input the kernel is holding, like the terminal itself does unless the process has
+     * `noflsh` set. This may cut a bracketed paste short. Default is false.
+     */
+    discardInputOnInterrupt?: boolean;
+
+    /**
+     * The number of queued input bytes at which `IPty.write` starts returning false. Default is
+     * 16KB.
+     */
+    writeHighWaterMark?: number;
+
+    /**
+     * (EXPERIMENTAL)
+     * Pace large pastes into a process that reads its input a line at a time, the terminal's
+     * canonical mode, which the kernel would otherwise cut short at the first line longer than
+     * its line buffer (4KB on Linux, 1KB on macOS). Input is then written a few whole lines at a
+     * time as the process reads them, and a longer line is handed to it in pieces, each ended
+     * like ^D ends a line, rather than truncated. Input for a process in raw mode is written as
+     * fast as without this option. Default is false.
+     */
+    pacedInput?: boolean;
+  }
+
+  export interface IShellIntegrationOptions {
+    /**
+     * The number of finished commands to keep. Default is 100.
+     */
+    history?: number;
+  }
+
+  /**
+   * A command seen through OSC 133. Offsets are of the start of each marker in the output,
+   * comparable with `IPty.outputSequence`, and left out when the shell did not send the marker.
+   */
+  export interface IShellCommand {
+    /**
+     * Where the prompt starts, OSC 133 A.
+     */
+    promptOffset?: number;
+
+    /**
+     * Where the command line starts, OSC 133 B.
+     */
+    inputOffset?: number;
+
+    /**
+     * Where the output of the command starts, OSC 133 C.
+     */
+    outputOffset?: number;
+
+    /**
+     * Where the command finished, OSC 133 D.
+     */
+    endOffset?: number;
+
+    /**
+     * Milliseconds from reading C to reading D.
+     */
+    duration?: number;
+
+    /**
+     * The exit code reported with D, if any.
+     */
+    exitCode?: number;
+
+    /**
+     * The working directory last reported through OSC 7 when the command started.
+     */
+    cwd: string;
+  }
+
+  export interface IShellIntegrationEvent {
+    /**
+     * A prompt was shown, a command started or finished, or the working directory changed.
+     */
+    type: 'prompt' | 'commandStart' | 'commandFinish' | 'cwd';
+
+    /**
+     * The offset of the sequence in the output.
+     */
+    offset: number;
+
+    /**
+     * The command, for all but 'cwd'.
+     */
+    command?: IShellCommand;
+
+    /**
+     * The new working directory, for 'cwd'.
+     */
+    cwd?: string;
+  }
+
+  export interface IShellIntegrationState {
+    /**
+     * The working directory last reported through OSC 7, empty if none was.
+     */
+    cwd: string;
+
+    /**
+     * The most recent finished commands, oldest first.
+     */
+    commands: IShellCommand[];
+
+    /**
+     * The prompt or command in progress.
+     */
+    current?: IShellCommand;
+  }
+
+  export interface IScrollbackOptions {
+    /**
+     * The number of bytes of output to keep. Memory is only taken as output arrives.
+     */
+    limit: number;
+
+    /**
+     * Keep the output in memory mapped segment files instead of memory, for sessions that produce
+     * more output than should be kept in memory. `limit` is then the disk budget, once it is hit
+     * the oldest segment is dropped.
+     */
+    spill?: IScrollbackSpillOptions;
+  }
+
+  export interface IScrollbackSpillOptions {
+    /**
+     * The directory the segment files are created in. They are removed from it right away and
+     * only live as long as the terminal.
+     */
+    directory: string;
+
+    /**
+     * The size of each segment file in bytes. Default is 67108864, or `limit` when that is lower.
+     */
+    segmentSize?: number;
+  }
+
+  export interface IScrollbackReplay {
+    /**
+     * The sequence number of the first byte of `data`.
+     */
+    seq: number;
+
+    /**
+     * Whether output from the requested sequence number on was already dropped, in which case
+     * `data` starts at the oldest output kept instead.
+     */
+    truncated: boolean;
+
+    /**
+     * The output, decoded with `encoding` unless that is null.
+     */
+    data: string;
+
+    /**
+     * Why a `spill` log stopped keeping output, set once it could not create a segment file.
+     * Everything it kept was dropped then, so `data` is empty.
+     */
+    error?: string;
+  }
+
+  export interface IWaitForMatch {
+    /**
+     * The index of the pattern that matched.
+     */
+    index: number;
+
+    /**
+     * The offset of the first byte of the match from the start of the output, comparable with
+     * `IPty.outputSequence`.
+     */
+    offset: number;
+  }
+
+  export interface IRecordingOptions {
+    /**
+     * Whether to record what is written to the pty as "i" events, defaults to true.
+     */
+    input?: boolean;
+
+    /**
+     * The title stored in the header of the recording.
+     */
+    title?: string;
   }
 
   export interface IWindowsPtyForkOptions extends IBasePtyForkOptions {
@@ -111,6 +777,51 @@ declare module 'node-pty' {
     conptyInheritCursor?: boolean;
   }
 
+  /**
+   * The per-session overrides of a spawn template.
+   */
+  export interface ISpawnTemplateOptions {
+    /**
+     * Number of initial cols of the pty, defaults to that of the template.
+     */
+    cols?: number;
+
+    /**
+     * Number of initial rows of the pty, defaults to that of the template.
+     */
+    rows?: number;
+
+    /**
+     * Working directory to be set for the child program, defaults to that of the template.
+     */
+    cwd?: string;
+
+    /**
+     * Variables added to or replacing those of the template's environment. Note that overriding
+     * PATH makes the child search it again for the executable.
+     */
+    env?: { [key: string]: string | undefined };
+  }
+
+  /**
+   * Spawns sessions that share the file, arguments and options given to `createSpawnTemplate`.
+   */
+  export interface ISpawnTemplate {
+    /**
+     * Spawns a session.
+     * @param args Arguments appended to those of the template.
+     * @param options The overrides of this session.
+     */
+    spawn(args?: string[], options?: ISpawnTemplateOptions): IPty;
+
+    /**
+     * Spawns a session without blocking the event loop, see `spawnAsync`.
+     * @param args Arguments appended to those of the template.
+     * @param options The overrides of this session.
+     */
+    spawnAsync(args?: string[], options?: ISpawnTemplateOptions): Promise<IPty>;
+  }
+
   /**
    * An interface representing a pseudoterminal.
    */
@@ -135,6 +846,29 @@ declare module 'node-pty' {
      */
     readonly process: string;
 
+    /**
+     * How long each phase of starting the process took. Available once the process has produced
+     * its first output or exited, always undefined on Windows.
+     */
+    readonly spawnTimings: ISpawnTimings | undefined;
+
+    /**
+     * How much `dataCoalescing` merged so far, undefined when it is not enabled.
+     */
+    readonly dataCoalescingStats: IDataCoalescingStats | undefined;
+
+    /**
+     * The ring the output is written into when `outputRing` is set, undefined otherwise.
+     */
+    readonly outputRing: IOutputRing | undefined;
+
+    /**
+     * The sequence number just past the output fired by `onData` so far, which is the number of
+     * bytes of it. Output held while paused or coalesced is not counted until it is fired. With
+     * `outputRing` it counts the bytes written into the ring. Always 0 without `scrollback`.
+     */
+    readonly outputSequence: number;
+
     /**
      * (EXPERIMENTAL)
      * Whether to handle flow control. Useful to disable/re-enable flow control during runtime.
@@ -150,10 +884,35 @@ declare module 'node-pty' {
     readonly onData: IEvent<string>;
 
     /**
-     * Adds an event listener for when an exit event fires. This happens when the pty exits.
+     * Adds an event listener for when an exit event fires. This happens when the pty exits. On Unix
+     * the event carries the resource usage of the process, unless something else reaped it.
+     * @returns an `IDisposable` to stop listening.
+     */
+    readonly onExit: IEvent<{ exitCode: number, signal?: number, resourceUsage?: IResourceUsage }>;
+
+    /**
+     * (EXPERIMENTAL)
+     * Adds an event listener for the shell integration sequences `shellIntegration` recognized.
+     * Events fire after the output they were found in. Never fires without `shellIntegration`.
+     * @returns an `IDisposable` to stop listening.
+     */
+    readonly onShellIntegration: IEvent<IShellIntegrationEvent>;
+
+    /**
+     * (EXPERIMENTAL)
+     * Adds an event listener for the output as plain text, decoded as UTF-8. Fires after `onData`
+     * got the output it came from. Never fires without `plainText`.
+     * @returns an `IDisposable` to stop listening.
+     */
+    readonly onPlainText: IEvent<string>;
+
+    /**
+     * Adds an event listener for when input that had to wait because the process was not reading
+     * was all written, like the 'drain' event of a writable stream. Use `IPty.getStats` to see how
+     * much input is still queued. Never fires on Windows.
      * @returns an `IDisposable` to stop listening.
      */
-    readonly onExit: IEvent<{ exitCode: number, signal?: number }>;
+    readonly onDrain: IEvent<void>;
 
     /**
      * Resizes the dimensions of the pty.
@@ -174,10 +933,14 @@ declare module 'node-pty' {
     clear(): void;
 
     /**
-     * Writes data to the pty.
+     * Writes data to the pty. What the process isn't ready to read is queued, and a Buffer is
+     * queued as is rather than copied, so it must not be changed until `onDrain` fires.
      * @param data The data to write.
+     * @returns false once `writeHighWaterMark` bytes or more are queued, like
+     * `stream.Writable.write`: the data is still queued, but nothing more should be written
+     * until `onDrain` fires. Always true on Windows.
      */
-    write(data: string | Buffer): void;
+    write(data: string | Buffer): boolean;
 
     /**
      * Kills the pty.
@@ -196,6 +959,63 @@ declare module 'node-pty' {
      * Resumes the pty for customizable flow control.
      */
     resume(): void;
+
+    /**
+     * Acknowledges that the consumer processed `length` bytes of the output fired by `onData`,
+     * for instance `Buffer.byteLength(data)` with the default utf8 `encoding`. Only has an effect
+     * with `ackFlowControl`.
+     */
+    ack(length: number): void;
+
+    /**
+     * Returns the output kept by `scrollback` from the sequence number `seq` on, up to `end` or
+     * `outputSequence`. A client that saw the output up to `outputSequence` can reconnect and
+     * pass that to get what it missed.
+     * @throws Without `scrollback`, which is not supported on Windows.
+     */
+    replayFrom(seq: number, end?: number): IScrollbackReplay;
+
+    /**
+     * (EXPERIMENTAL)
+     * Records the session to an asciicast v2 file at `path`, replacing any recording in progress.
+     * The output is timestamped and queued by the native reader as it is read, the input by the
+     * native writer as it is written, on the same clock, and both are written in batches from a
+     * background thread.
+     * @throws Without `useNativeReader`, which is not supported on Windows, or when the file can't
+     * be opened.
+     */
+    startRecording(path: string, options?: IRecordingOptions): void;
+
+    /**
+     * Stops the recording, the file is complete shortly after. Recording also stops when the pty
+     * closes.
+     */
+    stopRecording(): void;
+
+    /**
+     * (EXPERIMENTAL)
+     * Resolves once the output from now on contains one of `patterns`, which are matched as raw
+     * bytes, strings as UTF-8, by the native reader without decoding the output. A match may span
+     * several chunks of output. When several patterns match, the one that ends first wins.
+     * @param patterns The patterns to look for, none may be empty.
+     * @param timeout Reject if nothing matched within this many milliseconds.
+     * @throws (rejects) Without `useNativeReader`, which is not supported on Windows, with
+     * `outputRing`, or once the pty closes before a pattern matched.
+     */
+    waitFor(patterns: string | Buffer | (string | Buffer)[], timeout?: number): Promise<IWaitForMatch>;
+
+    /**
+     * (EXPERIMENTAL)
+     * Returns the current working directory and recent commands seen by `shellIntegration`, or
+     * undefined without it.
+     */
+    getShellIntegration(): IShellIntegrationState | undefined;
+
+    /**
+     * Returns the I/O of the pty so far. The counters are always on and cheap, reading them costs
+     * one native call at most. Undefined on Windows.
+     */
+    getStats(): IPtyIoStats | undefined;
   }
 
   /**